@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Characters/Enemies/AITasks/BTTask_FollowLandingPath.h"
+#include "AIController.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "Characters/Enemies/Navigation/PWPathRequestQueueSubsystem.h"
+#include "Navigation/PathFollowingComponent.h"
+
+UBTTask_FollowLandingPath::UBTTask_FollowLandingPath(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	NodeName = TEXT("Follow landing path");
+	bNotifyTick = true;
+}
+
+uint16 UBTTask_FollowLandingPath::GetInstanceMemorySize() const
+{
+	return sizeof(FBTFollowLandingPathMemory);
+}
+
+EBTNodeResult::Type UBTTask_FollowLandingPath::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	AAIController* AIController = OwnerComp.GetAIOwner();
+	APWEnemyCharacter* EnemyCharacter = AIController != nullptr ? Cast<APWEnemyCharacter>(AIController->GetPawn()) : nullptr;
+	UPWPathRequestQueueSubsystem* PathRequestQueue = GetWorld()->GetSubsystem<UPWPathRequestQueueSubsystem>();
+	if(EnemyCharacter == nullptr || PathRequestQueue == nullptr)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	FNavPathSharedPtr Path;
+	AActor* TargetActor = nullptr;
+	if(PathRequestQueue->ConsumeLandingPath(EnemyCharacter, Path, TargetActor) == false)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	const FAIRequestID MoveRequestId = AIController->RequestMove(FAIMoveRequest(TargetActor), Path);
+	if(MoveRequestId.IsValid() == false)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	reinterpret_cast<FBTFollowLandingPathMemory*>(NodeMemory)->MoveRequestId = MoveRequestId;
+	return EBTNodeResult::InProgress;
+}
+
+void UBTTask_FollowLandingPath::TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
+{
+	//The move is over when the path following is idle or moved on to another request
+	const FBTFollowLandingPathMemory* Memory = reinterpret_cast<FBTFollowLandingPathMemory*>(NodeMemory);
+	const AAIController* AIController = OwnerComp.GetAIOwner();
+	const UPathFollowingComponent* PathFollowing = AIController != nullptr ? AIController->GetPathFollowingComponent() : nullptr;
+	if(PathFollowing == nullptr || PathFollowing->GetCurrentRequestId() != Memory->MoveRequestId || PathFollowing->GetStatus() == EPathFollowingStatus::Idle)
+	{
+		FinishLatentTask(OwnerComp, EBTNodeResult::Succeeded);
+	}
+}
+
+EBTNodeResult::Type UBTTask_FollowLandingPath::AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	const FBTFollowLandingPathMemory* Memory = reinterpret_cast<FBTFollowLandingPathMemory*>(NodeMemory);
+	AAIController* AIController = OwnerComp.GetAIOwner();
+	const UPathFollowingComponent* PathFollowing = AIController != nullptr ? AIController->GetPathFollowingComponent() : nullptr;
+	if(PathFollowing != nullptr && PathFollowing->GetCurrentRequestId() == Memory->MoveRequestId)
+	{
+		AIController->StopMovement();
+	}
+
+	return EBTNodeResult::Aborted;
+}
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AITypes.h"
+#include "BehaviorTree/BTTaskNode.h"
+#include "BTTask_FollowLandingPath.generated.h"
+
+struct FBTFollowLandingPathMemory
+{
+	FAIRequestID MoveRequestId;
+};
+
+/**
+ * Follows the path served by UPWPathRequestQueueSubsystem to an enemy that just landed.
+ * Fails right away when no path was served, put it before the move of the ground branch in a selector
+ * so the enemy only searches its own path in that case.
+ */
+UCLASS()
+class PROJECTWATER_API UBTTask_FollowLandingPath : public UBTTaskNode
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_FollowLandingPath(const FObjectInitializer& ObjectInitializer);
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual EBTNodeResult::Type AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual uint16 GetInstanceMemorySize() const override;
+
+protected:
+	virtual void TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+};
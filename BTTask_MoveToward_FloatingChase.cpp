@@ -6,6 +6,8 @@
 #include "Blueprint/AIBlueprintHelperLibrary.h"
 #include "Characters/Enemies/Controllers/BlackboardKeys.h"
 #include "Characters/Enemies/Controllers/PWEnemyController.h"
+#include "Characters/Enemies/PWEnemySignificanceSubsystem.h"
+#include "Characters/Enemies/Navigation/PWFlightNavigationSubsystem.h"
 #include "Kismet/GameplayStatics.h"
 
 UBTTask_MoveToward_FloatingChase::UBTTask_MoveToward_FloatingChase(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
@@ -35,9 +37,25 @@ EBTNodeResult::Type UBTTask_MoveToward_FloatingChase::ExecuteTask(UBehaviorTreeC
 		return EBTNodeResult::Failed;
 	}
 	
-	const FVector MyLocation = EnemyCharacter->GetActorLocation();
-	FVector Direction = PlayerLocation - MyLocation;
-	Direction.Normalize();
+	//Follow the flight path around the geometry of the gravity zone when the enemy has one
+	FVector Direction;
+	UPWFlightNavigationSubsystem* FlightNavigationSubsystem = GetWorld()->GetSubsystem<UPWFlightNavigationSubsystem>();
+	const bool bHasFlightPath = FlightNavigationSubsystem != nullptr && FlightNavigationSubsystem->GetFlightDirection(EnemyCharacter, PlayerLocation, Direction);
+
+	if(bHasFlightPath == false)
+	{
+		if(UPWEnemySignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<UPWEnemySignificanceSubsystem>())
+		{
+			//The far enemies reuse their last direction for a while instead of steering precisely every execution
+			Direction = SignificanceSubsystem->GetSteeringDirection(EnemyCharacter, PlayerLocation);
+		}
+		else
+		{
+			const FVector MyLocation = EnemyCharacter->GetActorLocation();
+			Direction = PlayerLocation - MyLocation;
+			Direction.Normalize();
+		}
+	}
 	
 	// Move towards player
 	EnemyCharacter->AddMovementInput(Direction, 1.0f);
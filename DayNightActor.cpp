@@ -2,6 +2,11 @@
 
 
 #include "DayNight/DayNightActor.h"
+#include "Characters/Enemies/PWEnemyPoolSubsystem.h"
+#include "Core/PWGameplayStats.h"
+#include "DayNight/PWWavePhaseManifest.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
 #include "Kismet/GameplayStatics.h"
 #include "Misc/OutputDeviceNull.h"
 
@@ -16,17 +21,24 @@ ADayNightActor::ADayNightActor()
 // Called when the game starts or when spawned
 void ADayNightActor::BeginPlay()
 {
+	LLM_SCOPE_BYTAG(PWDayNight);
+
 	Super::BeginPlay();
-	
+
+	PrefetchUpcomingWaveAssets();
 }
 
 void ADayNightActor::NewWaveWeather()
 {
+	LLM_SCOPE_BYTAG(PWDayNight);
+
 	//if the wave counter is greater than the size of the array, I reset the counter to 0.
 	if(WaveEnumCounter > Nightmare)
 	{
 		WaveEnumCounter = 0;
 	}
+
+	OnWaveStarted.Broadcast(WaveEnumCounter);
 	
 	PreviousSunAngle = SunAngle;
 	
@@ -60,7 +72,7 @@ void ADayNightActor::NewWaveWeather()
 			SunAngle = 0;
 			++WaveEnumCounter;
 
-			if(DirectionalLight)
+			if(DirectionalLight && bSkyUpdatesEnabled)
 			{
 				//set the local rotation of the sun
 				//I subtract negative sun angle to put the rotation back to 0, before adding an other rotation,
@@ -68,12 +80,14 @@ void ADayNightActor::NewWaveWeather()
 				DirectionalLight->AddActorLocalRotation(FRotator(-PreviousSunAngle, 0, 0));	 
 			}
 
-			if(SunBP)
+			if(SunBP && bSkyUpdatesEnabled)
 			{
 				//update the sun direction and position in the sky by calling the sky BP function
 				FOutputDeviceNull AR;
 				SunBP->CallFunctionByNameWithArguments(TEXT("UpdateSunDirection"), AR, NULL, true);
 			}
+
+			PrefetchUpcomingWaveAssets();
 			return;
 		
 		default:
@@ -83,10 +97,15 @@ void ADayNightActor::NewWaveWeather()
 	//Calculate the increment from the sun current position to the end position. I multiply the total of time by 10, because I increment every 0,1 seconds.
 	SunRotationIncrement = (SunAngle - PreviousSunAngle) / (TotalOfSecondsForMovingSun * 10.0f);
 	
-	GetWorld()->GetTimerManager().SetTimer(SunUpdateTimer, this, &ADayNightActor::OnSunUpdate, 0.1f,true);
+	if(UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>())
+	{
+		TimingWheel->SetTimer(SunUpdateTimer, this, &ADayNightActor::OnSunUpdate, 0.1f, true);
+	}
 
 	//increment the wave counter 
 	++WaveEnumCounter;
+
+	PrefetchUpcomingWaveAssets();
 	
 	//GEngine->AddOnScreenDebugMessage(-1, 4.0f, FColor::Blue, FString::Printf(TEXT("Current wave number is : %d and the sun angle is %d"), WaveEnumCounter, SunAngle));
 }
@@ -96,23 +115,158 @@ void ADayNightActor::OnSunUpdate()
 	ElapsedTime += 0.1f;
 	if(ElapsedTime >= TotalOfSecondsForMovingSun)
 	{
-		GetWorld()->GetTimerManager().ClearTimer(SunUpdateTimer);
+		if(UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>())
+		{
+			TimingWheel->ClearTimer(SunUpdateTimer);
+		}
 		ElapsedTime = 0.0f;
 		return;
 	}
 	
 	//Add the new sun rotation from the angle it is currently
-	if(DirectionalLight)
+	if(DirectionalLight && bSkyUpdatesEnabled)
 	{
 		DirectionalLight->AddActorLocalRotation(FRotator(SunRotationIncrement, 0, 0));
 	}
 
-	if(SunBP)
+	if(SunBP && bSkyUpdatesEnabled)
+	{
+		FOutputDeviceNull AR;
+		SunBP->CallFunctionByNameWithArguments(TEXT("UpdateSunDirection"), AR, NULL, true);
+	}
+}
+
+void ADayNightActor::ResumeFromSnapshot(bool bSunMoving)
+{
+	if(UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>())
+	{
+		if(bSunMoving)
+		{
+			TimingWheel->SetTimer(SunUpdateTimer, this, &ADayNightActor::OnSunUpdate, 0.1f, true);
+		}
+		else
+		{
+			TimingWheel->ClearTimer(SunUpdateTimer);
+		}
+	}
+
+	if(SunBP && bSkyUpdatesEnabled)
 	{
 		FOutputDeviceNull AR;
 		SunBP->CallFunctionByNameWithArguments(TEXT("UpdateSunDirection"), AR, NULL, true);
 	}
+
+	//The running wave keeps its assets, only the next wave is requested, unless it is already streaming.
+	//Going through PrefetchUpcomingWaveAssets would release the assets of the running wave
+	const int32 UpcomingWave = GetUpcomingWave();
+	if(UpcomingWaveAssetsHandle.IsValid() == false || UpcomingWaveAssetsIndex != UpcomingWave)
+	{
+		//The new request comes first, so the assets shared with the wave streamed before stay loaded
+		const TSharedPtr<FStreamableHandle> NewUpcomingHandle = RequestWaveAssets(UpcomingWave);
+		if(UpcomingWaveAssetsHandle.IsValid())
+		{
+			UpcomingWaveAssetsHandle->ReleaseHandle();
+		}
+
+		UpcomingWaveAssetsHandle = NewUpcomingHandle;
+		UpcomingWaveAssetsIndex = UpcomingWave;
+	}
+}
+
+void ADayNightActor::SetSkyUpdatesEnabled(bool bEnabled)
+{
+	bSkyUpdatesEnabled = bEnabled;
+}
+
+bool ADayNightActor::IsSunMoving() const
+{
+	const UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>();
+	return TimingWheel != nullptr && TimingWheel->IsTimerActive(SunUpdateTimer);
 }
 
+void ADayNightActor::PrewarmUpcomingWave()
+{
+	//The counter already points to the next wave, it goes back to the first wave after the nightmare
+	const int32 UpcomingWave = WaveEnumCounter > Nightmare ? FirstWave : WaveEnumCounter;
+	if(!EnemiesPerWave.IsValidIndex(UpcomingWave))
+	{
+		return;
+	}
 
+	UPWEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UPWEnemyPoolSubsystem>();
+	if(EnemyPool == nullptr)
+	{
+		return;
+	}
 
+	for(const FPWWaveEnemyCount& WaveEnemy : EnemiesPerWave[UpcomingWave].Enemies)
+	{
+		EnemyPool->PrewarmPool(WaveEnemy.EnemyClass, WaveEnemy.NumEnemies);
+	}
+}
+
+int32 ADayNightActor::GetUpcomingWave() const
+{
+	//The counter already points to the next wave, it goes back to the first wave after the nightmare
+	return WaveEnumCounter > Nightmare ? FirstWave : WaveEnumCounter;
+}
+
+TSharedPtr<FStreamableHandle> ADayNightActor::RequestWaveAssets(int32 WaveIndex)
+{
+	if(!WavePhaseManifest)
+	{
+		return nullptr;
+	}
+
+	TArray<FSoftObjectPath> AssetPaths;
+	WavePhaseManifest->GetAssetPathsForWave(WaveIndex, AssetPaths);
+	if(AssetPaths.IsEmpty())
+	{
+		return nullptr;
+	}
+
+	return UAssetManager::GetStreamableManager().RequestAsyncLoad(AssetPaths,
+		FStreamableDelegate::CreateUObject(this, &ADayNightActor::OnUpcomingWaveAssetsLoaded, WaveIndex),
+		FStreamableManager::AsyncLoadHighPriority);
+}
+
+void ADayNightActor::PrefetchUpcomingWaveAssets()
+{
+	const int32 UpcomingWave = GetUpcomingWave();
+
+	//Request the next wave first, so the assets shared with the previous wave are never unloaded in between
+	const TSharedPtr<FStreamableHandle> NewUpcomingHandle = RequestWaveAssets(UpcomingWave);
+
+	//The previous wave is over, its assets can be released
+	if(CurrentWaveAssetsHandle.IsValid())
+	{
+		CurrentWaveAssetsHandle->ReleaseHandle();
+	}
+
+	//The wave that just started uses the assets streamed during the previous wave. Never wait for them here,
+	//the rest is streamed in the background instead of blocking the transition frame
+	CurrentWaveAssetsHandle = UpcomingWaveAssetsHandle;
+	if(CurrentWaveAssetsHandle.IsValid() && !CurrentWaveAssetsHandle->HasLoadCompleted())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Wave %d started before its assets finished streaming"), UpcomingWave == FirstWave ? Nightmare : UpcomingWave - 1);
+	}
+
+	UpcomingWaveAssetsHandle = NewUpcomingHandle;
+	UpcomingWaveAssetsIndex = UpcomingWave;
+}
+
+void ADayNightActor::OnUpcomingWaveAssetsLoaded(int32 WaveIndex)
+{
+	OnUpcomingWaveAssetsReady.Broadcast(WaveIndex);
+}
+
+bool ADayNightActor::IsUpcomingWaveReady() const
+{
+	//No assets to stream means the wave is ready
+	return !UpcomingWaveAssetsHandle.IsValid() || UpcomingWaveAssetsHandle->HasLoadCompleted();
+}
+
+float ADayNightActor::GetUpcomingWaveLoadProgress() const
+{
+	return UpcomingWaveAssetsHandle.IsValid() ? UpcomingWaveAssetsHandle->GetProgress() : 1.0f;
+}
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "PWLantern.h"
+#include "Core/PWTimingWheelSubsystem.h"
 #include "Components/ExponentialHeightFogComponent.h"
 #include "Engine/DirectionalLight.h"
 #include "GameFramework/Actor.h"
@@ -12,6 +13,36 @@
 UENUM()
 enum WavesBetweenNightmares { FirstWave = 0, SecondWave = 1, ThirdWave = 2, LastWaveBeforeNightmare = 3, Nightmare = 4 };
 
+class APWEnemyCharacter;
+class UPWWavePhaseManifest;
+struct FStreamableHandle;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnWaveAssetsReady, int32, WaveIndex);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnWaveStarted, int32 /*WaveIndex*/);
+
+//Number of enemies of one class in a wave
+USTRUCT(BlueprintType)
+struct FPWWaveEnemyCount
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSubclassOf<APWEnemyCharacter> EnemyClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 NumEnemies = 0;
+};
+
+//Every enemy of a wave
+USTRUCT(BlueprintType)
+struct FPWWaveEnemies
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FPWWaveEnemyCount> Enemies;
+};
+
 UCLASS()
 class PROJECTWATER_API ADayNightActor : public AActor
 {
@@ -56,7 +87,7 @@ public:
 	int PreviousSunAngle = 0;
 
 	UPROPERTY()
-	FTimerHandle SunUpdateTimer;
+	FPWWheelTimerHandle SunUpdateTimer;
 
 	UPROPERTY()
 	float SunRotationIncrement = 0;
@@ -67,4 +98,66 @@ public:
 	UPROPERTY(BlueprintReadWrite)
 	TArray<APWLantern*> LanternArray;
 
+	//Enemies of each wave, in the order of the waves enum. Used to pre-warm the enemy pool one wave ahead
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Waves")
+	TArray<FPWWaveEnemies> EnemiesPerWave;
+
+	//Fill the enemy pool with the enemies of the next wave, spread over the next frames.
+	//Never called by the waves themselves: only a wave spawner taking its enemies from the pool with AcquireEnemy
+	//should call it, otherwise the pre-warmed enemies are never used
+	UFUNCTION(BlueprintCallable)
+	void PrewarmUpcomingWave();
+
+	//Restart the sun movement and the wave preparation after the wave and sun values were restored from a world snapshot
+	void ResumeFromSnapshot(bool bSunMoving);
+
+	//True while the sun moves to the angle of the current wave
+	bool IsSunMoving() const;
+
+	//Without the sky updates the sun still follows the waves, but the light and the sky blueprint are never touched.
+	//Used by the headless wave simulation
+	void SetSkyUpdatesEnabled(bool bEnabled);
+
+	//Assets of each wave, streamed asynchronously one wave ahead
+	UPROPERTY(EditAnywhere, Category="Waves")
+	TObjectPtr<UPWWavePhaseManifest> WavePhaseManifest;
+
+	//Return true when every asset of the next wave is loaded
+	UFUNCTION(BlueprintPure, Category="Waves")
+	bool IsUpcomingWaveReady() const;
+
+	//Loading progress of the assets of the next wave, between 0 and 1
+	UFUNCTION(BlueprintPure, Category="Waves")
+	float GetUpcomingWaveLoadProgress() const;
+
+	//Called when the assets of the next wave are loaded
+	UPROPERTY(BlueprintAssignable, Category="Waves")
+	FOnWaveAssetsReady OnUpcomingWaveAssetsReady;
+
+	//Called by NewWaveWeather with the index of the wave that starts, in the order of the waves enum
+	FOnWaveStarted OnWaveStarted;
+
+private:
+	//Start streaming the assets of the next wave and release the assets of the previous one
+	void PrefetchUpcomingWaveAssets();
+
+	//Index of the next wave in the order of the waves enum
+	int32 GetUpcomingWave() const;
+
+	//Start streaming the assets of a wave, nullptr if the wave has no asset to stream
+	TSharedPtr<FStreamableHandle> RequestWaveAssets(int32 WaveIndex);
+
+	void OnUpcomingWaveAssetsLoaded(int32 WaveIndex);
+
+	//Keeps the assets of the current wave loaded
+	TSharedPtr<FStreamableHandle> CurrentWaveAssetsHandle;
+
+	//Streams the assets of the next wave
+	TSharedPtr<FStreamableHandle> UpcomingWaveAssetsHandle;
+
+	//Wave streamed by UpcomingWaveAssetsHandle
+	int32 UpcomingWaveAssetsIndex = INDEX_NONE;
+
+	bool bSkyUpdatesEnabled = true;
+
 };
@@ -2,9 +2,13 @@
 
 
 #include "Interactor/Interactable.h"
+#include "Core/PWGameplayStats.h"
 
 #include "Engine/StaticMeshActor.h"
 #include "Characters/Player/WaterSystem/PWFountain.h"
+#include "Core/PWPhysicsQuerySchedulerSubsystem.h"
+#include "Interactor/PWPickupMagnetSubsystem.h"
+#include "Interactor/PWPickupMergeSubsystem.h"
 #include "DrawDebugHelpers.h"
 #include "NavigationSystem.h"
 
@@ -25,32 +29,162 @@ int32 AInteractable::GetAmount()
 	return InteractableAmount;
 }
 
+void AInteractable::AddAmount(int32 Amount)
+{
+	InteractableAmount += Amount;
+}
+
 void AInteractable::Interact_Implementation()
 {
 	this->Destroy();
 }
 
+void AInteractable::StartDestroyCountdown()
+{
+	if(UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>())
+	{
+		TimingWheel->SetTimer(DestroyTimer, this, &AInteractable::OnDestroyCountdownFinished, TimeBeforeDestroy);
+	}
+}
+
+float AInteractable::GetDestroyTimeRemaining() const
+{
+	const UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>();
+	return TimingWheel != nullptr && TimingWheel->IsTimerActive(DestroyTimer) ? TimingWheel->GetTimerRemaining(DestroyTimer) : -1.0f;
+}
+
+void AInteractable::RestoreFromSnapshot(int32 InInteractableId, int32 InAmount, float DestroyTimeRemaining)
+{
+	InteractableId = InInteractableId;
+	InteractableAmount = InAmount;
+
+	UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>();
+	if(TimingWheel == nullptr)
+	{
+		return;
+	}
+
+	if(DestroyTimeRemaining >= 0.0f)
+	{
+		TimingWheel->SetTimer(DestroyTimer, this, &AInteractable::OnDestroyCountdownFinished, FMath::Max(DestroyTimeRemaining, 0.01f));
+	}
+	else
+	{
+		TimingWheel->ClearTimer(DestroyTimer);
+	}
+}
+
+void AInteractable::SetPlannedSpawnDestination(const FVector& Destination)
+{
+	EndLocation = Destination;
+	bHasPlannedDestination = true;
+}
+
+bool AInteractable::IsSpawnAnimationPlaying() const
+{
+	return bHasSpawnAnimation == true && FVector::DistSquared(GetActorLocation(), EndLocation) > 1.0f;
+}
+
+void AInteractable::MoveRestingPickup(const FVector& NewLocation)
+{
+	EndLocation = NewLocation;
+	CurrentLocation = NewLocation;
+	SetActorLocation(NewLocation);
+}
+
+void AInteractable::OnDestroyCountdownFinished()
+{
+	this->Destroy();
+}
+
+void AInteractable::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	//The pickup can be taken before the end of its countdown
+	if(UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>())
+	{
+		TimingWheel->ClearTimer(DestroyTimer);
+	}
+
+	if(UPWPhysicsQuerySchedulerSubsystem* QueryScheduler = GetWorld()->GetSubsystem<UPWPhysicsQuerySchedulerSubsystem>())
+	{
+		QueryScheduler->CancelQueries(this);
+	}
+
+	if(UPWPickupMergeSubsystem* PickupMerge = GetWorld()->GetSubsystem<UPWPickupMergeSubsystem>())
+	{
+		PickupMerge->UnregisterPickup(this);
+	}
+
+	if(UPWPickupMagnetSubsystem* PickupMagnet = GetWorld()->GetSubsystem<UPWPickupMagnetSubsystem>())
+	{
+		PickupMagnet->UnregisterPickup(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called when the game starts or when spawned
 void AInteractable::BeginPlay()
 {
+	LLM_SCOPE_BYTAG(PWPickups);
+
 	Super::BeginPlay();
 
+	//Every pickup can be pulled by the magnet, the placed ones as well as the drops
+	if(UPWPickupMagnetSubsystem* PickupMagnet = GetWorld()->GetSubsystem<UPWPickupMagnetSubsystem>())
+	{
+		PickupMagnet->RegisterPickup(this);
+	}
+
 	if(bHasSpawnAnimation == true)
 	{
+		//Only the drops are merged, not the pickups placed in the level
+		if(UPWPickupMergeSubsystem* PickupMerge = GetWorld()->GetSubsystem<UPWPickupMergeSubsystem>())
+		{
+			PickupMerge->RegisterPickup(this);
+		}
+
+		//The drops disappear after TimeBeforeDestroy seconds, a blueprint calling StartDestroyCountdown again only restarts it
+		StartDestroyCountdown();
+
 		StartLocation = GetActorLocation();
 		CurrentLocation = StartLocation;
 
+		//The destination was already placed and validated with the rest of its burst
+		if(bHasPlannedDestination == true)
+		{
+			return;
+		}
+
 		//Calculate random destination around the spawned location
 		CalculateRandomDestination();
 
-		//Verify if the end destination isn't in the fountain and is valid
-		IsEndLocationInFountain();
+		//Until the sweeps are done, the candy goes toward the random destination at the default ground height
+		EndLocation.Z = GroundLocation + 15.0f;
 
-		//Get the ground Z location with a sphere trace
-		GetGroundPosition();
+		//The sweeps and the navigation test wait for the budget of the physics queries, many candies can drop on the same frame
+		if(UPWPhysicsQuerySchedulerSubsystem* QueryScheduler = GetWorld()->GetSubsystem<UPWPhysicsQuerySchedulerSubsystem>())
+		{
+			QueryScheduler->SubmitQuery(EPWPhysicsQueryPriority::Normal, this, &AInteractable::ResolveSpawnDestination);
+		}
+		else
+		{
+			ResolveSpawnDestination();
+		}
 	}
 }
 
+void AInteractable::ResolveSpawnDestination()
+{
+	PW_SCOPE_GAMEPLAY_TIME(Pickups);
+
+	//Verify if the end destination isn't in the fountain and is valid
+	IsEndLocationInFountain();
+
+	//Get the ground Z location with a sphere trace
+	GetGroundPosition();
+}
+
 void AInteractable::CalculateRandomDestination()
 {
 	// Calculate a random angle in radians
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Core/PWTimingWheelSubsystem.h"
 #include "Interactable.generated.h"
 
 UCLASS()
@@ -18,6 +19,9 @@ public:
 	int32 GetInteractableId();
 	int32 GetAmount();
 
+	//Used when identical pickups are merged into this one
+	void AddAmount(int32 Amount);
+
 	UFUNCTION(BlueprintNativeEvent)
 	void Interact();
 	
@@ -82,10 +86,42 @@ public:
 	UPROPERTY()
 	float GroundLocation = 60.0f;
 
+	//Destroy the pickup after TimeBeforeDestroy seconds, scheduled on the shared timing wheel.
+	//Started by BeginPlay for the drops, the pickups placed in the level only start it when a blueprint calls it
+	UFUNCTION(BlueprintCallable)
+	void StartDestroyCountdown();
+
+	//Seconds before the pickup is destroyed, -1 if its countdown isn't started
+	float GetDestroyTimeRemaining() const;
+
+	//Put back the state saved in a world snapshot, a negative time doesn't start the countdown
+	void RestoreFromSnapshot(int32 InInteractableId, int32 InAmount, float DestroyTimeRemaining);
+
+	//True while the pickup still moves toward the end location of its spawn animation
+	bool IsSpawnAnimationPlaying() const;
+
+	//Move a pickup that is resting, its spawn animation ends at the new location instead of bringing it back
+	void MoveRestingPickup(const FVector& NewLocation);
+
+	//Give the end location of the spawn animation before BeginPlay, the pickup then skips its own placement queries
+	void SetPlannedSpawnDestination(const FVector& Destination);
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	//Called at the end of the destroy countdown
+	UFUNCTION()
+	void OnDestroyCountdownFinished();
+
+	//Move the end location of the spawn animation out of the fountain and the props, then onto the ground
+	void ResolveSpawnDestination();
+
+	UPROPERTY()
+	FPWWheelTimerHandle DestroyTimer;
+
 	UPROPERTY(EditAnywhere,Category="Interactable Properties")
 	int32 InteractableId=0;
 
@@ -95,4 +131,7 @@ protected:
 	UPROPERTY(EditDefaultsOnly,BlueprintReadOnly,Category="Interactable Properties")
 	float TimeBeforeDestroy=10.f;
 
+	//The end location was given by a burst, see SetPlannedSpawnDestination
+	bool bHasPlannedDestination = false;
+
 };
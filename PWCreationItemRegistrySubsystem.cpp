@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Creator/Items/CreationItems/PWCreationItemRegistrySubsystem.h"
+#include "Core/PWGameplayStats.h"
+#include "Creator/CreationItem.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+
+void UPWCreationItemRegistrySubsystem::Deinitialize()
+{
+	if(ItemClassesHandle.IsValid())
+	{
+		ItemClassesHandle->CancelHandle();
+		ItemClassesHandle.Reset();
+	}
+
+	ClassesToWarm.Empty();
+	WarmInstances.Empty();
+
+	Super::Deinitialize();
+}
+
+void UPWCreationItemRegistrySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if(InWorld.IsGameWorld() == false || IsRunningDedicatedServer())
+	{
+		return;
+	}
+
+	TArray<FSoftObjectPath> ClassPaths;
+	for(const TSoftClassPtr<ACreationItem>& ItemClass : CraftableItemClasses)
+	{
+		if(ItemClass.IsNull() == false)
+		{
+			ClassPaths.AddUnique(ItemClass.ToSoftObjectPath());
+		}
+	}
+
+	if(ClassPaths.IsEmpty())
+	{
+		bClassesLoaded = true;
+		return;
+	}
+
+	//The classes load with every asset they reference, in the background while the level finishes loading
+	ItemClassesHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(ClassPaths,
+		FStreamableDelegate::CreateUObject(this, &UPWCreationItemRegistrySubsystem::OnItemClassesLoaded),
+		FStreamableManager::AsyncLoadHighPriority);
+}
+
+TStatId UPWCreationItemRegistrySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWCreationItemRegistrySubsystem, STATGROUP_Tickables);
+}
+
+void UPWCreationItemRegistrySubsystem::OnItemClassesLoaded()
+{
+	for(const TSoftClassPtr<ACreationItem>& ItemClass : CraftableItemClasses)
+	{
+		if(UClass* LoadedClass = ItemClass.Get())
+		{
+			ClassesToWarm.AddUnique(LoadedClass);
+		}
+		else if(ItemClass.IsNull() == false)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Creation item registry: can't load %s"), *ItemClass.ToString());
+		}
+	}
+
+	bClassesLoaded = true;
+}
+
+void UPWCreationItemRegistrySubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if(bClassesLoaded == false || ClassesToWarm.IsEmpty())
+	{
+		return;
+	}
+
+	//A few classes per frame, the warm-up is the hitch the first craft would have had
+	const int32 NumWarmups = FMath::Min(MaxWarmupsPerFrame, ClassesToWarm.Num());
+	for(int32 i = 0; i < NumWarmups; i++)
+	{
+		WarmItemClass(ClassesToWarm.Pop());
+	}
+
+	if(ClassesToWarm.IsEmpty())
+	{
+		UE_LOG(LogTemp, Log, TEXT("Creation item registry: %d creation items loaded and warm"), WarmInstances.Num());
+		OnCreationItemsReady.Broadcast();
+	}
+}
+
+void UPWCreationItemRegistrySubsystem::WarmItemClass(UClass* ItemClass)
+{
+	LLM_SCOPE_BYTAG(PWRockets);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	//Deferred, the native components are created and registered with their render state and physics bodies,
+	//but the construction script and BeginPlay never run so the item never does anything
+	const FTransform WarmTransform(WarmLocation);
+	ACreationItem* WarmInstance = GetWorld()->SpawnActorDeferred<ACreationItem>(ItemClass, WarmTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if(WarmInstance == nullptr)
+	{
+		return;
+	}
+
+	WarmInstance->SetActorEnableCollision(false);
+	WarmInstance->SetActorHiddenInGame(true);
+	WarmInstance->SetActorTickEnabled(false);
+	WarmInstances.Add(ItemClass, WarmInstance);
+
+	UE_LOG(LogTemp, Verbose, TEXT("Creation item registry: %s warmed in %.2f ms"), *ItemClass->GetName(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+bool UPWCreationItemRegistrySubsystem::IsItemReady(TSubclassOf<ACreationItem> ItemClass) const
+{
+	const TObjectPtr<ACreationItem>* WarmInstance = ItemClass != nullptr ? WarmInstances.Find(ItemClass.Get()) : nullptr;
+	return WarmInstance != nullptr && IsValid(*WarmInstance);
+}
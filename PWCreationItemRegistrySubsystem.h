@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PWCreationItemRegistrySubsystem.generated.h"
+
+class ACreationItem;
+struct FStreamableHandle;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnCreationItemsReady);
+
+/**
+ * Loads and pre-warms every craftable creation item while the level loads, so the first craft costs as much as the next ones.
+ * The classes are streamed asynchronously with the assets they reference, then one warm instance of each class is
+ * spawned a frame at a time far below the level. The warm instance never finishes spawning: no construction script,
+ * no BeginPlay and no gameplay. Only its native components are created and registered, with their render state and
+ * physics bodies; the Blueprint components are made by the construction script, their assets are only kept loaded.
+ * It stays hidden without collision for the rest of the level. As it is never initialized, the code that iterates
+ * the creation items of the world skips the actors for which IsActorInitialized() is false.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWCreationItemRegistrySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//True once the class is loaded and its warm instance spawned and still alive
+	UFUNCTION(BlueprintPure, Category="Creation Items")
+	bool IsItemReady(TSubclassOf<ACreationItem> ItemClass) const;
+
+	UFUNCTION(BlueprintPure, Category="Creation Items")
+	bool AreAllItemsReady() const { return bClassesLoaded && ClassesToWarm.IsEmpty(); }
+
+	//Called once every craftable item is loaded and warm
+	UPROPERTY(BlueprintAssignable, Category="Creation Items")
+	FOnCreationItemsReady OnCreationItemsReady;
+
+	//Every creation item the players can craft
+	UPROPERTY(Config)
+	TArray<TSoftClassPtr<ACreationItem>> CraftableItemClasses;
+
+	//Warm instances spawned each frame once the classes are loaded
+	UPROPERTY(Config)
+	int32 MaxWarmupsPerFrame = 1;
+
+	//Where the warm instances wait
+	UPROPERTY(Config)
+	FVector WarmLocation = FVector(0.0f, 0.0f, -100000.0f);
+
+private:
+	void OnItemClassesLoaded();
+
+	//Spawn the hidden warm instance of a class
+	void WarmItemClass(UClass* ItemClass);
+
+	//Keeps the classes and their assets loaded
+	TSharedPtr<FStreamableHandle> ItemClassesHandle;
+
+	UPROPERTY()
+	TArray<TObjectPtr<UClass>> ClassesToWarm;
+
+	UPROPERTY()
+	TMap<TObjectPtr<UClass>, TObjectPtr<ACreationItem>> WarmInstances;
+
+	bool bClassesLoaded = false;
+};
@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Characters/Enemies/Mass/PWEnemyFlyingMovementProcessor.h"
+#include "Core/PWGameplayStats.h"
+#include "MassCommonFragments.h"
+#include "MassExecutionContext.h"
+#include "Characters/Enemies/Mass/PWEnemyMassFragments.h"
+#include "Characters/Enemies/Mass/PWEnemyRepresentationSubsystem.h"
+#include "Creator/Items/CreationItems/PWGravityFieldSubsystem.h"
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+
+namespace PWEnemyFlyingMovement
+{
+	//Same gravity as the character movement component
+	constexpr float GravityZ = -980.0f;
+}
+
+UPWEnemyFlyingMovementProcessor::UPWEnemyFlyingMovementProcessor()
+{
+	bAutoRegisterWithProcessingPhases = true;
+	//The enemies only exist as entities on the server, and never in the editor worlds
+	ExecutionFlags = static_cast<int32>(EProcessorExecutionFlags::Server | EProcessorExecutionFlags::Standalone);
+	ProcessingPhase = EMassProcessingPhase::PrePhysics;
+}
+
+void UPWEnemyFlyingMovementProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FPWEnemyFlyingFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FPWEnemySourceFragment>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.RegisterWithProcessor(*this);
+}
+
+void UPWEnemyFlyingMovementProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	PW_SCOPE_GAMEPLAY_TIME(MassEnemies);
+
+	const UWorld* World = EntityManager.GetWorld();
+	if(World == nullptr)
+	{
+		return;
+	}
+
+	//Copy the zones and the targets once for the whole batch
+	TArray<FPWGravityZoneInfo> ActiveZones;
+	if(const UPWGravityZoneSubsystem* GravityZoneSubsystem = World->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		ActiveZones = GravityZoneSubsystem->GetActiveZones();
+	}
+
+	//Same field as the characters when the continuous gravity field is enabled
+	const bool bFieldMode = UPWGravityFieldSubsystem::IsFieldModeEnabled();
+	FPWGravityFieldSettings FieldSettings;
+	if(const UPWGravityFieldSubsystem* GravityFieldSubsystem = World->GetSubsystem<UPWGravityFieldSubsystem>())
+	{
+		FieldSettings = GravityFieldSubsystem->FieldSettings;
+	}
+
+	TArray<FVector> PlayerLocations;
+	if(const UPWEnemyRepresentationSubsystem* RepresentationSubsystem = World->GetSubsystem<UPWEnemyRepresentationSubsystem>())
+	{
+		PlayerLocations = RepresentationSubsystem->GetPlayerLocations();
+	}
+
+	EntityQuery.ForEachEntityChunk(EntityManager, Context, [&ActiveZones, &PlayerLocations, bFieldMode, &FieldSettings](FMassExecutionContext& ChunkContext)
+	{
+		const float DeltaTime = ChunkContext.GetDeltaTimeSeconds();
+		const TArrayView<FTransformFragment> Transforms = ChunkContext.GetMutableFragmentView<FTransformFragment>();
+		const TArrayView<FPWEnemyFlyingFragment> FlyingFragments = ChunkContext.GetMutableFragmentView<FPWEnemyFlyingFragment>();
+		const TConstArrayView<FPWEnemySourceFragment> SourceFragments = ChunkContext.GetFragmentView<FPWEnemySourceFragment>();
+
+		for(int32 EntityIndex = 0; EntityIndex < ChunkContext.GetNumEntities(); ++EntityIndex)
+		{
+			FTransform& Transform = Transforms[EntityIndex].GetMutableTransform();
+			FPWEnemyFlyingFragment& Flying = FlyingFragments[EntityIndex];
+			FVector Location = Transform.GetLocation();
+
+			if(bFieldMode == true)
+			{
+				//Float and land with a hysteresis on the strength, the speed and gravity follow the strength
+				const FPWGravityFieldSample Sample = UPWGravityFieldSubsystem::SampleField(ActiveZones, Location, SourceFragments[EntityIndex].EnemyClass.Get(), false, FieldSettings);
+				if(Flying.bIsInGravityZone == false && Sample.Strength >= FieldSettings.FloatThreshold)
+				{
+					Flying.bIsInGravityZone = true;
+				}
+				else if(Flying.bIsInGravityZone == true && Sample.Strength < FieldSettings.LandThreshold)
+				{
+					Flying.bIsInGravityZone = false;
+					Flying.Velocity.Z = 10.0f;
+				}
+				Flying.GravityZoneSpeed = FMath::Lerp(Flying.WalkSpeed, Sample.ZoneSpeed, Sample.Strength);
+				Flying.GravityScale = FMath::Lerp(1.0f, Sample.GravityScale, Sample.Strength);
+				Flying.NbRocketOverlappingCounter = Sample.NumZones;
+			}
+			else
+			{
+				//Count the zones containing the entity, like the begin and end overlaps of the rockets do for the characters
+				int32 NbZones = 0;
+				const FPWGravityZoneInfo* LastZone = nullptr;
+				for(const FPWGravityZoneInfo& Zone : ActiveZones)
+				{
+					if(Zone.Contains(Location) && Zone.CanAffectEnemyClass(SourceFragments[EntityIndex].EnemyClass.Get()))
+					{
+						++NbZones;
+						LastZone = &Zone;
+					}
+				}
+
+				if(NbZones > 0 && Flying.bIsInGravityZone == false)
+				{
+					//Start to float with the settings of the zone
+					Flying.bIsInGravityZone = true;
+					Flying.GravityZoneSpeed = LastZone->EnemyGravityZoneSpeed;
+					Flying.GravityScale = LastZone->EnemyGravityScale;
+				}
+				else if(NbZones == 0 && Flying.bIsInGravityZone == true)
+				{
+					//Stop floating and fall back to the ground
+					Flying.bIsInGravityZone = false;
+					Flying.Velocity.Z = 10.0f;
+					Flying.GravityScale = 1.0f;
+				}
+				Flying.NbRocketOverlappingCounter = NbZones;
+			}
+
+			//Move toward the closest player
+			FVector ClosestPlayerLocation = Location;
+			double ClosestDistanceSquared = TNumericLimits<double>::Max();
+			for(const FVector& PlayerLocation : PlayerLocations)
+			{
+				const double DistanceSquared = FVector::DistSquared(Location, PlayerLocation);
+				if(DistanceSquared < ClosestDistanceSquared)
+				{
+					ClosestDistanceSquared = DistanceSquared;
+					ClosestPlayerLocation = PlayerLocation;
+				}
+			}
+
+			if(Flying.bIsInGravityZone == true)
+			{
+				//Floating: full 3D steering at the zone speed, the gravity scale of the zones is too small to matter here
+				const FVector Direction = (ClosestPlayerLocation - Location).GetSafeNormal();
+				Flying.Velocity = Direction * Flying.GravityZoneSpeed;
+			}
+			else
+			{
+				//Walking: horizontal steering, gravity brings the entity back to its ground
+				const FVector Direction = (ClosestPlayerLocation - Location).GetSafeNormal2D();
+				const float VerticalVelocity = Flying.Velocity.Z + PWEnemyFlyingMovement::GravityZ * DeltaTime;
+				Flying.Velocity = Direction * Flying.WalkSpeed;
+				Flying.Velocity.Z = VerticalVelocity;
+			}
+
+			Location += Flying.Velocity * DeltaTime;
+			if(Location.Z < Flying.GroundZ)
+			{
+				Location.Z = Flying.GroundZ;
+				Flying.Velocity.Z = 0.0f;
+			}
+
+			Transform.SetLocation(Location);
+		}
+	});
+}
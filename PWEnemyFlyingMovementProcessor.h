@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassProcessor.h"
+#include "PWEnemyFlyingMovementProcessor.generated.h"
+
+/**
+ * Batched movement of the enemies simulated as mass entities.
+ * Applies the active rocket gravity zones exactly like APW_RocketCreation does for the enemy characters
+ * (zone counter, floating speed and gravity scale), then moves every entity toward the closest player.
+ */
+UCLASS()
+class PROJECTWATER_API UPWEnemyFlyingMovementProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UPWEnemyFlyingMovementProcessor();
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+	FMassEntityQuery EntityQuery;
+};
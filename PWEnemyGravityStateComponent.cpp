@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Characters/Enemies/PWEnemyGravityStateComponent.h"
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+
+UPWEnemyGravityStateComponent::UPWEnemyGravityStateComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+UPWEnemyGravityStateComponent* UPWEnemyGravityStateComponent::FindGravityState(const AActor* Enemy)
+{
+	return Enemy != nullptr ? Enemy->FindComponentByClass<UPWEnemyGravityStateComponent>() : nullptr;
+}
+
+void UPWEnemyGravityStateComponent::EnterGravityZone()
+{
+	TransitionTo(EPWEnemyGravityState::Floating);
+}
+
+void UPWEnemyGravityStateComponent::LeaveGravityZone()
+{
+	TransitionTo(EPWEnemyGravityState::Landing);
+}
+
+void UPWEnemyGravityStateComponent::FinishLanding()
+{
+	TransitionTo(EPWEnemyGravityState::Grounded);
+}
+
+void UPWEnemyGravityStateComponent::ResetToGrounded()
+{
+	//Skip the transition check, the pool can take an enemy in any state
+	if(GravityState != EPWEnemyGravityState::Grounded)
+	{
+		const EPWEnemyGravityState OldState = GravityState;
+		GravityState = EPWEnemyGravityState::Grounded;
+
+		UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>();
+		if(GravityZoneSubsystem != nullptr)
+		{
+			GravityZoneSubsystem->RemoveFloatingEnemy(this);
+		}
+
+		OnGravityStateChanged.Broadcast(this, OldState, GravityState);
+		if(GravityZoneSubsystem != nullptr)
+		{
+			GravityZoneSubsystem->OnEnemyGravityStateChanged.Broadcast(this, OldState, GravityState);
+		}
+	}
+}
+
+void UPWEnemyGravityStateComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		GravityZoneSubsystem->RemoveFloatingEnemy(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool UPWEnemyGravityStateComponent::CanTransition(EPWEnemyGravityState From, EPWEnemyGravityState To)
+{
+	switch (From)
+	{
+		case EPWEnemyGravityState::Grounded:
+			return To == EPWEnemyGravityState::Floating;
+		case EPWEnemyGravityState::Floating:
+			return To == EPWEnemyGravityState::Landing;
+		case EPWEnemyGravityState::Landing:
+			return To == EPWEnemyGravityState::Grounded || To == EPWEnemyGravityState::Floating;
+		default:
+			return false;
+	}
+}
+
+void UPWEnemyGravityStateComponent::TransitionTo(EPWEnemyGravityState NewState)
+{
+	if(NewState == GravityState)
+	{
+		return;
+	}
+
+	if(CanTransition(GravityState, NewState) == false)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: invalid gravity state transition from %s to %s"), *GetNameSafe(GetOwner()),
+			*UEnum::GetValueAsString(GravityState), *UEnum::GetValueAsString(NewState));
+		return;
+	}
+
+	const EPWEnemyGravityState OldState = GravityState;
+	GravityState = NewState;
+
+	//Keep the dense list of the floating enemies up to date
+	UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>();
+	if(GravityZoneSubsystem != nullptr)
+	{
+		if(NewState == EPWEnemyGravityState::Floating)
+		{
+			GravityZoneSubsystem->AddFloatingEnemy(this);
+		}
+		else
+		{
+			GravityZoneSubsystem->RemoveFloatingEnemy(this);
+		}
+	}
+
+	OnGravityStateChanged.Broadcast(this, OldState, NewState);
+	if(GravityZoneSubsystem != nullptr)
+	{
+		GravityZoneSubsystem->OnEnemyGravityStateChanged.Broadcast(this, OldState, NewState);
+	}
+}
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PWEnemyGravityStateComponent.generated.h"
+
+//Gravity state of an enemy, see UPWEnemyGravityStateComponent for the allowed transitions
+UENUM(BlueprintType)
+enum class EPWEnemyGravityState : uint8
+{
+	//Walking with the normal gravity
+	Grounded,
+	//Floating in at least one gravity zone
+	Floating,
+	//Left its last gravity zone, waiting for the path request queue to give back the ground behavior
+	Landing
+};
+
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnEnemyGravityStateChanged, class UPWEnemyGravityStateComponent* /*Component*/, EPWEnemyGravityState /*OldState*/, EPWEnemyGravityState /*NewState*/);
+
+/**
+ * Gravity state of an enemy. Added once to every enemy by UPWGravityZoneSubsystem, which keeps the dense list of the
+ * floating enemies up to date from the transitions.
+ * Grounded -> Floating -> Landing -> Grounded, a landing enemy can float again, and any state can be reset to Grounded.
+ */
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class PROJECTWATER_API UPWEnemyGravityStateComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPWEnemyGravityStateComponent();
+
+	//Gravity state of an enemy, nullptr if the actor doesn't have one
+	static UPWEnemyGravityStateComponent* FindGravityState(const AActor* Enemy);
+
+	UFUNCTION(BlueprintPure, Category="Gravity")
+	EPWEnemyGravityState GetGravityState() const { return GravityState; }
+
+	UFUNCTION(BlueprintPure, Category="Gravity")
+	bool IsFloating() const { return GravityState == EPWEnemyGravityState::Floating; }
+
+	//The enemy starts floating in a gravity zone
+	void EnterGravityZone();
+
+	//The enemy left its last gravity zone and waits to get back its ground behavior
+	void LeaveGravityZone();
+
+	//The enemy got back its ground behavior
+	void FinishLanding();
+
+	//Back to the ground state whatever the current state, used when the enemy is pooled
+	void ResetToGrounded();
+
+	//Index of the enemy in the floating list of UPWGravityZoneSubsystem, INDEX_NONE when not floating
+	int32 FloatingIndex = INDEX_NONE;
+
+	FOnEnemyGravityStateChanged OnGravityStateChanged;
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	static bool CanTransition(EPWEnemyGravityState From, EPWEnemyGravityState To);
+
+	void TransitionTo(EPWEnemyGravityState NewState);
+
+	UPROPERTY(VisibleInstanceOnly, Category="Gravity")
+	EPWEnemyGravityState GravityState = EPWEnemyGravityState::Grounded;
+};
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "PWEnemyMassFragments.generated.h"
+
+class APWEnemyCharacter;
+
+//Movement state of an enemy simulated as a mass entity, mirrors the character movement of APWEnemyCharacter
+USTRUCT()
+struct PROJECTWATER_API FPWEnemyFlyingFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector Velocity = FVector::ZeroVector;
+
+	//Walking speed of the enemy outside the gravity zones
+	UPROPERTY()
+	float WalkSpeed = 300.0f;
+
+	//Height of the ground under the enemy when it was demoted, the entity never goes below it
+	UPROPERTY()
+	float GroundZ = 0.0f;
+
+	//Same meaning as on APWEnemyCharacter, updated from the active zones every frame
+	UPROPERTY()
+	int32 NbRocketOverlappingCounter = 0;
+
+	UPROPERTY()
+	bool bIsInGravityZone = false;
+
+	//Speed and gravity scale of the zone the entity is floating in
+	UPROPERTY()
+	float GravityZoneSpeed = 0.0f;
+
+	UPROPERTY()
+	float GravityScale = 1.0f;
+};
+
+//What is needed to promote the entity back to a full enemy character
+USTRUCT()
+struct PROJECTWATER_API FPWEnemySourceFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TSubclassOf<APWEnemyCharacter> EnemyClass;
+};
@@ -0,0 +1,256 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Characters/Enemies/PWEnemyPoolSubsystem.h"
+#include "Core/PWGameplayStats.h"
+#include "AIController.h"
+#include "BrainComponent.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "Characters/Enemies/PWEnemyGravityStateComponent.h"
+#include "Characters/Enemies/PWEnemyMovementComponent.h"
+#include "Characters/Enemies/PWPooledEnemyInterface.h"
+#include "Characters/Enemies/Controllers/BlackboardKeys.h"
+#include "Characters/Enemies/Controllers/PWEnemyController.h"
+
+namespace PWEnemyPool
+{
+	//Reason given to the behavior tree when its logic is paused by the pool
+	const FString PooledLogicReason = TEXT("Enemy pooled");
+}
+
+void UPWEnemyPoolSubsystem::Deinitialize()
+{
+	Pools.Empty();
+	PooledEnemies.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UPWEnemyPoolSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWEnemyPoolSubsystem, STATGROUP_Tickables);
+}
+
+void UPWEnemyPoolSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	PW_SCOPE_GAMEPLAY_TIME(EnemyPool);
+
+	//Spawn a few enemies per frame for the pools that are being pre-warmed
+	int32 NumSpawnsLeft = MaxPrewarmSpawnsPerFrame;
+	for(TPair<TSubclassOf<APWEnemyCharacter>, FPWEnemyPool>& Pool : Pools)
+	{
+		while(Pool.Value.NumToPrewarm > 0 && NumSpawnsLeft > 0)
+		{
+			--Pool.Value.NumToPrewarm;
+			--NumSpawnsLeft;
+
+			if(APWEnemyCharacter* Enemy = SpawnPooledEnemy(Pool.Key))
+			{
+				Pool.Value.InactiveEnemies.Add(Enemy);
+				PooledEnemies.Add(Enemy);
+			}
+		}
+
+		if(NumSpawnsLeft == 0)
+		{
+			return;
+		}
+	}
+}
+
+void UPWEnemyPoolSubsystem::PrewarmPool(TSubclassOf<APWEnemyCharacter> EnemyClass, int32 NumEnemies)
+{
+	if(EnemyClass == nullptr)
+	{
+		return;
+	}
+
+	FPWEnemyPool& Pool = Pools.FindOrAdd(EnemyClass);
+	Pool.NumToPrewarm = FMath::Max(Pool.NumToPrewarm, NumEnemies - Pool.InactiveEnemies.Num());
+}
+
+APWEnemyCharacter* UPWEnemyPoolSubsystem::SpawnPooledEnemy(TSubclassOf<APWEnemyCharacter> EnemyClass)
+{
+	LLM_SCOPE_BYTAG(PWEnemies);
+
+	//Spawn without collision so the pooled enemy never overlaps anything
+	const FTransform PoolTransform(PoolLocation);
+	APWEnemyCharacter* Enemy = GetWorld()->SpawnActorDeferred<APWEnemyCharacter>(EnemyClass, PoolTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if(Enemy == nullptr)
+	{
+		return nullptr;
+	}
+
+	Enemy->SetActorEnableCollision(false);
+	Enemy->FinishSpawning(PoolTransform);
+
+	//The controller and its behavior tree are created once and kept alive with the pawn
+	if(Enemy->GetController() == nullptr)
+	{
+		Enemy->SpawnDefaultController();
+	}
+
+	DeactivateEnemy(Enemy);
+	return Enemy;
+}
+
+void UPWEnemyPoolSubsystem::DeactivateEnemy(APWEnemyCharacter* Enemy) const
+{
+	//Disable the collision first, the rockets still containing the enemy receive their end overlap normally
+	Enemy->SetActorEnableCollision(false);
+	Enemy->SetActorHiddenInGame(true);
+	Enemy->SetActorTickEnabled(false);
+
+	if(UCharacterMovementComponent* MovementComponent = Enemy->GetCharacterMovement())
+	{
+		MovementComponent->StopMovementImmediately();
+		MovementComponent->Deactivate();
+	}
+
+	if(AAIController* AIController = Cast<AAIController>(Enemy->GetController()))
+	{
+		AIController->StopMovement();
+		if(UBrainComponent* BrainComponent = AIController->GetBrainComponent())
+		{
+			BrainComponent->PauseLogic(PWEnemyPool::PooledLogicReason);
+		}
+	}
+
+	Enemy->SetActorLocation(PoolLocation, false, nullptr, ETeleportType::ResetPhysics);
+}
+
+void UPWEnemyPoolSubsystem::ResetEnemyState(APWEnemyCharacter* Enemy)
+{
+	//Same default state as when an enemy leaves its last gravity zone
+	if(UPWEnemyMovementComponent* MovementComponent = Cast<UPWEnemyMovementComponent>(Enemy->GetCharacterMovement()))
+	{
+		MovementComponent->Velocity = FVector::ZeroVector;
+		MovementComponent->SetUseAccelerationForPaths(true);
+		MovementComponent->SetMovementMode(EMovementMode::MOVE_Walking);
+		MovementComponent->MaxWalkSpeed = Enemy->GetMovementSpeed();
+		MovementComponent->GravityScale = 1.0f;
+		MovementComponent->AirControl = 0.2f;
+	}
+
+	Enemy->setNumberOfOverlappingRocket(0);
+	Enemy->bIsInGravityZone = false;
+	Enemy->SetIfEnemyAlreadyInsideRocketZone(false);
+
+	if(UPWEnemyGravityStateComponent* GravityState = UPWEnemyGravityStateComponent::FindGravityState(Enemy))
+	{
+		GravityState->ResetToGrounded();
+	}
+
+	if(const APWEnemyController* AIController = Cast<APWEnemyController>(Enemy->GetController()); AIController != nullptr && AIController->GetBlackboard() != nullptr)
+	{
+		AIController->GetBlackboard()->SetValueAsBool(BBKeys::GravityEnabled, false);
+	}
+}
+
+APWEnemyCharacter* UPWEnemyPoolSubsystem::AcquireEnemy(TSubclassOf<APWEnemyCharacter> EnemyClass, const FTransform& SpawnTransform)
+{
+	LLM_SCOPE_BYTAG(PWEnemies);
+
+	if(EnemyClass == nullptr)
+	{
+		return nullptr;
+	}
+
+	//Take the last inactive enemy still alive, or spawn a new one if the pool is empty
+	APWEnemyCharacter* Enemy = nullptr;
+	if(FPWEnemyPool* Pool = Pools.Find(EnemyClass))
+	{
+		while(Enemy == nullptr && Pool->InactiveEnemies.Num() > 0)
+		{
+			Enemy = Pool->InactiveEnemies.Pop();
+			if(IsValid(Enemy) == false)
+			{
+				Enemy = nullptr;
+			}
+		}
+	}
+
+	if(Enemy == nullptr)
+	{
+		Enemy = SpawnPooledEnemy(EnemyClass);
+		if(Enemy == nullptr)
+		{
+			return nullptr;
+		}
+	}
+	PooledEnemies.Remove(Enemy);
+
+	ResetEnemyState(Enemy);
+
+	Enemy->SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+	Enemy->SetActorHiddenInGame(false);
+	Enemy->SetActorTickEnabled(true);
+
+	if(UCharacterMovementComponent* MovementComponent = Enemy->GetCharacterMovement())
+	{
+		MovementComponent->Activate(true);
+	}
+
+	//The state of the previous life that only the enemy knows, like its health
+	if(Enemy->Implements<UPWPooledEnemyInterface>())
+	{
+		IPWPooledEnemyInterface::Execute_OnAcquiredFromPool(Enemy);
+	}
+
+	//Enable the collision last, the rockets containing the spawn location make the enemy float with their begin overlap
+	Enemy->SetActorEnableCollision(true);
+
+	if(AAIController* AIController = Cast<AAIController>(Enemy->GetController()))
+	{
+		//The target of the previous life is forgotten, and the tree starts again from its root instead of resuming
+		//where it was paused on release
+		if(UBlackboardComponent* Blackboard = AIController->GetBlackboardComponent())
+		{
+			Blackboard->ClearValue(BBKeys::TargetActor);
+		}
+
+		if(UBrainComponent* BrainComponent = AIController->GetBrainComponent())
+		{
+			BrainComponent->ResumeLogic(PWEnemyPool::PooledLogicReason);
+			BrainComponent->RestartLogic();
+		}
+	}
+
+	return Enemy;
+}
+
+void UPWEnemyPoolSubsystem::ReleaseEnemy(APWEnemyCharacter* Enemy)
+{
+	if(IsValid(Enemy) == false || PooledEnemies.Contains(Enemy))
+	{
+		return;
+	}
+
+	DeactivateEnemy(Enemy);
+	ResetEnemyState(Enemy);
+
+	Pools.FindOrAdd(Enemy->GetClass()).InactiveEnemies.Add(Enemy);
+	PooledEnemies.Add(Enemy);
+}
+
+bool UPWEnemyPoolSubsystem::IsPooled(const APWEnemyCharacter* Enemy) const
+{
+	return PooledEnemies.Contains(Enemy);
+}
+
+int32 UPWEnemyPoolSubsystem::GetNumInactiveEnemies() const
+{
+	return PooledEnemies.Num();
+}
+
+SIZE_T UPWEnemyPoolSubsystem::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = Pools.GetAllocatedSize() + PooledEnemies.GetAllocatedSize();
+	for(const TPair<TSubclassOf<APWEnemyCharacter>, FPWEnemyPool>& Pool : Pools)
+	{
+		AllocatedSize += Pool.Value.InactiveEnemies.GetAllocatedSize();
+	}
+	return AllocatedSize;
+}
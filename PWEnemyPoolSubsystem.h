@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "PWEnemyPoolSubsystem.generated.h"
+
+class APWEnemyCharacter;
+
+//Inactive enemies of one class, kept with their controller and behavior tree
+USTRUCT()
+struct FPWEnemyPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TObjectPtr<APWEnemyCharacter>> InactiveEnemies;
+
+	//Enemies still to spawn to reach the requested pool size
+	UPROPERTY()
+	int32 NumToPrewarm = 0;
+};
+
+/**
+ * Pool of enemy characters kept alive between the waves.
+ * A released enemy keeps its AI controller and its behavior tree component, it is hidden, its collision, tick and
+ * logic are paused, and its movement and gravity zone state are reset when it is acquired again. Its behavior tree
+ * restarts from the root, and the enemies implementing IPWPooledEnemyInterface reset the rest of their state.
+ * The pool can be pre-warmed a few enemies per frame before the wave that needs them.
+ * The wave spawner and the death of the enemies live in blueprints outside of this module: they only benefit from
+ * the pool once they call AcquireEnemy and ReleaseEnemy instead of spawning and destroying the enemies, and only
+ * then should the spawner pre-warm the pool with ADayNightActor::PrewarmUpcomingWave.
+ * The replays, the snapshots, the wave simulation and the mass representation already go through the pool.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWEnemyPoolSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Take an enemy from the pool and place it, spawns a new one if the pool of this class is empty
+	UFUNCTION(BlueprintCallable, Category="Enemy Pool")
+	APWEnemyCharacter* AcquireEnemy(TSubclassOf<APWEnemyCharacter> EnemyClass, const FTransform& SpawnTransform);
+
+	//Give an enemy back to the pool instead of destroying it
+	UFUNCTION(BlueprintCallable, Category="Enemy Pool")
+	void ReleaseEnemy(APWEnemyCharacter* Enemy);
+
+	//Make sure the pool of this class holds at least this many inactive enemies, spawned over the next frames
+	UFUNCTION(BlueprintCallable, Category="Enemy Pool")
+	void PrewarmPool(TSubclassOf<APWEnemyCharacter> EnemyClass, int32 NumEnemies);
+
+	//Return true if the enemy is inactive inside the pool
+	bool IsPooled(const APWEnemyCharacter* Enemy) const;
+
+	int32 GetNumInactiveEnemies() const;
+
+	//Bytes allocated by the pools
+	SIZE_T GetAllocatedSize() const;
+
+	//Put back the default movement and gravity zone state of an enemy
+	static void ResetEnemyState(APWEnemyCharacter* Enemy);
+
+	//Maximum number of enemies spawned each frame while pre-warming
+	UPROPERTY(Config)
+	int32 MaxPrewarmSpawnsPerFrame = 4;
+
+	//Where the inactive enemies wait
+	UPROPERTY(Config)
+	FVector PoolLocation = FVector(0.0f, 0.0f, -100000.0f);
+
+private:
+	//Spawn an inactive enemy directly inside the pool
+	APWEnemyCharacter* SpawnPooledEnemy(TSubclassOf<APWEnemyCharacter> EnemyClass);
+
+	//Hide and pause an enemy
+	void DeactivateEnemy(APWEnemyCharacter* Enemy) const;
+
+	UPROPERTY()
+	TMap<TSubclassOf<APWEnemyCharacter>, FPWEnemyPool> Pools;
+
+	//Inactive enemies, for the fast IsPooled check
+	TSet<TObjectKey<APWEnemyCharacter>> PooledEnemies;
+};
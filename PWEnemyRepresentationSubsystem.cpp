@@ -0,0 +1,268 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Characters/Enemies/Mass/PWEnemyRepresentationSubsystem.h"
+#include "Core/PWGameplayStats.h"
+#include "EngineUtils.h"
+#include "MassCommonFragments.h"
+#include "MassEntitySubsystem.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "Characters/Enemies/PWEnemyPoolSubsystem.h"
+#include "Characters/Enemies/Mass/PWEnemyMassFragments.h"
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+
+static TAutoConsoleVariable<int32> CVarEnemyMassRepresentation(
+	TEXT("pw.Enemies.MassRepresentation"),
+	0,
+	TEXT("1 to simulate the distant enemies and the enemies floating away from the players as mass entities."),
+	ECVF_Default);
+
+bool UPWEnemyRepresentationSubsystem::IsMassRepresentationEnabled()
+{
+	return CVarEnemyMassRepresentation.GetValueOnGameThread() != 0;
+}
+
+void UPWEnemyRepresentationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Collection.InitializeDependency<UMassEntitySubsystem>();
+	Collection.InitializeDependency<UPWEnemyPoolSubsystem>();
+	Super::Initialize(Collection);
+}
+
+void UPWEnemyRepresentationSubsystem::Deinitialize()
+{
+	MassEnemies.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UPWEnemyRepresentationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWEnemyRepresentationSubsystem, STATGROUP_Tickables);
+}
+
+void UPWEnemyRepresentationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	PW_SCOPE_GAMEPLAY_TIME(MassEnemies);
+
+	PlayerLocations.Reset();
+	for(FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if(const APlayerController* PlayerController = It->Get(); PlayerController != nullptr && PlayerController->GetPawn() != nullptr)
+		{
+			PlayerLocations.Add(PlayerController->GetPawn()->GetActorLocation());
+		}
+	}
+
+	//The entities are always promoted, even when the mode is turned off, so they come back as characters
+	PromoteNearEntities();
+
+	if(IsMassRepresentationEnabled() == false || PlayerLocations.IsEmpty())
+	{
+		return;
+	}
+
+	TimeSinceLastScan += DeltaTime;
+	if(TimeSinceLastScan >= ScanInterval)
+	{
+		TimeSinceLastScan = 0.0f;
+		DemoteDistantEnemies();
+	}
+}
+
+double UPWEnemyRepresentationSubsystem::GetClosestPlayerDistanceSquared(const FVector& Location) const
+{
+	double ClosestDistanceSquared = TNumericLimits<double>::Max();
+	for(const FVector& PlayerLocation : PlayerLocations)
+	{
+		ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared, FVector::DistSquared(Location, PlayerLocation));
+	}
+	return ClosestDistanceSquared;
+}
+
+void UPWEnemyRepresentationSubsystem::DemoteDistantEnemies()
+{
+	//Gather the candidates first, the demotion destroys the actors
+	const UPWEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UPWEnemyPoolSubsystem>();
+	TArray<APWEnemyCharacter*> EnemiesToDemote;
+
+	//The floating enemies come from the dense list of the gravity zones, they are demoted at their own distance
+	if(const UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		for(APWEnemyCharacter* EnemyCharacter : GravityZoneSubsystem->GetFloatingEnemies())
+		{
+			if(EnemiesToDemote.Num() >= MaxTransitionsPerFrame)
+			{
+				break;
+			}
+
+			if(EnemyCharacter != nullptr && EnemyCharacter->IsPendingKillPending() == false
+				&& GetClosestPlayerDistanceSquared(EnemyCharacter->GetActorLocation()) > FMath::Square(InGravityZoneDemoteDistance))
+			{
+				EnemiesToDemote.Add(EnemyCharacter);
+			}
+		}
+	}
+
+	for(TActorIterator<APWEnemyCharacter> It(GetWorld()); It && EnemiesToDemote.Num() < MaxTransitionsPerFrame; ++It)
+	{
+		APWEnemyCharacter* EnemyCharacter = *It;
+		if(EnemyCharacter->bIsInGravityZone || EnemyCharacter->IsPendingKillPending() || (EnemyPool != nullptr && EnemyPool->IsPooled(EnemyCharacter)))
+		{
+			continue;
+		}
+
+		if(GetClosestPlayerDistanceSquared(EnemyCharacter->GetActorLocation()) > FMath::Square(DemoteDistance))
+		{
+			EnemiesToDemote.Add(EnemyCharacter);
+		}
+	}
+
+	for(APWEnemyCharacter* EnemyCharacter : EnemiesToDemote)
+	{
+		DemoteEnemy(EnemyCharacter);
+	}
+}
+
+void UPWEnemyRepresentationSubsystem::PromoteNearEntities()
+{
+	if(MassEnemies.IsEmpty())
+	{
+		return;
+	}
+
+	UMassEntitySubsystem* EntitySubsystem = GetWorld()->GetSubsystem<UMassEntitySubsystem>();
+	if(EntitySubsystem == nullptr)
+	{
+		return;
+	}
+	const FMassEntityManager& EntityManager = EntitySubsystem->GetEntityManager();
+
+	//Everything is promoted when the mode has been turned off
+	const bool bPromoteAll = IsMassRepresentationEnabled() == false;
+
+	TArray<FMassEntityHandle> EntitiesToPromote;
+	for(int32 EntityIndex = 0; EntityIndex < MassEnemies.Num(); EntityIndex++)
+	{
+		if(EntitiesToPromote.Num() >= MaxTransitionsPerFrame)
+		{
+			break;
+		}
+
+		//The entities destroyed outside of this subsystem are forgotten, the last one takes their place
+		const FMassEntityHandle Entity = MassEnemies[EntityIndex];
+		if(EntityManager.IsEntityValid(Entity) == false)
+		{
+			MassEnemies.RemoveAtSwap(EntityIndex);
+			--EntityIndex;
+			continue;
+		}
+
+		const FVector Location = EntityManager.GetFragmentDataChecked<FTransformFragment>(Entity).GetTransform().GetLocation();
+		if(bPromoteAll || GetClosestPlayerDistanceSquared(Location) < FMath::Square(PromoteDistance))
+		{
+			EntitiesToPromote.Add(Entity);
+		}
+	}
+
+	for(const FMassEntityHandle& Entity : EntitiesToPromote)
+	{
+		PromoteEntity(Entity);
+	}
+}
+
+FMassEntityHandle UPWEnemyRepresentationSubsystem::DemoteEnemy(APWEnemyCharacter* Enemy)
+{
+	//Without the pool, every demotion and promotion would pay a full destroy and spawn, the enemy stays a character
+	UMassEntitySubsystem* EntitySubsystem = GetWorld()->GetSubsystem<UMassEntitySubsystem>();
+	UPWEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UPWEnemyPoolSubsystem>();
+	if(Enemy == nullptr || EntitySubsystem == nullptr || EnemyPool == nullptr)
+	{
+		return FMassEntityHandle();
+	}
+	FMassEntityManager& EntityManager = EntitySubsystem->GetMutableEntityManager();
+
+	if(EnemyArchetype.IsValid() == false)
+	{
+		EnemyArchetype = EntityManager.CreateArchetype({FTransformFragment::StaticStruct(), FPWEnemyFlyingFragment::StaticStruct(), FPWEnemySourceFragment::StaticStruct()});
+	}
+
+	const FMassEntityHandle Entity = EntityManager.CreateEntity(EnemyArchetype);
+
+	EntityManager.GetFragmentDataChecked<FTransformFragment>(Entity).SetTransform(Enemy->GetActorTransform());
+	EntityManager.GetFragmentDataChecked<FPWEnemySourceFragment>(Entity).EnemyClass = Enemy->GetClass();
+
+	FPWEnemyFlyingFragment& Flying = EntityManager.GetFragmentDataChecked<FPWEnemyFlyingFragment>(Entity);
+	Flying.Velocity = Enemy->GetVelocity();
+	Flying.WalkSpeed = Enemy->GetMovementSpeed();
+	Flying.NbRocketOverlappingCounter = Enemy->NbRocketOverlappingCounter;
+	Flying.bIsInGravityZone = Enemy->bIsInGravityZone;
+	Flying.GravityZoneSpeed = Enemy->GetCharacterMovement()->MaxWalkSpeed;
+	Flying.GravityScale = Enemy->GetCharacterMovement()->GravityScale;
+
+	//Find the ground under the enemy once, the entities don't collide with the world
+	const float HalfHeight = Enemy->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	Flying.GroundZ = Enemy->GetActorLocation().Z - HalfHeight;
+	FHitResult GroundHit;
+	const FVector TraceStart = Enemy->GetActorLocation();
+	const FVector TraceEnd = TraceStart - FVector(0, 0, 10000.0f);
+	FCollisionQueryParams TraceParams(FName(TEXT("MassEnemyGround")), false, Enemy);
+	if(GetWorld()->LineTraceSingleByChannel(GroundHit, TraceStart, TraceEnd, ECC_WorldStatic, TraceParams))
+	{
+		Flying.GroundZ = GroundHit.ImpactPoint.Z + HalfHeight;
+	}
+
+	MassEnemies.Add(Entity);
+
+	//Removing the character sends the end overlaps to the rockets, the entity is now in charge of the zones
+	EnemyPool->ReleaseEnemy(Enemy);
+
+	return Entity;
+}
+
+APWEnemyCharacter* UPWEnemyRepresentationSubsystem::PromoteEntity(FMassEntityHandle Entity)
+{
+	UMassEntitySubsystem* EntitySubsystem = GetWorld()->GetSubsystem<UMassEntitySubsystem>();
+	UPWEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UPWEnemyPoolSubsystem>();
+	if(EntitySubsystem == nullptr || EnemyPool == nullptr)
+	{
+		return nullptr;
+	}
+	FMassEntityManager& EntityManager = EntitySubsystem->GetMutableEntityManager();
+
+	MassEnemies.RemoveSingleSwap(Entity);
+	if(EntityManager.IsEntityValid(Entity) == false)
+	{
+		return nullptr;
+	}
+
+	const FTransform Transform = EntityManager.GetFragmentDataChecked<FTransformFragment>(Entity).GetTransform();
+	const FPWEnemyFlyingFragment Flying = EntityManager.GetFragmentDataChecked<FPWEnemyFlyingFragment>(Entity);
+	const TSubclassOf<APWEnemyCharacter> EnemyClass = EntityManager.GetFragmentDataChecked<FPWEnemySourceFragment>(Entity).EnemyClass;
+	EntityManager.DestroyEntity(Entity);
+
+	if(EnemyClass == nullptr)
+	{
+		return nullptr;
+	}
+
+	APWEnemyCharacter* EnemyCharacter = EnemyPool->AcquireEnemy(EnemyClass, Transform);
+	if(EnemyCharacter == nullptr)
+	{
+		return nullptr;
+	}
+
+	if(EnemyCharacter->GetController() == nullptr)
+	{
+		EnemyCharacter->SpawnDefaultController();
+	}
+
+	//The character spawns walking, the begin overlaps of the rockets containing it make it float exactly like any other enemy
+	EnemyCharacter->GetCharacterMovement()->Velocity = Flying.Velocity;
+
+	return EnemyCharacter;
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PWEnemyRepresentationSubsystem.generated.h"
+
+class APWEnemyCharacter;
+
+/**
+ * Opt-in mode (pw.Enemies.MassRepresentation 1) where the distant enemies, and the enemies floating in a gravity zone
+ * away from the players, are demoted to lightweight mass entities moved by UPWEnemyFlyingMovementProcessor.
+ * They are promoted back to full enemy characters when a player comes close.
+ * Only the class, the location and the movement state survive the round trip.
+ * The demoted characters wait in UPWEnemyPoolSubsystem, so a promotion reuses one instead of spawning it.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWEnemyRepresentationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Location of every player pawn, gathered once per frame for the movement processor
+	const TArray<FVector>& GetPlayerLocations() const { return PlayerLocations; }
+
+	//Number of enemies currently simulated as mass entities
+	int32 GetNumMassEnemies() const { return MassEnemies.Num(); }
+
+	//Return true if the mass representation is enabled
+	static bool IsMassRepresentationEnabled();
+
+	//Replace an enemy character with a mass entity
+	FMassEntityHandle DemoteEnemy(APWEnemyCharacter* Enemy);
+
+	//Replace a mass entity with an enemy character
+	APWEnemyCharacter* PromoteEntity(FMassEntityHandle Entity);
+
+	//An enemy farther than this from every player is demoted
+	UPROPERTY(Config)
+	float DemoteDistance = 6000.0f;
+
+	//An enemy floating in a gravity zone farther than this from every player is demoted
+	UPROPERTY(Config)
+	float InGravityZoneDemoteDistance = 2500.0f;
+
+	//An entity closer than this to a player is promoted, smaller than the demote distances to avoid flip-flopping
+	UPROPERTY(Config)
+	float PromoteDistance = 2000.0f;
+
+	//Seconds between two scans of the enemies to demote
+	UPROPERTY(Config)
+	float ScanInterval = 0.25f;
+
+	//Maximum number of demotions and promotions each frame
+	UPROPERTY(Config)
+	int32 MaxTransitionsPerFrame = 16;
+
+private:
+	//Smallest squared distance between the location and a player
+	double GetClosestPlayerDistanceSquared(const FVector& Location) const;
+
+	void DemoteDistantEnemies();
+	void PromoteNearEntities();
+
+	TArray<FVector> PlayerLocations;
+
+	//Every entity created by this subsystem
+	TArray<FMassEntityHandle> MassEnemies;
+
+	FMassArchetypeHandle EnemyArchetype;
+
+	float TimeSinceLastScan = 0.0f;
+};
@@ -0,0 +1,314 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Characters/Enemies/PWEnemySignificanceSubsystem.h"
+#include "Core/PWGameplayStats.h"
+#include "AIController.h"
+#include "BrainComponent.h"
+#include "EngineUtils.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+
+UPWEnemySignificanceSubsystem::UPWEnemySignificanceSubsystem()
+{
+	//The near enemies keep full fidelity, the others are simulated less and less often
+	MediumSettings.MovementTickInterval = 0.033f;
+	MediumSettings.BehaviorTreeTickInterval = 0.1f;
+	MediumSettings.SteeringRefreshInterval = 0.1f;
+
+	FarSettings.MovementTickInterval = 0.1f;
+	FarSettings.BehaviorTreeTickInterval = 0.25f;
+	FarSettings.SteeringRefreshInterval = 0.3f;
+
+	CulledSettings.MovementTickInterval = 0.25f;
+	CulledSettings.BehaviorTreeTickInterval = 0.5f;
+	CulledSettings.SteeringRefreshInterval = 0.6f;
+}
+
+bool UPWEnemySignificanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	//The enemies of the editor and preview worlds keep their own tick settings
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPWEnemySignificanceSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	//Every enemy spawned in the world is tracked automatically
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UPWEnemySignificanceSubsystem::OnActorSpawned));
+}
+
+void UPWEnemySignificanceSubsystem::Deinitialize()
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+
+	//Give back the full fidelity to the enemies that are still alive
+	while(Enemies.Num() > 0)
+	{
+		RemoveEnemyAt(Enemies.Num() - 1);
+	}
+
+	Super::Deinitialize();
+}
+
+void UPWEnemySignificanceSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//Register the enemies placed in the level
+	for(TActorIterator<APWEnemyCharacter> It(&InWorld); It; ++It)
+	{
+		RegisterEnemy(*It);
+	}
+}
+
+TStatId UPWEnemySignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWEnemySignificanceSubsystem, STATGROUP_Tickables);
+}
+
+void UPWEnemySignificanceSubsystem::OnActorSpawned(AActor* SpawnedActor)
+{
+	if(APWEnemyCharacter* EnemyCharacter = Cast<APWEnemyCharacter>(SpawnedActor))
+	{
+		RegisterEnemy(EnemyCharacter);
+	}
+}
+
+void UPWEnemySignificanceSubsystem::RegisterEnemy(APWEnemyCharacter* Enemy)
+{
+	if(Enemy == nullptr || EnemyIndexMap.Contains(Enemy))
+	{
+		return;
+	}
+
+	FPWEnemySignificanceInfo& Info = Enemies.AddDefaulted_GetRef();
+	Info.Enemy = Enemy;
+	Info.EnemyKey = Enemy;
+	Info.Significance = EPWEnemySignificance::Near;
+
+	if(const UCharacterMovementComponent* MovementComponent = Enemy->GetCharacterMovement())
+	{
+		Info.DefaultMovementTickInterval = MovementComponent->GetComponentTickInterval();
+	}
+
+	//The controller may not be possessing the enemy yet, in that case the default interval is every frame
+	if(const AAIController* AIController = Cast<AAIController>(Enemy->GetController()); AIController != nullptr && AIController->GetBrainComponent() != nullptr)
+	{
+		Info.DefaultBehaviorTreeTickInterval = AIController->GetBrainComponent()->GetComponentTickInterval();
+	}
+
+	EnemyIndexMap.Add(Enemy, Enemies.Num() - 1);
+}
+
+void UPWEnemySignificanceSubsystem::UnregisterEnemy(APWEnemyCharacter* Enemy)
+{
+	if(const int32* Index = EnemyIndexMap.Find(Enemy))
+	{
+		RemoveEnemyAt(*Index);
+	}
+}
+
+void UPWEnemySignificanceSubsystem::RemoveEnemyAt(int32 Index)
+{
+	FPWEnemySignificanceInfo& Info = Enemies[Index];
+
+	//Put back the default tick intervals if the enemy is still alive
+	if(APWEnemyCharacter* Enemy = Info.Enemy.Get())
+	{
+		if(UCharacterMovementComponent* MovementComponent = Enemy->GetCharacterMovement())
+		{
+			MovementComponent->SetComponentTickInterval(Info.DefaultMovementTickInterval);
+		}
+
+		if(const AAIController* AIController = Cast<AAIController>(Enemy->GetController()); AIController != nullptr && AIController->GetBrainComponent() != nullptr)
+		{
+			AIController->GetBrainComponent()->SetComponentTickInterval(Info.DefaultBehaviorTreeTickInterval);
+		}
+	}
+
+	//Swap the last enemy in the removed slot and fix its index
+	EnemyIndexMap.Remove(Info.EnemyKey);
+	Enemies.RemoveAtSwap(Index);
+	if(Enemies.IsValidIndex(Index))
+	{
+		EnemyIndexMap.Add(Enemies[Index].EnemyKey, Index);
+	}
+}
+
+void UPWEnemySignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	PW_SCOPE_GAMEPLAY_TIME(EnemySignificance);
+
+	if(Enemies.IsEmpty())
+	{
+		return;
+	}
+
+	//Gather the location of every player pawn once per frame
+	TArray<FVector> PlayerLocations;
+	for(FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if(const APlayerController* PlayerController = It->Get(); PlayerController != nullptr && PlayerController->GetPawn() != nullptr)
+		{
+			PlayerLocations.Add(PlayerController->GetPawn()->GetActorLocation());
+		}
+	}
+
+	//Evaluate only a slice of the enemies each frame
+	const int32 NumToEvaluate = FMath::Min(MaxEnemiesEvaluatedPerFrame, Enemies.Num());
+	for(int32 i = 0; i < NumToEvaluate && Enemies.Num() > 0; i++)
+	{
+		if(NextEnemyToEvaluate >= Enemies.Num())
+		{
+			NextEnemyToEvaluate = 0;
+		}
+
+		FPWEnemySignificanceInfo& Info = Enemies[NextEnemyToEvaluate];
+		const APWEnemyCharacter* Enemy = Info.Enemy.Get();
+		if(Enemy == nullptr)
+		{
+			//The enemy has been destroyed, the swapped enemy is evaluated next
+			RemoveEnemyAt(NextEnemyToEvaluate);
+			continue;
+		}
+
+		const EPWEnemySignificance NewSignificance = EvaluateSignificance(Enemy, PlayerLocations);
+		if(NewSignificance != Info.Significance)
+		{
+			ApplySignificance(Info, NewSignificance);
+		}
+
+		++NextEnemyToEvaluate;
+	}
+}
+
+EPWEnemySignificance UPWEnemySignificanceSubsystem::EvaluateSignificance(const APWEnemyCharacter* Enemy, const TArray<FVector>& PlayerLocations) const
+{
+	//Without players there is nobody to look at the enemies
+	if(PlayerLocations.IsEmpty())
+	{
+		return EPWEnemySignificance::Near;
+	}
+
+	const FVector EnemyLocation = Enemy->GetActorLocation();
+	double ClosestDistanceSquared = TNumericLimits<double>::Max();
+	for(const FVector& PlayerLocation : PlayerLocations)
+	{
+		ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared, FVector::DistSquared(EnemyLocation, PlayerLocation));
+	}
+
+	uint8 Bucket;
+	if(ClosestDistanceSquared < FMath::Square(NearDistance))
+	{
+		Bucket = static_cast<uint8>(EPWEnemySignificance::Near);
+	}
+	else if(ClosestDistanceSquared < FMath::Square(MediumDistance))
+	{
+		Bucket = static_cast<uint8>(EPWEnemySignificance::Medium);
+	}
+	else if(ClosestDistanceSquared < FMath::Square(FarDistance))
+	{
+		Bucket = static_cast<uint8>(EPWEnemySignificance::Far);
+	}
+	else
+	{
+		Bucket = static_cast<uint8>(EPWEnemySignificance::Culled);
+	}
+
+	//An enemy that is not on screen is pushed one bucket further, except the near ones that can still reach the player
+	if(Bucket != static_cast<uint8>(EPWEnemySignificance::Near) && Enemy->WasRecentlyRendered(NotRenderedTolerance) == false)
+	{
+		Bucket = FMath::Min<uint8>(Bucket + 1, static_cast<uint8>(EPWEnemySignificance::Culled));
+	}
+
+	return static_cast<EPWEnemySignificance>(Bucket);
+}
+
+void UPWEnemySignificanceSubsystem::ApplySignificance(FPWEnemySignificanceInfo& Info, EPWEnemySignificance NewSignificance)
+{
+	APWEnemyCharacter* Enemy = Info.Enemy.Get();
+	const FPWSignificanceBucketSettings& Settings = GetBucketSettings(NewSignificance);
+	const bool bFullFidelity = NewSignificance == EPWEnemySignificance::Near;
+
+	if(UCharacterMovementComponent* MovementComponent = Enemy->GetCharacterMovement())
+	{
+		MovementComponent->SetComponentTickInterval(bFullFidelity ? Info.DefaultMovementTickInterval : Settings.MovementTickInterval);
+	}
+
+	if(const AAIController* AIController = Cast<AAIController>(Enemy->GetController()); AIController != nullptr && AIController->GetBrainComponent() != nullptr)
+	{
+		AIController->GetBrainComponent()->SetComponentTickInterval(bFullFidelity ? Info.DefaultBehaviorTreeTickInterval : Settings.BehaviorTreeTickInterval);
+	}
+
+	//Force a new steering direction with the precision of the new bucket
+	Info.LastSteeringTime = 0.0;
+	Info.Significance = NewSignificance;
+}
+
+const FPWSignificanceBucketSettings& UPWEnemySignificanceSubsystem::GetBucketSettings(EPWEnemySignificance Significance) const
+{
+	switch (Significance)
+	{
+		case EPWEnemySignificance::Medium:
+			return MediumSettings;
+		case EPWEnemySignificance::Far:
+			return FarSettings;
+		case EPWEnemySignificance::Culled:
+			return CulledSettings;
+		default:
+			return NearSettings;
+	}
+}
+
+EPWEnemySignificance UPWEnemySignificanceSubsystem::GetEnemySignificance(const APWEnemyCharacter* Enemy) const
+{
+	if(const int32* Index = EnemyIndexMap.Find(Enemy))
+	{
+		return Enemies[*Index].Significance;
+	}
+
+	return EPWEnemySignificance::Near;
+}
+
+FVector UPWEnemySignificanceSubsystem::GetSteeringDirection(const APWEnemyCharacter* Enemy, const FVector& TargetLocation)
+{
+	const FVector NewDirection = (TargetLocation - Enemy->GetActorLocation()).GetSafeNormal();
+
+	const int32* Index = EnemyIndexMap.Find(Enemy);
+	if(Index == nullptr)
+	{
+		return NewDirection;
+	}
+
+	FPWEnemySignificanceInfo& Info = Enemies[*Index];
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+	const float RefreshInterval = GetBucketSettings(Info.Significance).SteeringRefreshInterval;
+
+	//Reuse the last direction while it is still fresh enough for the bucket of the enemy
+	if(RefreshInterval > 0.0f && Info.SteeringDirection.IsZero() == false && CurrentTime - Info.LastSteeringTime < RefreshInterval)
+	{
+		return Info.SteeringDirection;
+	}
+
+	Info.SteeringDirection = NewDirection;
+	Info.LastSteeringTime = CurrentTime;
+	return NewDirection;
+}
+
+int32 UPWEnemySignificanceSubsystem::GetNumEnemiesInBucket(EPWEnemySignificance Significance) const
+{
+	int32 Count = 0;
+	for(const FPWEnemySignificanceInfo& Info : Enemies)
+	{
+		if(Info.Significance == Significance)
+		{
+			++Count;
+		}
+	}
+	return Count;
+}
@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "PWEnemySignificanceSubsystem.generated.h"
+
+class APWEnemyCharacter;
+
+//Significance bucket of an enemy, from full fidelity to the cheapest simulation
+UENUM(BlueprintType)
+enum class EPWEnemySignificance : uint8
+{
+	Near,
+	Medium,
+	Far,
+	Culled
+};
+
+//What an enemy is allowed to cost while it is in a bucket
+USTRUCT(BlueprintType)
+struct FPWSignificanceBucketSettings
+{
+	GENERATED_BODY()
+
+	//Tick interval of the character movement component, 0 means every frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float MovementTickInterval = 0.0f;
+
+	//Tick interval of the behavior tree component, 0 means every frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float BehaviorTreeTickInterval = 0.0f;
+
+	//How long the steering direction toward the target is reused before being computed again, 0 means every execution
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float SteeringRefreshInterval = 0.0f;
+};
+
+//Significance state tracked for each enemy
+USTRUCT()
+struct FPWEnemySignificanceInfo
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TWeakObjectPtr<APWEnemyCharacter> Enemy;
+
+	//Key of the enemy in the index map, still usable once the enemy is destroyed
+	TObjectKey<APWEnemyCharacter> EnemyKey;
+
+	UPROPERTY()
+	EPWEnemySignificance Significance = EPWEnemySignificance::Near;
+
+	//Tick intervals of the enemy when it was registered, restored when it is unregistered
+	UPROPERTY()
+	float DefaultMovementTickInterval = 0.0f;
+
+	UPROPERTY()
+	float DefaultBehaviorTreeTickInterval = 0.0f;
+
+	//Last steering direction given to the enemy and when it was computed
+	UPROPERTY()
+	FVector SteeringDirection = FVector::ZeroVector;
+
+	UPROPERTY()
+	double LastSteeringTime = 0.0;
+};
+
+/**
+ * Buckets the enemies by their distance and visibility to the players, and lowers the movement tick rate,
+ * the behavior tree tick rate and the steering precision of the far buckets. The near enemies keep full fidelity.
+ * The enemies are evaluated a few per frame so the cost stays flat whatever the size of the wave.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWEnemySignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPWEnemySignificanceSubsystem();
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Start tracking an enemy, it begins in the near bucket
+	void RegisterEnemy(APWEnemyCharacter* Enemy);
+
+	//Stop tracking an enemy and give it back its full fidelity
+	void UnregisterEnemy(APWEnemyCharacter* Enemy);
+
+	//Current bucket of the enemy, near if the enemy isn't tracked
+	EPWEnemySignificance GetEnemySignificance(const APWEnemyCharacter* Enemy) const;
+
+	//Direction the enemy should steer toward the target. The far buckets reuse their last direction for a while
+	FVector GetSteeringDirection(const APWEnemyCharacter* Enemy, const FVector& TargetLocation);
+
+	//Number of tracked enemies in a bucket
+	int32 GetNumEnemiesInBucket(EPWEnemySignificance Significance) const;
+
+	//Below this distance to a player the enemy is near
+	UPROPERTY(Config)
+	float NearDistance = 1500.0f;
+
+	//Below this distance to a player the enemy is medium
+	UPROPERTY(Config)
+	float MediumDistance = 3500.0f;
+
+	//Below this distance to a player the enemy is far, above it is culled
+	UPROPERTY(Config)
+	float FarDistance = 7000.0f;
+
+	//An enemy that hasn't been rendered for this long is pushed one bucket further
+	UPROPERTY(Config)
+	float NotRenderedTolerance = 0.25f;
+
+	//Maximum number of enemies evaluated each frame
+	UPROPERTY(Config)
+	int32 MaxEnemiesEvaluatedPerFrame = 64;
+
+	UPROPERTY(Config)
+	FPWSignificanceBucketSettings NearSettings;
+
+	UPROPERTY(Config)
+	FPWSignificanceBucketSettings MediumSettings;
+
+	UPROPERTY(Config)
+	FPWSignificanceBucketSettings FarSettings;
+
+	UPROPERTY(Config)
+	FPWSignificanceBucketSettings CulledSettings;
+
+	const FPWSignificanceBucketSettings& GetBucketSettings(EPWEnemySignificance Significance) const;
+
+private:
+	void OnActorSpawned(AActor* SpawnedActor);
+
+	//Compute the bucket of an enemy from the closest player location
+	EPWEnemySignificance EvaluateSignificance(const APWEnemyCharacter* Enemy, const TArray<FVector>& PlayerLocations) const;
+
+	//Apply the tick intervals of a bucket to the enemy components
+	void ApplySignificance(FPWEnemySignificanceInfo& Info, EPWEnemySignificance NewSignificance);
+
+	void RemoveEnemyAt(int32 Index);
+
+	UPROPERTY()
+	TArray<FPWEnemySignificanceInfo> Enemies;
+
+	//Index of each enemy inside the Enemies array
+	TMap<TObjectKey<APWEnemyCharacter>, int32> EnemyIndexMap;
+
+	//Next enemy to evaluate, the evaluation is spread over several frames
+	int32 NextEnemyToEvaluate = 0;
+
+	FDelegateHandle ActorSpawnedHandle;
+};
@@ -0,0 +1,610 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Core/PWEventRecordingSubsystem.h"
+#include "EngineUtils.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "Characters/Enemies/PWEnemyGravityStateComponent.h"
+#include "Characters/Enemies/PWEnemyPoolSubsystem.h"
+#include "Core/PWGameplayStats.h"
+#include "Core/PWWorldSnapshotSubsystem.h"
+#include "Creator/Items/CreationItems/PW_RocketCreation.h"
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+#include "DayNight/DayNightActor.h"
+#include "Interactor/Interactable.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace PWEventRecording
+{
+	constexpr uint32 Magic = 0x50574552;	//"PWER"
+	constexpr int32 Version = 2;
+
+	int32 GetRocketFlags(const FPWGravityZoneInfo& Zone)
+	{
+		int32 Flags = 0;
+		Flags |= Zone.bAffectsEnemies ? static_cast<int32>(EPWRecordedRocketFlags::AffectsEnemies) : 0;
+		Flags |= Zone.bAffectsPlayer ? static_cast<int32>(EPWRecordedRocketFlags::AffectsPlayer) : 0;
+		return Flags;
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs StartEventRecordingCommand(
+	TEXT("pw.Events.Record"),
+	TEXT("Start recording the rocket, enemy gravity, wave and pickup events. Optional recording name, Recording by default."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if(UPWEventRecordingSubsystem* EventRecording = World != nullptr ? World->GetSubsystem<UPWEventRecordingSubsystem>() : nullptr)
+		{
+			EventRecording->StartRecording(Args.Num() > 0 ? Args[0] : TEXT("Recording"));
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs StopEventRecordingCommand(
+	TEXT("pw.Events.Stop"),
+	TEXT("Stop the event recording and save it, or stop the event replay."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if(UPWEventRecordingSubsystem* EventRecording = World != nullptr ? World->GetSubsystem<UPWEventRecordingSubsystem>() : nullptr)
+		{
+			EventRecording->StopRecording();
+			EventRecording->StopReplay();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs ReplayEventsCommand(
+	TEXT("pw.Events.Replay"),
+	TEXT("Replay a saved event recording with a fixed time step. Optional recording name, Recording by default."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if(UPWEventRecordingSubsystem* EventRecording = World != nullptr ? World->GetSubsystem<UPWEventRecordingSubsystem>() : nullptr)
+		{
+			EventRecording->StartReplay(Args.Num() > 0 ? Args[0] : TEXT("Recording"), false);
+		}
+	}));
+
+FArchive& operator<<(FArchive& Ar, FPWRecordedEvent& Event)
+{
+	uint8 Type = static_cast<uint8>(Event.Type);
+	Ar << Event.Time << Type << Event.ClassIndex << Event.Object << Event.Value << Event.Location;
+	Event.Type = static_cast<EPWRecordedEventType>(Type);
+
+	if(Event.Type == EPWRecordedEventType::RocketSpawned)
+	{
+		Ar << Event.Rotation;
+	}
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FPWEventRecording& Recording)
+{
+	uint32 Magic = PWEventRecording::Magic;
+	int32 Version = PWEventRecording::Version;
+	Ar << Magic << Version;
+	if(Ar.IsLoading() && (Magic != PWEventRecording::Magic || Version != PWEventRecording::Version))
+	{
+		Ar.SetError();
+		return Ar;
+	}
+
+	Ar << Recording.ClassPaths << Recording.StartSnapshot << Recording.Events << Recording.Duration;
+	return Ar;
+}
+
+void UPWEventRecordingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Collection.InitializeDependency<UPWGravityZoneSubsystem>();
+	Collection.InitializeDependency<UPWWorldSnapshotSubsystem>();
+	Super::Initialize(Collection);
+}
+
+void UPWEventRecordingSubsystem::Deinitialize()
+{
+	StopRecording();
+	if(bIsReplaying)
+	{
+		bIsReplaying = false;
+		FApp::SetUseFixedTimeStep(bPreviousUseFixedTimeStep);
+		FApp::SetFixedDeltaTime(PreviousFixedDeltaTime);
+	}
+
+	Super::Deinitialize();
+}
+
+void UPWEventRecordingSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//-PWReplayEvents=<Name> replays the recording once and exits
+	FString RecordingName;
+	if(InWorld.IsGameWorld() && FParse::Value(FCommandLine::Get(), TEXT("PWReplayEvents="), RecordingName))
+	{
+		if(StartReplay(RecordingName, true) == false)
+		{
+			FPlatformMisc::RequestExit(false);
+		}
+	}
+}
+
+TStatId UPWEventRecordingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWEventRecordingSubsystem, STATGROUP_Tickables);
+}
+
+void UPWEventRecordingSubsystem::StartRecording(const FString& RecordingName)
+{
+	if(bIsRecording || bIsReplaying)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Event recording: already recording or replaying"));
+		return;
+	}
+
+	Recording = FPWEventRecording();
+	RecordedEnemyIds.Reset();
+	RecordedRocketFilters.Reset();
+	CurrentRecordingName = RecordingName;
+
+	//The replay starts from the world as it is now, the enemies of the snapshot are recorded with their index in it
+	if(const UPWWorldSnapshotSubsystem* SnapshotSubsystem = GetWorld()->GetSubsystem<UPWWorldSnapshotSubsystem>())
+	{
+		TArray<APWEnemyCharacter*> SnapshotEnemies;
+		SnapshotSubsystem->CaptureSnapshot(Recording.StartSnapshot, &SnapshotEnemies);
+		for(int32 EnemyIndex = 0; EnemyIndex < SnapshotEnemies.Num(); EnemyIndex++)
+		{
+			RecordedEnemyIds.Add(SnapshotEnemies[EnemyIndex], EnemyIndex);
+		}
+	}
+
+	StartTime = GetWorld()->GetTimeSeconds();
+	BindRecordedEvents();
+	bIsRecording = true;
+
+	UE_LOG(LogTemp, Log, TEXT("Event recording: recording %s"), *CurrentRecordingName);
+}
+
+void UPWEventRecordingSubsystem::StopRecording()
+{
+	if(bIsRecording == false)
+	{
+		return;
+	}
+
+	bIsRecording = false;
+	UnbindRecordedEvents();
+	Recording.Duration = GetRecordingTime();
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	Writer << Recording;
+
+	const FString FilePath = GetRecordingFilePath(CurrentRecordingName);
+	if(FFileHelper::SaveArrayToFile(Bytes, *FilePath))
+	{
+		UE_LOG(LogTemp, Log, TEXT("Event recording: %d events over %.1f s saved in %s, %d bytes"), Recording.Events.Num(), Recording.Duration, *FilePath, Bytes.Num());
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Event recording: can't write %s"), *FilePath);
+	}
+
+	Recording = FPWEventRecording();
+	RecordedEnemyIds.Reset();
+	RecordedRocketFilters.Reset();
+}
+
+bool UPWEventRecordingSubsystem::StartReplay(const FString& RecordingName, bool bExitWhenDone)
+{
+	if(bIsRecording || bIsReplaying)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Event recording: already recording or replaying"));
+		return false;
+	}
+
+	TArray<uint8> Bytes;
+	if(FFileHelper::LoadFileToArray(Bytes, *GetRecordingFilePath(RecordingName)) == false)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Event recording: can't read %s"), *GetRecordingFilePath(RecordingName));
+		return false;
+	}
+
+	Recording = FPWEventRecording();
+	FMemoryReader Reader(Bytes);
+	Reader << Recording;
+	if(Reader.IsError())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Event recording: %s isn't a recording of this version"), *RecordingName);
+		return false;
+	}
+
+	CurrentRecordingName = RecordingName;
+	bExitOnFinish = bExitWhenDone;
+
+	//Resolve the class table once
+	ReplayClasses.Reset();
+	for(const FString& ClassPath : Recording.ClassPaths)
+	{
+		ReplayClasses.Add(FSoftClassPath(ClassPath).TryLoadClass<AActor>());
+	}
+
+	//The rockets are spawned with the lifetime they had, their own countdown launches them at the recorded time
+	RecordedRocketLifetimes.Reset();
+	TMap<int32, float> RocketSpawnTimes;
+	for(const FPWRecordedEvent& Event : Recording.Events)
+	{
+		if(Event.Type == EPWRecordedEventType::RocketSpawned)
+		{
+			RocketSpawnTimes.Add(Event.Object, Event.Time);
+		}
+		else if(const float* SpawnTime = Event.Type == EPWRecordedEventType::RocketLaunched ? RocketSpawnTimes.Find(Event.Object) : nullptr)
+		{
+			RecordedRocketLifetimes.Add(Event.Object, Event.Time - *SpawnTime);
+		}
+	}
+
+	//The enemies of the snapshot take the recorded ids of their index in it
+	ReplayEnemies.Reset();
+	if(UPWWorldSnapshotSubsystem* SnapshotSubsystem = GetWorld()->GetSubsystem<UPWWorldSnapshotSubsystem>())
+	{
+		TArray<APWEnemyCharacter*> SnapshotEnemies;
+		SnapshotSubsystem->RestoreSnapshot(Recording.StartSnapshot, &SnapshotEnemies);
+		for(int32 EnemyIndex = 0; EnemyIndex < SnapshotEnemies.Num(); EnemyIndex++)
+		{
+			if(SnapshotEnemies[EnemyIndex] != nullptr)
+			{
+				ReplayEnemies.Add(EnemyIndex, SnapshotEnemies[EnemyIndex]);
+			}
+		}
+	}
+
+	TActorIterator<ADayNightActor> It(GetWorld());
+	DayNightActor = It ? *It : nullptr;
+
+	//With a fixed time step the events happen on the same frames at every replay
+	bPreviousUseFixedTimeStep = FApp::UseFixedTimeStep();
+	PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(ReplayTimeStep);
+
+	ReplayRockets.Reset();
+	ReplayFrameMilliseconds.Reset();
+	NextEventIndex = 0;
+	LastFrameTime = 0.0;
+	ReplayWallStartTime = FPlatformTime::Seconds();
+	StartTime = GetWorld()->GetTimeSeconds();
+	bIsReplaying = true;
+
+	UE_LOG(LogTemp, Log, TEXT("Event recording: replaying %s, %d events over %.1f s"), *CurrentRecordingName, Recording.Events.Num(), Recording.Duration);
+	return true;
+}
+
+void UPWEventRecordingSubsystem::StopReplay()
+{
+	if(bIsReplaying)
+	{
+		FinishReplay();
+	}
+}
+
+void UPWEventRecordingSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if(bIsReplaying == false)
+	{
+		return;
+	}
+
+	//Wall time of the previous frame, the first one includes the snapshot restore and isn't kept
+	const double CurrentFrameTime = FPlatformTime::Seconds();
+	if(LastFrameTime > 0.0)
+	{
+		ReplayFrameMilliseconds.Add(static_cast<float>((CurrentFrameTime - LastFrameTime) * 1000.0));
+	}
+	LastFrameTime = CurrentFrameTime;
+
+	const float Time = GetRecordingTime();
+	while(NextEventIndex < Recording.Events.Num() && Recording.Events[NextEventIndex].Time <= Time)
+	{
+		ReplayEvent(Recording.Events[NextEventIndex++]);
+	}
+
+	if(NextEventIndex >= Recording.Events.Num() && Time >= Recording.Duration)
+	{
+		FinishReplay();
+	}
+}
+
+FString UPWEventRecordingSubsystem::GetRecordingFilePath(const FString& RecordingName)
+{
+	return FPaths::ProjectSavedDir() / TEXT("EventRecordings") / (RecordingName + TEXT(".pwrec"));
+}
+
+float UPWEventRecordingSubsystem::GetRecordingTime() const
+{
+	return static_cast<float>(GetWorld()->GetTimeSeconds() - StartTime);
+}
+
+int32 UPWEventRecordingSubsystem::FindOrAddClass(const UClass* Class)
+{
+	return Class != nullptr ? Recording.ClassPaths.AddUnique(FSoftClassPath(Class).ToString()) : INDEX_NONE;
+}
+
+void UPWEventRecordingSubsystem::AddEvent(EPWRecordedEventType Type, const UClass* Class, int32 Object, int32 Value, const FVector& Location, const FQuat& Rotation)
+{
+	FPWRecordedEvent& Event = Recording.Events.AddDefaulted_GetRef();
+	Event.Time = GetRecordingTime();
+	Event.Type = Type;
+	Event.ClassIndex = FindOrAddClass(Class);
+	Event.Object = Object;
+	Event.Value = Value;
+	Event.Location = FVector3f(Location);
+	Event.Rotation = FQuat4f(Rotation);
+}
+
+void UPWEventRecordingSubsystem::BindRecordedEvents()
+{
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		ZoneAddedHandle = GravityZoneSubsystem->OnZoneAdded.AddUObject(this, &UPWEventRecordingSubsystem::OnZoneAdded);
+		ZoneRemovedHandle = GravityZoneSubsystem->OnZoneRemoved.AddUObject(this, &UPWEventRecordingSubsystem::OnZoneRemoved);
+		ZoneRefreshedHandle = GravityZoneSubsystem->OnZoneRefreshed.AddUObject(this, &UPWEventRecordingSubsystem::OnZoneRefreshed);
+		EnemyGravityStateHandle = GravityZoneSubsystem->OnEnemyGravityStateChanged.AddUObject(this, &UPWEventRecordingSubsystem::OnEnemyGravityStateChanged);
+	}
+
+	TActorIterator<ADayNightActor> It(GetWorld());
+	DayNightActor = It ? *It : nullptr;
+	if(DayNightActor != nullptr)
+	{
+		WaveStartedHandle = DayNightActor->OnWaveStarted.AddUObject(this, &UPWEventRecordingSubsystem::OnWaveStarted);
+	}
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UPWEventRecordingSubsystem::OnActorSpawned));
+}
+
+void UPWEventRecordingSubsystem::UnbindRecordedEvents()
+{
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		GravityZoneSubsystem->OnZoneAdded.Remove(ZoneAddedHandle);
+		GravityZoneSubsystem->OnZoneRemoved.Remove(ZoneRemovedHandle);
+		GravityZoneSubsystem->OnZoneRefreshed.Remove(ZoneRefreshedHandle);
+		GravityZoneSubsystem->OnEnemyGravityStateChanged.Remove(EnemyGravityStateHandle);
+	}
+
+	if(DayNightActor != nullptr)
+	{
+		DayNightActor->OnWaveStarted.Remove(WaveStartedHandle);
+	}
+
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+}
+
+void UPWEventRecordingSubsystem::OnZoneAdded(const FPWGravityZoneInfo& Zone)
+{
+	const APW_RocketCreation* Rocket = Zone.Rocket.Get();
+	if(Rocket == nullptr)
+	{
+		return;
+	}
+
+	const int32 Flags = PWEventRecording::GetRocketFlags(Zone);
+	RecordedRocketFilters.Add(Zone.ZoneId, Flags);
+	AddEvent(EPWRecordedEventType::RocketSpawned, Rocket->GetClass(), Zone.ZoneId, Flags, Rocket->GetActorLocation(), Rocket->GetActorQuat());
+}
+
+void UPWEventRecordingSubsystem::OnZoneRemoved(const FPWGravityZoneInfo& Zone)
+{
+	RecordedRocketFilters.Remove(Zone.ZoneId);
+	AddEvent(EPWRecordedEventType::RocketLaunched, nullptr, Zone.ZoneId, 0, Zone.Center);
+}
+
+void UPWEventRecordingSubsystem::OnZoneRefreshed(const FPWGravityZoneInfo& Zone)
+{
+	//Only the filter changes of the rockets spawned during the recording can be replayed
+	const int32 Flags = PWEventRecording::GetRocketFlags(Zone);
+	int32* RecordedFlags = RecordedRocketFilters.Find(Zone.ZoneId);
+	if(RecordedFlags != nullptr && *RecordedFlags != Flags)
+	{
+		*RecordedFlags = Flags;
+		AddEvent(EPWRecordedEventType::RocketFilterChanged, nullptr, Zone.ZoneId, Flags, Zone.Center);
+	}
+}
+
+void UPWEventRecordingSubsystem::OnEnemyGravityStateChanged(UPWEnemyGravityStateComponent* GravityState, EPWEnemyGravityState OldState, EPWEnemyGravityState NewState)
+{
+	AActor* Enemy = GravityState->GetOwner();
+	if(Enemy == nullptr)
+	{
+		return;
+	}
+
+	int32 EnemyId;
+	if(const int32* RecordedId = RecordedEnemyIds.Find(Enemy))
+	{
+		EnemyId = *RecordedId;
+	}
+	else
+	{
+		EnemyId = RecordedEnemyIds.Num();
+		RecordedEnemyIds.Add(Enemy, EnemyId);
+	}
+
+	AddEvent(EPWRecordedEventType::EnemyGravityState, Enemy->GetClass(), EnemyId, static_cast<int32>(NewState), Enemy->GetActorLocation());
+}
+
+void UPWEventRecordingSubsystem::OnWaveStarted(int32 WaveIndex)
+{
+	AddEvent(EPWRecordedEventType::WaveStarted, nullptr, INDEX_NONE, WaveIndex, FVector::ZeroVector);
+}
+
+void UPWEventRecordingSubsystem::OnActorSpawned(AActor* SpawnedActor)
+{
+	if(const AInteractable* Pickup = Cast<AInteractable>(SpawnedActor))
+	{
+		AddEvent(EPWRecordedEventType::PickupSpawned, Pickup->GetClass(), INDEX_NONE, 0, Pickup->GetActorLocation());
+	}
+}
+
+void UPWEventRecordingSubsystem::ReplayEvent(const FPWRecordedEvent& Event)
+{
+	UClass* Class = ReplayClasses.IsValidIndex(Event.ClassIndex) ? ReplayClasses[Event.ClassIndex].Get() : nullptr;
+	const FVector Location(Event.Location);
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	switch(Event.Type)
+	{
+		case EPWRecordedEventType::RocketSpawned:
+		{
+			LLM_SCOPE_BYTAG(PWRockets);
+
+			if(Class == nullptr || Class->IsChildOf<APW_RocketCreation>() == false)
+			{
+				return;
+			}
+
+			//The filter and the countdown are set before BeginPlay, the rocket registers its zone and verifies its overlaps as usual
+			const FTransform SpawnTransform(FQuat(Event.Rotation), Location);
+			APW_RocketCreation* Rocket = GetWorld()->SpawnActorDeferred<APW_RocketCreation>(Class, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+			if(Rocket == nullptr)
+			{
+				return;
+			}
+
+			Rocket->bCanEnemiesFloatInRocketZone = (Event.Value & static_cast<int32>(EPWRecordedRocketFlags::AffectsEnemies)) != 0;
+			Rocket->bCanPlayerFloatInRocketZone = (Event.Value & static_cast<int32>(EPWRecordedRocketFlags::AffectsPlayer)) != 0;
+			if(const float* Lifetime = RecordedRocketLifetimes.Find(Event.Object))
+			{
+				Rocket->SecondsBeforeRocketLaunch = FMath::Max(*Lifetime, 0.01f);
+			}
+			Rocket->FinishSpawning(SpawnTransform);
+			ReplayRockets.Add(Event.Object, Rocket);
+			break;
+		}
+
+		case EPWRecordedEventType::RocketFilterChanged:
+			//The rockets of the start snapshot aren't known here either, they keep their saved filter
+			if(APW_RocketCreation* Rocket = ReplayRockets.FindRef(Event.Object).Get())
+			{
+				Rocket->SetGravityZoneFilter((Event.Value & static_cast<int32>(EPWRecordedRocketFlags::AffectsEnemies)) != 0,
+					(Event.Value & static_cast<int32>(EPWRecordedRocketFlags::AffectsPlayer)) != 0);
+			}
+			break;
+
+		case EPWRecordedEventType::RocketLaunched:
+			//Launched by its own countdown, the zones of the start snapshot aren't known here and launch on their restored countdown
+			ReplayRockets.Remove(Event.Object);
+			break;
+
+		case EPWRecordedEventType::EnemyGravityState:
+		{
+			//The enemy is moved where it entered or left its zone or got back on the ground, the overlaps and the gravity state do the rest
+			UPWEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UPWEnemyPoolSubsystem>();
+			APWEnemyCharacter* Enemy = ReplayEnemies.FindRef(Event.Object).Get();
+			if(Enemy != nullptr && (EnemyPool == nullptr || EnemyPool->IsPooled(Enemy) == false))
+			{
+				Enemy->SetActorLocation(Location, false, nullptr, ETeleportType::TeleportPhysics);
+			}
+			else if(EnemyPool != nullptr && Class != nullptr && Class->IsChildOf<APWEnemyCharacter>())
+			{
+				Enemy = EnemyPool->AcquireEnemy(Class, FTransform(Location));
+				ReplayEnemies.Add(Event.Object, Enemy);
+			}
+			break;
+		}
+
+		case EPWRecordedEventType::WaveStarted:
+			if(DayNightActor != nullptr)
+			{
+				DayNightActor->WaveEnumCounter = Event.Value;
+				DayNightActor->NewWaveWeather();
+			}
+			break;
+
+		case EPWRecordedEventType::PickupSpawned:
+		{
+			LLM_SCOPE_BYTAG(PWPickups);
+
+			if(Class != nullptr && Class->IsChildOf<AInteractable>())
+			{
+				GetWorld()->SpawnActor<AInteractable>(Class, FTransform(Location), SpawnParameters);
+			}
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+void UPWEventRecordingSubsystem::FinishReplay()
+{
+	bIsReplaying = false;
+	FApp::SetUseFixedTimeStep(bPreviousUseFixedTimeStep);
+	FApp::SetFixedDeltaTime(PreviousFixedDeltaTime);
+
+	WriteReplayReport();
+
+	//The enemies taken from the pool by the replay don't stay in the game
+	if(UPWEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UPWEnemyPoolSubsystem>())
+	{
+		for(const TPair<int32, TWeakObjectPtr<APWEnemyCharacter>>& ReplayEnemy : ReplayEnemies)
+		{
+			if(APWEnemyCharacter* Enemy = ReplayEnemy.Value.Get(); Enemy != nullptr && EnemyPool->IsPooled(Enemy) == false)
+			{
+				EnemyPool->ReleaseEnemy(Enemy);
+			}
+		}
+	}
+
+	ReplayRockets.Reset();
+	ReplayEnemies.Reset();
+	ReplayClasses.Reset();
+	Recording = FPWEventRecording();
+
+	if(bExitOnFinish)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UPWEventRecordingSubsystem::WriteReplayReport() const
+{
+	TArray<float> SortedFrameMilliseconds = ReplayFrameMilliseconds;
+	SortedFrameMilliseconds.Sort();
+
+	float TotalMilliseconds = 0.0f;
+	for(const float FrameMilliseconds : SortedFrameMilliseconds)
+	{
+		TotalMilliseconds += FrameMilliseconds;
+	}
+
+	const int32 NumFrames = SortedFrameMilliseconds.Num();
+	const float AverageMilliseconds = NumFrames > 0 ? TotalMilliseconds / NumFrames : 0.0f;
+	const float MedianMilliseconds = NumFrames > 0 ? SortedFrameMilliseconds[NumFrames / 2] : 0.0f;
+	const float P95Milliseconds = NumFrames > 0 ? SortedFrameMilliseconds[FMath::Min(NumFrames * 95 / 100, NumFrames - 1)] : 0.0f;
+	const float MaxMilliseconds = NumFrames > 0 ? SortedFrameMilliseconds.Last() : 0.0f;
+	const double WallSeconds = FPlatformTime::Seconds() - ReplayWallStartTime;
+
+	UE_LOG(LogTemp, Log, TEXT("Event recording: replay of %s done in %.2f s, %d frames, avg %.3f ms, median %.3f ms, p95 %.3f ms, max %.3f ms"),
+		*CurrentRecordingName, WallSeconds, NumFrames, AverageMilliseconds, MedianMilliseconds, P95Milliseconds, MaxMilliseconds);
+
+	//One line per replay, the header is written with the first one
+	const FString ReportPath = FPaths::ProjectSavedDir() / TEXT("EventRecordings") / TEXT("ReplayReport.csv");
+	FString Line;
+	if(IFileManager::Get().FileExists(*ReportPath) == false)
+	{
+		Line += TEXT("Recording,Date,Events,SimulatedSeconds,WallSeconds,Frames,AvgFrameMs,MedianFrameMs,P95FrameMs,MaxFrameMs");
+		Line += LINE_TERMINATOR;
+	}
+
+	Line += FString::Printf(TEXT("%s,%s,%d,%.2f,%.3f,%d,%.3f,%.3f,%.3f,%.3f"), *CurrentRecordingName, *FDateTime::Now().ToString(), Recording.Events.Num(),
+		Recording.Duration, WallSeconds, NumFrames, AverageMilliseconds, MedianMilliseconds, P95Milliseconds, MaxMilliseconds);
+	Line += LINE_TERMINATOR;
+
+	FFileHelper::SaveStringToFile(Line, *ReportPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append);
+}
@@ -0,0 +1,172 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PWEventRecordingSubsystem.generated.h"
+
+class ADayNightActor;
+class AInteractable;
+class APWEnemyCharacter;
+class APW_RocketCreation;
+class UPWEnemyGravityStateComponent;
+enum class EPWEnemyGravityState : uint8;
+struct FPWGravityZoneInfo;
+
+enum class EPWRecordedEventType : uint8
+{
+	//A rocket zone appears. Object is the zone id, Value the EPWRecordedRocketFlags of its filter
+	RocketSpawned,
+	//A rocket zone is launched. Object is the zone id
+	RocketLaunched,
+	//An enemy changes of gravity state. Object is the recorded enemy id, Value the new EPWEnemyGravityState.
+	//The enemies of the start snapshot have the id of their index in the snapshot
+	EnemyGravityState,
+	//A wave starts. Value is the index of the wave in the waves enum
+	WaveStarted,
+	//A pickup is dropped
+	PickupSpawned,
+	//The filter of an active rocket zone changes. Object is the zone id, Value the new EPWRecordedRocketFlags
+	RocketFilterChanged
+};
+
+enum class EPWRecordedRocketFlags : uint8
+{
+	AffectsEnemies = 1 << 0,
+	AffectsPlayer = 1 << 1
+};
+
+//One gameplay event, its time is in seconds since the start of the recording
+struct FPWRecordedEvent
+{
+	float Time = 0.0f;
+	EPWRecordedEventType Type = EPWRecordedEventType::RocketSpawned;
+	int32 ClassIndex = INDEX_NONE;
+	int32 Object = INDEX_NONE;
+	int32 Value = 0;
+	FVector3f Location = FVector3f::ZeroVector;
+
+	//Only saved for the rockets
+	FQuat4f Rotation = FQuat4f::Identity;
+
+	friend FArchive& operator<<(FArchive& Ar, FPWRecordedEvent& Event);
+};
+
+//A recording: the world snapshot it starts from, then the events in time order. The class paths are saved once in a table
+struct FPWEventRecording
+{
+	TArray<FString> ClassPaths;
+	TArray<uint8> StartSnapshot;
+	TArray<FPWRecordedEvent> Events;
+	float Duration = 0.0f;
+
+	friend FArchive& operator<<(FArchive& Ar, FPWEventRecording& Recording);
+};
+
+/**
+ * Records the gameplay events that make the cost of the rockets vary, to profile the same event load again and again.
+ * The recording starts from a world snapshot and keeps the rocket spawns, filter changes and launches, the gravity
+ * state transitions of the enemies, the waves of the day night actor and the pickup drops, with their time.
+ * The replay restores the snapshot, then spawns the rockets and the pickups, moves the enemies where they entered,
+ * left the zones and landed, and starts the waves at the recorded times with a fixed time step. The overlaps, the
+ * gravity state and the pickup placement run for real, so the replay costs what the recorded game cost. The players
+ * are not replayed, and the enemies of the replay go back to the pool when it ends. Each replay appends its frame times to Saved/EventRecordings/ReplayReport.csv.
+ * Record with pw.Events.Record and pw.Events.Stop, replay with pw.Events.Replay or with -PWReplayEvents=<Name> -nullrhi.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWEventRecordingSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Start recording the events of this world, saved in Saved/EventRecordings when the recording stops
+	void StartRecording(const FString& RecordingName);
+	void StopRecording();
+
+	//Replay a saved recording, the game exits after it when bExitWhenDone is true. Return false if the file can't be read
+	bool StartReplay(const FString& RecordingName, bool bExitWhenDone);
+	void StopReplay();
+
+	bool IsRecording() const { return bIsRecording; }
+	bool IsReplaying() const { return bIsReplaying; }
+
+	//Simulated seconds of each engine frame during a replay
+	UPROPERTY(Config)
+	float ReplayTimeStep = 1.0f / 30.0f;
+
+private:
+	static FString GetRecordingFilePath(const FString& RecordingName);
+
+	float GetRecordingTime() const;
+	int32 FindOrAddClass(const UClass* Class);
+	void AddEvent(EPWRecordedEventType Type, const UClass* Class, int32 Object, int32 Value, const FVector& Location, const FQuat& Rotation = FQuat::Identity);
+
+	//Recorded events
+	void OnZoneAdded(const FPWGravityZoneInfo& Zone);
+	void OnZoneRemoved(const FPWGravityZoneInfo& Zone);
+	void OnZoneRefreshed(const FPWGravityZoneInfo& Zone);
+	void OnEnemyGravityStateChanged(UPWEnemyGravityStateComponent* GravityState, EPWEnemyGravityState OldState, EPWEnemyGravityState NewState);
+	void OnWaveStarted(int32 WaveIndex);
+	void OnActorSpawned(AActor* SpawnedActor);
+
+	void BindRecordedEvents();
+	void UnbindRecordedEvents();
+
+	//Replayed events
+	void ReplayEvent(const FPWRecordedEvent& Event);
+	void FinishReplay();
+	void WriteReplayReport() const;
+
+	UPROPERTY()
+	TObjectPtr<ADayNightActor> DayNightActor;
+
+	//Recording being written or replayed
+	FPWEventRecording Recording;
+	FString CurrentRecordingName;
+
+	//Recorded ids of the enemies
+	TMap<TWeakObjectPtr<AActor>, int32> RecordedEnemyIds;
+
+	//Last recorded EPWRecordedRocketFlags of each zone, the zones are also refreshed for other changes than their filter
+	TMap<int32, int32> RecordedRocketFilters;
+
+	//Replay state: the classes of the table, the rockets by zone id and the enemies by recorded id
+	UPROPERTY()
+	TArray<TObjectPtr<UClass>> ReplayClasses;
+
+	TMap<int32, TWeakObjectPtr<APW_RocketCreation>> ReplayRockets;
+	TMap<int32, TWeakObjectPtr<APWEnemyCharacter>> ReplayEnemies;
+
+	//Seconds between the spawn and the launch of each recorded zone
+	TMap<int32, float> RecordedRocketLifetimes;
+
+	int32 NextEventIndex = 0;
+	double StartTime = 0.0;
+
+	//Frame times of the replay
+	TArray<float> ReplayFrameMilliseconds;
+	double LastFrameTime = 0.0;
+	double ReplayWallStartTime = 0.0;
+
+	bool bIsRecording = false;
+	bool bIsReplaying = false;
+	bool bExitOnFinish = false;
+
+	//Engine settings before the replay
+	bool bPreviousUseFixedTimeStep = false;
+	double PreviousFixedDeltaTime = 0.0;
+
+	FDelegateHandle ZoneAddedHandle;
+	FDelegateHandle ZoneRemovedHandle;
+	FDelegateHandle ZoneRefreshedHandle;
+	FDelegateHandle EnemyGravityStateHandle;
+	FDelegateHandle WaveStartedHandle;
+	FDelegateHandle ActorSpawnedHandle;
+};
@@ -0,0 +1,573 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Characters/Enemies/Navigation/PWFlightNavigationSubsystem.h"
+#include "Core/PWGameplayStats.h"
+#include "Algo/Reverse.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+
+namespace PWFlightNavigation
+{
+	//Seconds before an agent asks again for a path after a failed search
+	constexpr double FailedRequestRetryDelay = 0.5;
+
+	//Seconds before the path state of an agent that stopped asking for directions is removed
+	constexpr double AgentStateLifetime = 5.0;
+}
+
+void UPWFlightNavigationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Collection.InitializeDependency<UPWGravityZoneSubsystem>();
+	Super::Initialize(Collection);
+
+	//The grid follows the active rocket zones
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		ZoneAddedHandle = GravityZoneSubsystem->OnZoneAdded.AddUObject(this, &UPWFlightNavigationSubsystem::OnZoneAdded);
+		ZoneRemovedHandle = GravityZoneSubsystem->OnZoneRemoved.AddUObject(this, &UPWFlightNavigationSubsystem::OnZoneRemoved);
+	}
+}
+
+void UPWFlightNavigationSubsystem::Deinitialize()
+{
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		GravityZoneSubsystem->OnZoneAdded.Remove(ZoneAddedHandle);
+		GravityZoneSubsystem->OnZoneRemoved.Remove(ZoneRemovedHandle);
+	}
+
+	Cells.Empty();
+	CellsToBuild.Empty();
+	PendingRequests.Empty();
+	ActiveSearch.Reset();
+	PathCache.Empty();
+	AgentStates.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UPWFlightNavigationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWFlightNavigationSubsystem, STATGROUP_Tickables);
+}
+
+FIntVector UPWFlightNavigationSubsystem::WorldToCell(const FVector& Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt(Location.X / CellSize),
+		FMath::FloorToInt(Location.Y / CellSize),
+		FMath::FloorToInt(Location.Z / CellSize));
+}
+
+FVector UPWFlightNavigationSubsystem::CellToWorld(const FIntVector& Cell) const
+{
+	return (FVector(Cell) + FVector(0.5f)) * CellSize;
+}
+
+bool UPWFlightNavigationSubsystem::IsCellFree(const FIntVector& Cell) const
+{
+	//The cells outside the grid and the cells not tested yet can't be used
+	const FPWFlightCell* FlightCell = Cells.Find(Cell);
+	return FlightCell != nullptr && FlightCell->bIsBuilt && FlightCell->bIsBlocked == false;
+}
+
+bool UPWFlightNavigationSubsystem::IsLocationFlyable(const FVector& Location) const
+{
+	return IsCellFree(WorldToCell(Location));
+}
+
+bool UPWFlightNavigationSubsystem::FindNearestFreeCell(const FIntVector& Cell, FIntVector& OutCell) const
+{
+	if(IsCellFree(Cell))
+	{
+		OutCell = Cell;
+		return true;
+	}
+
+	//Closest free cell in the cube of cells around it
+	const int32 SnapRadius = FMath::CeilToInt(MaxSnapDistance / CellSize);
+	int32 BestDistanceSquared = MAX_int32;
+	for(int32 X = -SnapRadius; X <= SnapRadius; ++X)
+	{
+		for(int32 Y = -SnapRadius; Y <= SnapRadius; ++Y)
+		{
+			for(int32 Z = -SnapRadius; Z <= SnapRadius; ++Z)
+			{
+				const int32 DistanceSquared = X * X + Y * Y + Z * Z;
+				const FIntVector Candidate = Cell + FIntVector(X, Y, Z);
+				if(DistanceSquared < BestDistanceSquared && IsCellFree(Candidate))
+				{
+					BestDistanceSquared = DistanceSquared;
+					OutCell = Candidate;
+				}
+			}
+		}
+	}
+
+	return BestDistanceSquared != MAX_int32;
+}
+
+void UPWFlightNavigationSubsystem::GetZoneCells(const FPWGravityZoneInfo& Zone, TArray<FIntVector>& OutCells, FBox& OutBounds) const
+{
+	const float CoveredRadius = Zone.Radius + ZoneMargin;
+	OutBounds = FBox(Zone.Center - FVector(CoveredRadius), Zone.Center + FVector(CoveredRadius));
+
+	const FIntVector MinCell = WorldToCell(OutBounds.Min);
+	const FIntVector MaxCell = WorldToCell(OutBounds.Max);
+	for(int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for(int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			for(int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+			{
+				//Keep only the cells inside the covered sphere
+				const FIntVector Cell(X, Y, Z);
+				if(FVector::DistSquared(CellToWorld(Cell), Zone.Center) <= FMath::Square(CoveredRadius))
+				{
+					OutCells.Add(Cell);
+				}
+			}
+		}
+	}
+}
+
+void UPWFlightNavigationSubsystem::OnZoneAdded(const FPWGravityZoneInfo& Zone)
+{
+	TArray<FIntVector> ZoneCells;
+	FBox ZoneBounds;
+	GetZoneCells(Zone, ZoneCells, ZoneBounds);
+
+	for(const FIntVector& Cell : ZoneCells)
+	{
+		FPWFlightCell& FlightCell = Cells.FindOrAdd(Cell);
+		if(++FlightCell.ZoneRefCount == 1)
+		{
+			//New cell, its blocking test is done on a later frame
+			CellsToBuild.Add(Cell);
+		}
+	}
+
+	//Shorter paths may exist through the new cells
+	InvalidatePaths(ZoneBounds);
+}
+
+void UPWFlightNavigationSubsystem::OnZoneRemoved(const FPWGravityZoneInfo& Zone)
+{
+	TArray<FIntVector> ZoneCells;
+	FBox ZoneBounds;
+	GetZoneCells(Zone, ZoneCells, ZoneBounds);
+
+	for(const FIntVector& Cell : ZoneCells)
+	{
+		if(FPWFlightCell* FlightCell = Cells.Find(Cell))
+		{
+			//Remove the cells that are not covered by another zone
+			if(--FlightCell->ZoneRefCount == 0)
+			{
+				Cells.Remove(Cell);
+			}
+		}
+	}
+
+	InvalidatePaths(ZoneBounds);
+}
+
+void UPWFlightNavigationSubsystem::InvalidatePaths(const FBox& Bounds)
+{
+	//The grid changed under the active search, it is started again on the next frame
+	ActiveSearch.Reset();
+
+	for(auto It = PathCache.CreateIterator(); It; ++It)
+	{
+		if(It.Value()->Bounds.Intersect(Bounds))
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	//The agents following one of those paths ask for a new one
+	for(TPair<TObjectKey<AActor>, FAgentPathState>& AgentState : AgentStates)
+	{
+		if(AgentState.Value.PathHandle.Path.IsValid() && AgentState.Value.PathHandle.Path->Bounds.Intersect(Bounds))
+		{
+			AgentState.Value.PathHandle = FPWFlightPathHandle();
+		}
+	}
+}
+
+void UPWFlightNavigationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	PW_SCOPE_GAMEPLAY_TIME(FlightNavigation);
+
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+
+	//Remove the old paths
+	for(auto It = PathCache.CreateIterator(); It; ++It)
+	{
+		if(CurrentTime - It.Value()->CreationTime > PathLifetime)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	//Remove the agents that landed, from the list of the floating enemies, and the ones that stopped asking for directions
+	TSet<TObjectKey<AActor>> FloatingAgents;
+	if(const UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		FloatingAgents.Reserve(GravityZoneSubsystem->GetNumFloatingEnemies());
+		for(const APWEnemyCharacter* FloatingEnemy : GravityZoneSubsystem->GetFloatingEnemies())
+		{
+			FloatingAgents.Add(FloatingEnemy);
+		}
+	}
+
+	for(auto It = AgentStates.CreateIterator(); It; ++It)
+	{
+		if(FloatingAgents.Contains(It.Key()) == false || CurrentTime - It.Value().LastQueryTime > PWFlightNavigation::AgentStateLifetime)
+		{
+			CancelRequest(It.Value().PendingRequestId);
+			It.RemoveCurrent();
+		}
+	}
+
+	BuildPendingCells();
+	ProcessPathRequests();
+}
+
+void UPWFlightNavigationSubsystem::BuildPendingCells()
+{
+	if(CellsToBuild.IsEmpty())
+	{
+		return;
+	}
+
+	const FCollisionShape CellShape = FCollisionShape::MakeBox(FVector(CellSize * 0.5f));
+	const FCollisionObjectQueryParams ObjectParams(FCollisionObjectQueryParams::AllStaticObjects);
+	const FCollisionQueryParams Params(FName(TEXT("FlightCellTest")), false);
+
+	const int32 NumToBuild = FMath::Min(MaxCellTestsPerFrame, CellsToBuild.Num());
+	for(int32 i = 0; i < NumToBuild; i++)
+	{
+		const FIntVector Cell = CellsToBuild.Pop();
+
+		//The zone of the cell may have been removed since
+		FPWFlightCell* FlightCell = Cells.Find(Cell);
+		if(FlightCell == nullptr)
+		{
+			continue;
+		}
+
+		FlightCell->bIsBlocked = GetWorld()->OverlapAnyTestByObjectType(CellToWorld(Cell), FQuat::Identity, ObjectParams, CellShape, Params);
+		FlightCell->bIsBuilt = true;
+	}
+}
+
+int32 UPWFlightNavigationSubsystem::RequestPath(const FVector& Start, const FVector& Goal, FOnFlightPathReady OnPathReady)
+{
+	FPathRequest& Request = PendingRequests.AddDefaulted_GetRef();
+	Request.RequestId = NextRequestId++;
+	Request.StartCell = WorldToCell(Start);
+	Request.GoalCell = WorldToCell(Goal);
+	Request.OnPathReady = MoveTemp(OnPathReady);
+	return Request.RequestId;
+}
+
+void UPWFlightNavigationSubsystem::CancelRequest(int32 RequestId)
+{
+	if(RequestId == INDEX_NONE)
+	{
+		return;
+	}
+
+	PendingRequests.RemoveAll([RequestId](const FPathRequest& Request) { return Request.RequestId == RequestId; });
+	if(ActiveSearch.RequestId == RequestId)
+	{
+		ActiveSearch.Reset();
+	}
+}
+
+void UPWFlightNavigationSubsystem::ProcessPathRequests()
+{
+	if(PendingRequests.IsEmpty())
+	{
+		return;
+	}
+
+	//Solve the requests in order until the budget of the frame is spent, the search of the first one not solved goes on next frame
+	const double EndTime = FPlatformTime::Seconds() + PathfindingBudgetMs / 1000.0;
+	int32 NumNodesLeft = MaxNodesPerFrame;
+	int32 NumProcessed = 0;
+	while(NumProcessed < PendingRequests.Num())
+	{
+		const FPathRequest& Request = PendingRequests[NumProcessed];
+
+		FPWFlightPathHandle PathHandle;
+		bool bIsSolved = true;
+		if(ActiveSearch.RequestId != Request.RequestId)
+		{
+			FIntVector StartCell;
+			FIntVector GoalCell;
+			if(FindNearestFreeCell(Request.StartCell, StartCell) && FindNearestFreeCell(Request.GoalCell, GoalCell))
+			{
+				PathHandle = FindCachedPath(StartCell, GoalCell);
+				if(PathHandle.IsValid() == false)
+				{
+					StartSearch(Request, StartCell, GoalCell);
+				}
+			}
+		}
+
+		if(ActiveSearch.RequestId == Request.RequestId)
+		{
+			const ESearchResult Result = ContinueSearch(NumNodesLeft, EndTime);
+			if(Result == ESearchResult::InProgress)
+			{
+				bIsSolved = false;
+			}
+			else
+			{
+				if(Result == ESearchResult::Found)
+				{
+					const TSharedPtr<FPWFlightPath> NewPath = BuildSearchPath();
+					NewPath->CreationTime = GetWorld()->GetTimeSeconds();
+					PathCache.Add(ActiveSearch.GoalCell, NewPath);
+					PathHandle.Path = NewPath;
+					PathHandle.PointIndex = 0;
+				}
+				ActiveSearch.Reset();
+			}
+		}
+
+		if(bIsSolved == false)
+		{
+			break;
+		}
+
+		//Copy the delegate, it may queue new requests
+		const FOnFlightPathReady OnPathReady = Request.OnPathReady;
+		++NumProcessed;
+		OnPathReady.ExecuteIfBound(PathHandle);
+
+		if(NumNodesLeft <= 0 || FPlatformTime::Seconds() >= EndTime)
+		{
+			break;
+		}
+	}
+
+	PendingRequests.RemoveAt(0, NumProcessed);
+}
+
+FPWFlightPathHandle UPWFlightNavigationSubsystem::FindCachedPath(const FIntVector& StartCell, const FIntVector& GoalCell) const
+{
+	FPWFlightPathHandle PathHandle;
+
+	//Any path to the same goal going through the start cell can be shared from that cell
+	for(auto It = PathCache.CreateConstKeyIterator(GoalCell); It; ++It)
+	{
+		const int32 CellIndex = It.Value()->Cells.IndexOfByKey(StartCell);
+		if(CellIndex != INDEX_NONE)
+		{
+			PathHandle.Path = It.Value();
+			PathHandle.PointIndex = CellIndex;
+			return PathHandle;
+		}
+	}
+
+	return PathHandle;
+}
+
+void UPWFlightNavigationSubsystem::FPathSearch::Reset()
+{
+	RequestId = INDEX_NONE;
+	OpenHeap.Reset();
+	CostFromStart.Reset();
+	CameFrom.Reset();
+	NumExpanded = 0;
+}
+
+void UPWFlightNavigationSubsystem::StartSearch(const FPathRequest& Request, const FIntVector& StartCell, const FIntVector& GoalCell)
+{
+	ActiveSearch.Reset();
+	ActiveSearch.RequestId = Request.RequestId;
+	ActiveSearch.StartCell = StartCell;
+	ActiveSearch.GoalCell = GoalCell;
+
+	ActiveSearch.OpenHeap.Add({StartCell, static_cast<float>(FVector(StartCell - GoalCell).Size())});
+	ActiveSearch.CostFromStart.Add(StartCell, 0.0f);
+}
+
+UPWFlightNavigationSubsystem::ESearchResult UPWFlightNavigationSubsystem::ContinueSearch(int32& NumNodesLeft, double EndTime)
+{
+	using FOpenNode = FPathSearch::FOpenNode;
+	const FIntVector GoalCell = ActiveSearch.GoalCell;
+	const auto OpenNodePredicate = [](const FOpenNode& A, const FOpenNode& B) { return A.TotalCost < B.TotalCost; };
+	const auto Heuristic = [&GoalCell](const FIntVector& Cell) { return static_cast<float>(FVector(Cell - GoalCell).Size()); };
+
+	TArray<FOpenNode>& OpenHeap = ActiveSearch.OpenHeap;
+	TMap<FIntVector, float>& CostFromStart = ActiveSearch.CostFromStart;
+	TMap<FIntVector, FIntVector>& CameFrom = ActiveSearch.CameFrom;
+
+	while(OpenHeap.Num() > 0)
+	{
+		//No path, or the search was too long
+		if(ActiveSearch.NumExpanded >= MaxNodesPerSearch)
+		{
+			return ESearchResult::Failed;
+		}
+
+		//Go on next frame, the time is only read every few cells
+		if(NumNodesLeft <= 0 || (NumNodesLeft % 32 == 0 && FPlatformTime::Seconds() >= EndTime))
+		{
+			return ESearchResult::InProgress;
+		}
+
+		FOpenNode Current;
+		OpenHeap.HeapPop(Current, OpenNodePredicate);
+
+		const float CurrentCost = CostFromStart.FindChecked(Current.Cell);
+
+		//Skip the nodes that have been pushed again with a better cost
+		if(Current.TotalCost > CurrentCost + Heuristic(Current.Cell) + KINDA_SMALL_NUMBER)
+		{
+			continue;
+		}
+
+		if(Current.Cell == GoalCell)
+		{
+			return ESearchResult::Found;
+		}
+
+		++ActiveSearch.NumExpanded;
+		--NumNodesLeft;
+
+		//The 26 neighbours of the cell
+		for(int32 X = -1; X <= 1; ++X)
+		{
+			for(int32 Y = -1; Y <= 1; ++Y)
+			{
+				for(int32 Z = -1; Z <= 1; ++Z)
+				{
+					if(X == 0 && Y == 0 && Z == 0)
+					{
+						continue;
+					}
+
+					const FIntVector Neighbour = Current.Cell + FIntVector(X, Y, Z);
+					if(IsCellFree(Neighbour) == false)
+					{
+						continue;
+					}
+
+					const float NewCost = CurrentCost + FMath::Sqrt(static_cast<float>(X * X + Y * Y + Z * Z));
+					if(const float* ExistingCost = CostFromStart.Find(Neighbour); ExistingCost != nullptr && *ExistingCost <= NewCost)
+					{
+						continue;
+					}
+
+					CostFromStart.Add(Neighbour, NewCost);
+					CameFrom.Add(Neighbour, Current.Cell);
+					OpenHeap.HeapPush({Neighbour, NewCost + Heuristic(Neighbour)}, OpenNodePredicate);
+				}
+			}
+		}
+	}
+
+	return ESearchResult::Failed;
+}
+
+TSharedPtr<FPWFlightPath> UPWFlightNavigationSubsystem::BuildSearchPath() const
+{
+	//Walk back from the goal to build the path
+	TSharedPtr<FPWFlightPath> Path = MakeShared<FPWFlightPath>();
+	FIntVector Cell = ActiveSearch.GoalCell;
+	Path->Cells.Add(Cell);
+	while(Cell != ActiveSearch.StartCell)
+	{
+		Cell = ActiveSearch.CameFrom.FindChecked(Cell);
+		Path->Cells.Add(Cell);
+	}
+	Algo::Reverse(Path->Cells);
+
+	Path->Points.Reserve(Path->Cells.Num());
+	for(const FIntVector& PathCell : Path->Cells)
+	{
+		const FVector Point = CellToWorld(PathCell);
+		Path->Points.Add(Point);
+		Path->Bounds += Point;
+	}
+	return Path;
+}
+
+bool UPWFlightNavigationSubsystem::GetFlightDirection(const AActor* Agent, const FVector& Goal, FVector& OutDirection)
+{
+	if(Agent == nullptr || Cells.IsEmpty())
+	{
+		return false;
+	}
+
+	//Outside of the grid, an agent against the geometry of a zone still gets a path from the nearest free cell
+	const FVector AgentLocation = Agent->GetActorLocation();
+	if(Cells.Contains(WorldToCell(AgentLocation)) == false)
+	{
+		return false;
+	}
+
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+	const FIntVector GoalCell = WorldToCell(Goal);
+
+	FAgentPathState& AgentState = AgentStates.FindOrAdd(Agent);
+	AgentState.LastQueryTime = CurrentTime;
+
+	//Forget the path when the goal moved to another cell or the path is too old
+	if(AgentState.PathHandle.Path.IsValid() && (AgentState.GoalCell != GoalCell || CurrentTime - AgentState.PathHandle.Path->CreationTime > PathLifetime))
+	{
+		AgentState.PathHandle = FPWFlightPathHandle();
+	}
+
+	if(AgentState.PathHandle.IsValid() == false)
+	{
+		const bool bIsWaitingForPath = AgentState.PendingRequestId != INDEX_NONE && AgentState.GoalCell == GoalCell;
+		const bool bCanRetry = CurrentTime - AgentState.LastFailedRequestTime > PWFlightNavigation::FailedRequestRetryDelay;
+		if(bIsWaitingForPath == false && bCanRetry)
+		{
+			CancelRequest(AgentState.PendingRequestId);
+			AgentState.GoalCell = GoalCell;
+
+			const TObjectKey<AActor> AgentKey(Agent);
+			AgentState.PendingRequestId = RequestPath(AgentLocation, Goal, FOnFlightPathReady::CreateWeakLambda(this, [this, AgentKey, GoalCell](const FPWFlightPathHandle& PathHandle)
+			{
+				FAgentPathState* State = AgentStates.Find(AgentKey);
+				if(State == nullptr || State->GoalCell != GoalCell)
+				{
+					return;
+				}
+
+				State->PendingRequestId = INDEX_NONE;
+				State->PathHandle = PathHandle;
+				if(PathHandle.IsValid() == false)
+				{
+					State->LastFailedRequestTime = GetWorld()->GetTimeSeconds();
+				}
+			}));
+		}
+
+		//Steer directly while the path is computed
+		return false;
+	}
+
+	//Go on to the next point once the current one is reached
+	const TArray<FVector>& Points = AgentState.PathHandle.Path->Points;
+	int32& PointIndex = AgentState.PathHandle.PointIndex;
+	while(PointIndex < Points.Num() - 1 && FVector::DistSquared(AgentLocation, Points[PointIndex]) < FMath::Square(AcceptanceRadius))
+	{
+		++PointIndex;
+	}
+
+	//The last point is the center of the goal cell, fly to the goal itself from there
+	const FVector NextLocation = PointIndex == Points.Num() - 1 ? Goal : Points[PointIndex];
+	OutDirection = (NextLocation - AgentLocation).GetSafeNormal();
+	return true;
+}
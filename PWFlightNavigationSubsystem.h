@@ -0,0 +1,221 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "PWFlightNavigationSubsystem.generated.h"
+
+struct FPWGravityZoneInfo;
+
+//Cell of the sparse flight grid, only the cells around the active gravity zones exist
+struct FPWFlightCell
+{
+	//Number of zones covering the cell, the cell is removed when no zone covers it anymore
+	uint16 ZoneRefCount = 0;
+
+	//The blocking test of the cell has been done
+	bool bIsBuilt = false;
+
+	//The cell overlaps static geometry
+	bool bIsBlocked = false;
+};
+
+//Flight path computed on the grid, shared by every enemy flying through the same cells toward the same goal
+struct FPWFlightPath
+{
+	//Cells of the path, from the start to the goal
+	TArray<FIntVector> Cells;
+
+	//World location of the center of each cell
+	TArray<FVector> Points;
+
+	//Bounds of the path, used to invalidate it when a zone around it changes
+	FBox Bounds = FBox(ForceInit);
+
+	double CreationTime = 0.0;
+};
+
+//A path and the point of it an agent is currently flying to
+struct FPWFlightPathHandle
+{
+	TSharedPtr<const FPWFlightPath> Path;
+	int32 PointIndex = 0;
+
+	bool IsValid() const { return Path.IsValid() && Path->Points.IsValidIndex(PointIndex); }
+};
+
+DECLARE_DELEGATE_OneParam(FOnFlightPathReady, const FPWFlightPathHandle& /*Path*/);
+
+/**
+ * 3D flight pathfinding for the floating enemies.
+ * A sparse voxel grid is built around the active rocket zones (a few cells per frame) and updated incrementally
+ * when a zone appears or disappears. Path requests are queued and solved in order with A* on the game thread.
+ * The search of the oldest request keeps its open set and parents between frames and expands a limited number
+ * of cells each frame, so a long search is spread over several frames. Nothing runs on a worker thread.
+ * The start and goal of a request are snapped to the nearest free cell, as the agents and their targets are often
+ * against the geometry. The paths are cached and shared between the enemies going through the same cells toward the same goal.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWFlightNavigationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Queue a path request, the delegate is called on a later frame with an invalid handle if no path exists
+	int32 RequestPath(const FVector& Start, const FVector& Goal, FOnFlightPathReady OnPathReady);
+
+	//Cancel a queued request
+	void CancelRequest(int32 RequestId);
+
+	//Direction an agent should fly to reach the goal along a flight path.
+	//Requests the path when needed and returns false while the agent has no path, the caller then steers directly
+	bool GetFlightDirection(const AActor* Agent, const FVector& Goal, FVector& OutDirection);
+
+	//Return true if the location is inside a built, free cell of the grid
+	bool IsLocationFlyable(const FVector& Location) const;
+
+	int32 GetNumCells() const { return Cells.Num(); }
+	int32 GetNumPendingRequests() const { return PendingRequests.Num(); }
+	int32 GetNumCachedPaths() const { return PathCache.Num(); }
+
+	//Size of a grid cell
+	UPROPERTY(Config)
+	float CellSize = 100.0f;
+
+	//Extra space around the zones covered by the grid
+	UPROPERTY(Config)
+	float ZoneMargin = 200.0f;
+
+	//Maximum number of cell blocking tests each frame
+	UPROPERTY(Config)
+	int32 MaxCellTestsPerFrame = 256;
+
+	//Time budget in milliseconds for the path requests each frame
+	UPROPERTY(Config)
+	float PathfindingBudgetMs = 1.0f;
+
+	//Maximum number of cells expanded each frame, all the searches together
+	UPROPERTY(Config)
+	int32 MaxNodesPerFrame = 512;
+
+	//Maximum number of cells expanded by one search
+	UPROPERTY(Config)
+	int32 MaxNodesPerSearch = 4096;
+
+	//Distance from the start or the goal of a request at which a free cell is looked for when its own cell is blocked or outside the grid
+	UPROPERTY(Config)
+	float MaxSnapDistance = 300.0f;
+
+	//Seconds a cached path is kept, the targets move so the paths get old quickly
+	UPROPERTY(Config)
+	float PathLifetime = 2.0f;
+
+	//Distance at which an agent goes on to the next point of its path
+	UPROPERTY(Config)
+	float AcceptanceRadius = 75.0f;
+
+private:
+	struct FPathRequest
+	{
+		int32 RequestId = 0;
+		FIntVector StartCell;
+		FIntVector GoalCell;
+		FOnFlightPathReady OnPathReady;
+	};
+
+	//Path followed by an agent
+	struct FAgentPathState
+	{
+		FPWFlightPathHandle PathHandle;
+		FIntVector GoalCell;
+		int32 PendingRequestId = INDEX_NONE;
+		double LastQueryTime = 0.0;
+		double LastFailedRequestTime = -UE_BIG_NUMBER;
+	};
+
+	//A* search of the oldest request, resumed on the next frame when the budget is spent
+	struct FPathSearch
+	{
+		struct FOpenNode
+		{
+			FIntVector Cell;
+			float TotalCost;
+		};
+
+		int32 RequestId = INDEX_NONE;
+
+		//Free cells the start and the goal of the request were snapped to
+		FIntVector StartCell;
+		FIntVector GoalCell;
+
+		TArray<FOpenNode> OpenHeap;
+		TMap<FIntVector, float> CostFromStart;
+		TMap<FIntVector, FIntVector> CameFrom;
+		int32 NumExpanded = 0;
+
+		void Reset();
+	};
+
+	enum class ESearchResult : uint8
+	{
+		InProgress,
+		Found,
+		Failed
+	};
+
+	void OnZoneAdded(const FPWGravityZoneInfo& Zone);
+	void OnZoneRemoved(const FPWGravityZoneInfo& Zone);
+
+	//Cells covering the bounds of a zone
+	void GetZoneCells(const FPWGravityZoneInfo& Zone, TArray<FIntVector>& OutCells, FBox& OutBounds) const;
+
+	//Drop the cached paths going through the bounds
+	void InvalidatePaths(const FBox& Bounds);
+
+	void BuildPendingCells();
+	void ProcessPathRequests();
+
+	//Find a cached path from the start cell to the goal cell, or a cached path to the goal going through the start cell
+	FPWFlightPathHandle FindCachedPath(const FIntVector& StartCell, const FIntVector& GoalCell) const;
+
+	//Start the search of a request on the grid
+	void StartSearch(const FPathRequest& Request, const FIntVector& StartCell, const FIntVector& GoalCell);
+
+	//Expand the cells of the active search until it ends or the budget is spent
+	ESearchResult ContinueSearch(int32& NumNodesLeft, double EndTime);
+
+	//Walk back the parents of the active search from its goal
+	TSharedPtr<FPWFlightPath> BuildSearchPath() const;
+
+	//Nearest free cell within MaxSnapDistance of the cell, the cell itself when it is free
+	bool FindNearestFreeCell(const FIntVector& Cell, FIntVector& OutCell) const;
+
+	bool IsCellFree(const FIntVector& Cell) const;
+	FIntVector WorldToCell(const FVector& Location) const;
+	FVector CellToWorld(const FIntVector& Cell) const;
+
+	TMap<FIntVector, FPWFlightCell> Cells;
+
+	//Cells waiting for their blocking test
+	TArray<FIntVector> CellsToBuild;
+
+	TArray<FPathRequest> PendingRequests;
+	int32 NextRequestId = 1;
+
+	FPathSearch ActiveSearch;
+
+	//Cached paths by goal cell
+	TMultiMap<FIntVector, TSharedPtr<const FPWFlightPath>> PathCache;
+
+	TMap<TObjectKey<AActor>, FAgentPathState> AgentStates;
+
+	FDelegateHandle ZoneAddedHandle;
+	FDelegateHandle ZoneRemovedHandle;
+};
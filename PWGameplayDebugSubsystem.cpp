@@ -0,0 +1,395 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Core/PWGameplayDebugSubsystem.h"
+#include "EngineUtils.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "Characters/Enemies/PWEnemyPoolSubsystem.h"
+#include "Characters/Enemies/Navigation/PWPathRequestQueueSubsystem.h"
+#include "Characters/Player/PWPlayerCharacter.h"
+#include "Components/PrimitiveComponent.h"
+#include "Core/PWGameplayStats.h"
+#include "Core/PWPhysicsQuerySchedulerSubsystem.h"
+#include "Core/PWTimingWheelSubsystem.h"
+#include "Creator/Items/CreationItems/PW_RocketCreation.h"
+#include "Creator/Items/CreationItems/PWGravityZoneShapeSubsystem.h"
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+#include "DayNight/DayNightActor.h"
+#include "Engine/Engine.h"
+#include "Interactor/Interactable.h"
+#include "Interactor/PWPickupMergeSubsystem.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#if PW_WITH_GAMEPLAY_TIMES
+static TAutoConsoleVariable<int32> CVarDebugOverlay(
+	TEXT("pw.Debug.Overlay"),
+	0,
+	TEXT("1 to draw the live gameplay counts and the milliseconds of each gameplay system on screen."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarDebugLogInterval(
+	TEXT("pw.Debug.LogInterval"),
+	0.0f,
+	TEXT("Seconds between two logs of the live gameplay counts and system milliseconds, 0 to never log. Works on a headless server."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarDebugFrameHistory(
+	TEXT("pw.Debug.FrameHistory"),
+	60,
+	TEXT("Number of frames the milliseconds of each gameplay system are averaged over, 240 at most."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorld DumpGameplayDebugCommand(
+	TEXT("pw.Debug.Dump"),
+	TEXT("Log the live gameplay counts and the milliseconds of each gameplay system once."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(const UPWGameplayDebugSubsystem* DebugSubsystem = World != nullptr ? World->GetSubsystem<UPWGameplayDebugSubsystem>() : nullptr)
+		{
+			DebugSubsystem->LogReport();
+		}
+	}));
+
+static TAutoConsoleVariable<float> CVarDebugMemoryLogInterval(
+	TEXT("pw.Debug.MemoryLogInterval"),
+	0.0f,
+	TEXT("Seconds between two samples of the gameplay memory appended to Saved/Profiling/GameplayMemory.csv, 0 to never sample. Works on a headless server."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorld DumpGameplayMemoryCommand(
+	TEXT("pw.Debug.Memory"),
+	TEXT("Log the actors, components and bytes of each gameplay system once."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(const UPWGameplayDebugSubsystem* DebugSubsystem = World != nullptr ? World->GetSubsystem<UPWGameplayDebugSubsystem>() : nullptr)
+		{
+			DebugSubsystem->LogMemoryReport();
+		}
+	}));
+#endif
+
+namespace
+{
+	//Count the actor, its components and the overlap lists of its primitives in the row
+	void AddActorMemory(FPWGameplayMemoryRow& Row, const AActor* Actor)
+	{
+		if(Actor == nullptr)
+		{
+			return;
+		}
+
+		++Row.NumActors;
+		Row.ObjectBytes += Actor->GetClass()->GetStructureSize();
+
+		for(const UActorComponent* Component : Actor->GetComponents())
+		{
+			if(Component == nullptr)
+			{
+				continue;
+			}
+
+			++Row.NumComponents;
+			Row.ObjectBytes += Component->GetClass()->GetStructureSize();
+
+			if(const UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component))
+			{
+				Row.ContainerBytes += Primitive->GetOverlapInfos().GetAllocatedSize();
+			}
+		}
+	}
+}
+
+bool UPWGameplayDebugSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if PW_WITH_GAMEPLAY_TIMES
+	return Super::ShouldCreateSubsystem(Outer);
+#else
+	return false;
+#endif
+}
+
+TStatId UPWGameplayDebugSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWGameplayDebugSubsystem, STATGROUP_Tickables);
+}
+
+void UPWGameplayDebugSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+#if PW_WITH_GAMEPLAY_TIMES
+	const bool bDrawOverlay = CVarDebugOverlay.GetValueOnGameThread() != 0 && GEngine != nullptr && IsRunningDedicatedServer() == false;
+	const float LogInterval = CVarDebugLogInterval.GetValueOnGameThread();
+
+	//Sampled apart from the log, the memory moves much slower than the milliseconds
+	const float MemoryLogInterval = CVarDebugMemoryLogInterval.GetValueOnGameThread();
+	SecondsSinceLastMemorySample += DeltaTime;
+	if(MemoryLogInterval > 0.0f && SecondsSinceLastMemorySample >= MemoryLogInterval)
+	{
+		SecondsSinceLastMemorySample = 0.0f;
+		AppendMemorySample();
+	}
+
+	SecondsSinceLastLog += DeltaTime;
+	const bool bLogNow = LogInterval > 0.0f && SecondsSinceLastLog >= LogInterval;
+
+	//Nothing is gathered while nobody looks
+	if(bDrawOverlay == false && bLogNow == false)
+	{
+		return;
+	}
+
+	TArray<FString> Lines;
+	BuildReport(Lines);
+
+	if(bDrawOverlay)
+	{
+		DrawOverlay(Lines);
+	}
+
+	if(bLogNow)
+	{
+		SecondsSinceLastLog = 0.0f;
+		for(const FString& Line : Lines)
+		{
+			UE_LOG(LogTemp, Log, TEXT("%s"), *Line);
+		}
+	}
+#endif
+}
+
+void UPWGameplayDebugSubsystem::GatherCounts(FPWGameplayDebugCounts& OutCounts) const
+{
+	const UWorld* World = GetWorld();
+
+	if(const UPWGravityZoneSubsystem* GravityZoneSubsystem = World->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		OutCounts.NumRocketZones = GravityZoneSubsystem->GetActiveZones().Num();
+		OutCounts.NumFloatingEnemies = GravityZoneSubsystem->GetNumFloatingEnemies();
+	}
+
+	if(const UPWEnemyPoolSubsystem* EnemyPool = World->GetSubsystem<UPWEnemyPoolSubsystem>())
+	{
+		OutCounts.NumPooledEnemies = EnemyPool->GetNumInactiveEnemies();
+	}
+
+	if(const UPWPathRequestQueueSubsystem* PathRequestQueue = World->GetSubsystem<UPWPathRequestQueueSubsystem>())
+	{
+		OutCounts.NumLandingEnemiesQueued = PathRequestQueue->GetNumQueuedEnemies();
+	}
+
+	if(const UPWTimingWheelSubsystem* TimingWheel = World->GetSubsystem<UPWTimingWheelSubsystem>())
+	{
+		OutCounts.NumLiveTimers = TimingWheel->GetNumLiveTimers();
+		OutCounts.NumTimersExpired = TimingWheel->GetNumExpiredLastFrame();
+	}
+
+	if(const UPWPhysicsQuerySchedulerSubsystem* QueryScheduler = World->GetSubsystem<UPWPhysicsQuerySchedulerSubsystem>())
+	{
+		OutCounts.NumPhysicsQueriesQueued = QueryScheduler->GetQueueDepth();
+		OutCounts.NumPhysicsQueriesDeferred = QueryScheduler->GetNumDeferredLastFrame();
+	}
+
+	for(TActorIterator<APWPlayerCharacter> It(World); It; ++It)
+	{
+		++OutCounts.NumPlayers;
+		if(It->bIsPlayerFlyingInGravityZone || It->NbRocketOverlappingCounter > 0)
+		{
+			++OutCounts.NumPlayersInZones;
+		}
+	}
+
+	for(TActorIterator<AInteractable> It(World); It; ++It)
+	{
+		if(It->IsSpawnAnimationPlaying())
+		{
+			++OutCounts.NumPickupsInFlight;
+		}
+		else
+		{
+			++OutCounts.NumPickupsResting;
+		}
+	}
+}
+
+void UPWGameplayDebugSubsystem::BuildReport(TArray<FString>& OutLines) const
+{
+	FPWGameplayDebugCounts Counts;
+	GatherCounts(Counts);
+
+	OutLines.Add(FString::Printf(TEXT("Rocket zones %d | floating enemies %d | pooled enemies %d | landing queued %d"),
+		Counts.NumRocketZones, Counts.NumFloatingEnemies, Counts.NumPooledEnemies, Counts.NumLandingEnemiesQueued));
+	OutLines.Add(FString::Printf(TEXT("Players in zones %d/%d | pickups in flight %d, resting %d"),
+		Counts.NumPlayersInZones, Counts.NumPlayers, Counts.NumPickupsInFlight, Counts.NumPickupsResting));
+	OutLines.Add(FString::Printf(TEXT("Timers %d (%d expired) | physics queries queued %d (%d deferred)"),
+		Counts.NumLiveTimers, Counts.NumTimersExpired, Counts.NumPhysicsQueriesQueued, Counts.NumPhysicsQueriesDeferred));
+
+#if PW_WITH_GAMEPLAY_TIMES
+	const int32 NumFrames = FMath::Clamp(CVarDebugFrameHistory.GetValueOnGameThread(), 1, PWGameplayTimes::MaxHistoryFrames);
+	float TotalAverageMs = 0.0f;
+	for(int32 SystemIndex = 0; SystemIndex < static_cast<int32>(EPWGameplaySystem::Count); SystemIndex++)
+	{
+		const EPWGameplaySystem System = static_cast<EPWGameplaySystem>(SystemIndex);
+		float AverageMs;
+		float MaxMs;
+		PWGameplayTimes::GetSystemTimes(System, NumFrames, AverageMs, MaxMs);
+		TotalAverageMs += AverageMs;
+
+		OutLines.Add(FString::Printf(TEXT("  %-20s avg %.3f ms  max %.3f ms"), PWGameplayTimes::GetSystemName(System), AverageMs, MaxMs));
+	}
+	OutLines.Add(FString::Printf(TEXT("Gameplay game thread %.3f ms on average over %d frames"), TotalAverageMs, NumFrames));
+#endif
+}
+
+void UPWGameplayDebugSubsystem::LogReport() const
+{
+	TArray<FString> Lines;
+	BuildReport(Lines);
+	for(const FString& Line : Lines)
+	{
+		UE_LOG(LogTemp, Log, TEXT("%s"), *Line);
+	}
+}
+
+void UPWGameplayDebugSubsystem::GatherMemory(TArray<FPWGameplayMemoryRow>& OutRows) const
+{
+	const UWorld* World = GetWorld();
+
+	FPWGameplayMemoryRow& Rockets = OutRows.AddDefaulted_GetRef();
+	Rockets.Name = TEXT("Rockets");
+	for(TActorIterator<APW_RocketCreation> It(World); It; ++It)
+	{
+		//The warm instances of the creation item registry are not rockets of the game
+		if(It->IsActorInitialized())
+		{
+			AddActorMemory(Rockets, *It);
+		}
+	}
+	if(const UPWGravityZoneSubsystem* GravityZoneSubsystem = World->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		Rockets.ContainerBytes += GravityZoneSubsystem->GetAllocatedSize();
+	}
+	if(const UPWGravityZoneShapeSubsystem* ZoneShapeSubsystem = World->GetSubsystem<UPWGravityZoneShapeSubsystem>())
+	{
+		Rockets.ContainerBytes += ZoneShapeSubsystem->GetAllocatedSize();
+	}
+
+	//The pooled enemies are counted with the others, they stay alive in the world
+	FPWGameplayMemoryRow& Enemies = OutRows.AddDefaulted_GetRef();
+	Enemies.Name = TEXT("Enemies");
+	for(TActorIterator<APWEnemyCharacter> It(World); It; ++It)
+	{
+		AddActorMemory(Enemies, *It);
+	}
+	if(const UPWEnemyPoolSubsystem* EnemyPool = World->GetSubsystem<UPWEnemyPoolSubsystem>())
+	{
+		Enemies.ContainerBytes += EnemyPool->GetAllocatedSize();
+	}
+
+	FPWGameplayMemoryRow& Pickups = OutRows.AddDefaulted_GetRef();
+	Pickups.Name = TEXT("Pickups");
+	for(TActorIterator<AInteractable> It(World); It; ++It)
+	{
+		AddActorMemory(Pickups, *It);
+	}
+	if(const UPWPickupMergeSubsystem* PickupMerge = World->GetSubsystem<UPWPickupMergeSubsystem>())
+	{
+		Pickups.ContainerBytes += PickupMerge->GetAllocatedSize();
+	}
+
+	FPWGameplayMemoryRow& DayNight = OutRows.AddDefaulted_GetRef();
+	DayNight.Name = TEXT("Day night");
+	for(TActorIterator<ADayNightActor> It(World); It; ++It)
+	{
+		AddActorMemory(DayNight, *It);
+		DayNight.ContainerBytes += It->LanternArray.GetAllocatedSize() + It->EnemiesPerWave.GetAllocatedSize();
+		for(const FPWWaveEnemies& WaveEnemies : It->EnemiesPerWave)
+		{
+			DayNight.ContainerBytes += WaveEnemies.Enemies.GetAllocatedSize();
+		}
+		for(const APWLantern* Lantern : It->LanternArray)
+		{
+			AddActorMemory(DayNight, Lantern);
+		}
+	}
+
+	FPWGameplayMemoryRow& Timers = OutRows.AddDefaulted_GetRef();
+	Timers.Name = TEXT("Timers");
+	if(const UPWTimingWheelSubsystem* TimingWheel = World->GetSubsystem<UPWTimingWheelSubsystem>())
+	{
+		Timers.ContainerBytes += TimingWheel->GetAllocatedSize();
+	}
+
+	FPWGameplayMemoryRow& PhysicsQueries = OutRows.AddDefaulted_GetRef();
+	PhysicsQueries.Name = TEXT("Physics queries");
+	if(const UPWPhysicsQuerySchedulerSubsystem* QueryScheduler = World->GetSubsystem<UPWPhysicsQuerySchedulerSubsystem>())
+	{
+		PhysicsQueries.ContainerBytes += QueryScheduler->GetAllocatedSize();
+	}
+}
+
+void UPWGameplayDebugSubsystem::BuildMemoryReport(TArray<FString>& OutLines) const
+{
+	TArray<FPWGameplayMemoryRow> Rows;
+	GatherMemory(Rows);
+
+	SIZE_T TotalBytes = 0;
+	for(const FPWGameplayMemoryRow& Row : Rows)
+	{
+		TotalBytes += Row.ObjectBytes + Row.ContainerBytes;
+		OutLines.Add(FString::Printf(TEXT("  %-20s actors %5d  components %6d  objects %8.1f KB  containers %8.1f KB"),
+			Row.Name, Row.NumActors, Row.NumComponents, Row.ObjectBytes / 1024.0, Row.ContainerBytes / 1024.0));
+	}
+
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	OutLines.Add(FString::Printf(TEXT("Gameplay %.1f KB | process %.1f MB used, %.1f MB at most"),
+		TotalBytes / 1024.0, MemoryStats.UsedPhysical / (1024.0 * 1024.0), MemoryStats.PeakUsedPhysical / (1024.0 * 1024.0)));
+}
+
+void UPWGameplayDebugSubsystem::LogMemoryReport() const
+{
+	TArray<FString> Lines;
+	BuildMemoryReport(Lines);
+	for(const FString& Line : Lines)
+	{
+		UE_LOG(LogTemp, Log, TEXT("%s"), *Line);
+	}
+}
+
+void UPWGameplayDebugSubsystem::AppendMemorySample() const
+{
+	TArray<FPWGameplayMemoryRow> Rows;
+	GatherMemory(Rows);
+
+	const FString FilePath = FPaths::ProjectSavedDir() / TEXT("Profiling") / TEXT("GameplayMemory.csv");
+	FString Text;
+	if(IFileManager::Get().FileExists(*FilePath) == false)
+	{
+		Text = TEXT("Time,UsedPhysicalMB");
+		for(const FPWGameplayMemoryRow& Row : Rows)
+		{
+			Text += FString::Printf(TEXT(",%s actors,%s components,%s bytes"), Row.Name, Row.Name, Row.Name);
+		}
+		Text += LINE_TERMINATOR;
+	}
+
+	Text += FString::Printf(TEXT("%.2f,%.1f"), GetWorld()->GetTimeSeconds(), FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0));
+	for(const FPWGameplayMemoryRow& Row : Rows)
+	{
+		Text += FString::Printf(TEXT(",%d,%d,%llu"), Row.NumActors, Row.NumComponents, static_cast<uint64>(Row.ObjectBytes + Row.ContainerBytes));
+	}
+	Text += LINE_TERMINATOR;
+
+	FFileHelper::SaveStringToFile(Text, *FilePath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append);
+}
+
+void UPWGameplayDebugSubsystem::DrawOverlay(const TArray<FString>& Lines) const
+{
+	//Fixed keys, each line replaces itself every frame and fades out soon after the overlay is turned off
+	const uint64 FirstKey = 0x50574442;
+	for(int32 i = 0; i < Lines.Num(); i++)
+	{
+		GEngine->AddOnScreenDebugMessage(FirstKey + i, 0.5f, i < 3 ? FColor::Cyan : FColor::White, Lines[i]);
+	}
+}
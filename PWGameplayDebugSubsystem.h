@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PWGameplayDebugSubsystem.generated.h"
+
+//Live counts of the gameplay objects
+struct FPWGameplayDebugCounts
+{
+	int32 NumRocketZones = 0;
+	int32 NumFloatingEnemies = 0;
+	int32 NumPooledEnemies = 0;
+	int32 NumLandingEnemiesQueued = 0;
+	int32 NumPlayers = 0;
+	int32 NumPlayersInZones = 0;
+	int32 NumPickupsInFlight = 0;
+	int32 NumPickupsResting = 0;
+	int32 NumLiveTimers = 0;
+	int32 NumTimersExpired = 0;
+	int32 NumPhysicsQueriesQueued = 0;
+	int32 NumPhysicsQueriesDeferred = 0;
+};
+
+//Memory of one gameplay system: its actors with their components, and the containers it keeps
+struct FPWGameplayMemoryRow
+{
+	const TCHAR* Name = TEXT("");
+	int32 NumActors = 0;
+	int32 NumComponents = 0;
+
+	//Size of the actor and component objects, without what they allocate
+	SIZE_T ObjectBytes = 0;
+
+	//Heap bytes of the arrays and maps of the system, the overlap lists of its components included
+	SIZE_T ContainerBytes = 0;
+};
+
+/**
+ * Shows what the rockets, the enemies and the pickups cost while playing, to find the cause of a spike.
+ * The live counts and the game thread milliseconds of each gameplay system over the last frames are drawn on screen
+ * with pw.Debug.Overlay, logged once with pw.Debug.Dump, or logged periodically with pw.Debug.LogInterval,
+ * which also works on a headless server. Not available in the shipping builds.
+ * The memory of each system is logged once with pw.Debug.Memory, or sampled to Saved/Profiling/GameplayMemory.csv
+ * with pw.Debug.MemoryLogInterval to follow it over a long headless run. The allocations themselves are tagged for
+ * the low level memory tracker, see PWGameplayStats.h.
+ */
+UCLASS()
+class PROJECTWATER_API UPWGameplayDebugSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void GatherCounts(FPWGameplayDebugCounts& OutCounts) const;
+
+	//The counts, then one line per system with its average and maximum milliseconds over the last frames
+	void BuildReport(TArray<FString>& OutLines) const;
+
+	void LogReport() const;
+
+	void GatherMemory(TArray<FPWGameplayMemoryRow>& OutRows) const;
+
+	//One line per system with its actors, components and bytes, then the memory used by the process
+	void BuildMemoryReport(TArray<FString>& OutLines) const;
+
+	void LogMemoryReport() const;
+
+private:
+	void DrawOverlay(const TArray<FString>& Lines) const;
+
+	//Append one line of memory to the csv, the header is written with the first line of the file
+	void AppendMemorySample() const;
+
+	float SecondsSinceLastLog = 0.0f;
+	float SecondsSinceLastMemorySample = 0.0f;
+};
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Core/PWGameplayStats.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DelayedAutoRegister.h"
+
+DEFINE_STAT(STAT_PWLiveWheelTimers);
+DEFINE_STAT(STAT_PWWheelTimerExpirations);
+DEFINE_STAT(STAT_PWGravityZoneReplicatedBytes);
+DEFINE_STAT(STAT_PWGravityField);
+DEFINE_STAT(STAT_PWGravityZoneShapes);
+DEFINE_STAT(STAT_PWPhysicsQueryQueueDepth);
+DEFINE_STAT(STAT_PWPhysicsQueriesRun);
+DEFINE_STAT(STAT_PWPhysicsQueriesDeferred);
+DEFINE_STAT(STAT_PWPhysicsQueryScheduler);
+DEFINE_STAT(STAT_PWPickupsMerged);
+
+LLM_DEFINE_TAG(PWRockets);
+LLM_DEFINE_TAG(PWEnemies);
+LLM_DEFINE_TAG(PWPickups);
+LLM_DEFINE_TAG(PWDayNight);
+
+#if PW_WITH_GAMEPLAY_TIMES
+namespace PWGameplayTimes
+{
+	constexpr int32 NumSystems = static_cast<int32>(EPWGameplaySystem::Count);
+
+	//Only touched on the game thread
+	FScopedSystemTime* CurrentScope = nullptr;
+	uint64 CurrentFrameCycles[NumSystems] = {};
+	float FrameHistoryMs[MaxHistoryFrames][NumSystems] = {};
+	int32 NextHistoryFrame = 0;
+	int32 NumHistoryFrames = 0;
+
+	//Close the times of the frame
+	void EndFrame()
+	{
+		for(int32 SystemIndex = 0; SystemIndex < NumSystems; SystemIndex++)
+		{
+			FrameHistoryMs[NextHistoryFrame][SystemIndex] = static_cast<float>(FPlatformTime::ToMilliseconds64(CurrentFrameCycles[SystemIndex]));
+			CurrentFrameCycles[SystemIndex] = 0;
+		}
+
+		NextHistoryFrame = (NextHistoryFrame + 1) % MaxHistoryFrames;
+		NumHistoryFrames = FMath::Min(NumHistoryFrames + 1, MaxHistoryFrames);
+	}
+
+	static FDelayedAutoRegisterHelper RegisterEndFrame(EDelayedRegisterRunPhase::EndOfEngineInit, []
+	{
+		FCoreDelegates::OnEndFrame.AddStatic(&EndFrame);
+	});
+
+	FScopedSystemTime::FScopedSystemTime(EPWGameplaySystem InSystem)
+		: System(InSystem)
+		, bIsGameThread(IsInGameThread())
+	{
+		if(bIsGameThread)
+		{
+			Parent = CurrentScope;
+			CurrentScope = this;
+			StartCycles = FPlatformTime::Cycles64();
+		}
+	}
+
+	FScopedSystemTime::~FScopedSystemTime()
+	{
+		if(bIsGameThread == false)
+		{
+			return;
+		}
+
+		const uint64 ElapsedCycles = FPlatformTime::Cycles64() - StartCycles;
+		CurrentFrameCycles[static_cast<int32>(System)] += ElapsedCycles - FMath::Min(ChildCycles, ElapsedCycles);
+		if(Parent != nullptr)
+		{
+			Parent->ChildCycles += ElapsedCycles;
+		}
+		CurrentScope = Parent;
+	}
+
+	void GetSystemTimes(EPWGameplaySystem System, int32 NumFrames, float& OutAverageMs, float& OutMaxMs)
+	{
+		OutAverageMs = 0.0f;
+		OutMaxMs = 0.0f;
+
+		NumFrames = FMath::Min(NumFrames, NumHistoryFrames);
+		if(NumFrames <= 0)
+		{
+			return;
+		}
+
+		for(int32 i = 1; i <= NumFrames; i++)
+		{
+			const float FrameMs = FrameHistoryMs[(NextHistoryFrame - i + MaxHistoryFrames) % MaxHistoryFrames][static_cast<int32>(System)];
+			OutAverageMs += FrameMs;
+			OutMaxMs = FMath::Max(OutMaxMs, FrameMs);
+		}
+		OutAverageMs /= NumFrames;
+	}
+
+	const TCHAR* GetSystemName(EPWGameplaySystem System)
+	{
+		switch (System)
+		{
+			case EPWGameplaySystem::Rockets:			return TEXT("Rockets");
+			case EPWGameplaySystem::Pickups:			return TEXT("Pickups");
+			case EPWGameplaySystem::Timers:				return TEXT("Timers");
+			case EPWGameplaySystem::GravityField:		return TEXT("Gravity field");
+			case EPWGameplaySystem::ZoneShapes:			return TEXT("Zone shapes");
+			case EPWGameplaySystem::ZoneReplication:	return TEXT("Zone replication");
+			case EPWGameplaySystem::EnemyPool:			return TEXT("Enemy pool");
+			case EPWGameplaySystem::EnemySignificance:	return TEXT("Enemy significance");
+			case EPWGameplaySystem::MassEnemies:		return TEXT("Mass enemies");
+			case EPWGameplaySystem::FlightNavigation:	return TEXT("Flight navigation");
+			case EPWGameplaySystem::PathQueue:			return TEXT("Path queue");
+			case EPWGameplaySystem::PhysicsQueries:		return TEXT("Physics queries");
+			case EPWGameplaySystem::PlacementPreview:	return TEXT("Placement preview");
+			default:									return TEXT("Unknown");
+		}
+	}
+}
+#endif
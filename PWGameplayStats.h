@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "HAL/LowLevelMemTracker.h"
+
+//Stats of the gameplay systems, shown with "stat PWGameplay"
+DECLARE_STATS_GROUP(TEXT("PWGameplay"), STATGROUP_PWGameplay, STATCAT_Advanced);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live wheel timers"), STAT_PWLiveWheelTimers, STATGROUP_PWGameplay, PROJECTWATER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Wheel timer expirations"), STAT_PWWheelTimerExpirations, STATGROUP_PWGameplay, PROJECTWATER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Gravity zone replicated bytes/s"), STAT_PWGravityZoneReplicatedBytes, STATGROUP_PWGameplay, PROJECTWATER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gravity field"), STAT_PWGravityField, STATGROUP_PWGameplay, PROJECTWATER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gravity zone shapes"), STAT_PWGravityZoneShapes, STATGROUP_PWGameplay, PROJECTWATER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Physics query queue depth"), STAT_PWPhysicsQueryQueueDepth, STATGROUP_PWGameplay, PROJECTWATER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Physics queries run"), STAT_PWPhysicsQueriesRun, STATGROUP_PWGameplay, PROJECTWATER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Physics queries deferred"), STAT_PWPhysicsQueriesDeferred, STATGROUP_PWGameplay, PROJECTWATER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Physics query scheduler"), STAT_PWPhysicsQueryScheduler, STATGROUP_PWGameplay, PROJECTWATER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Pickups merged"), STAT_PWPickupsMerged, STATGROUP_PWGameplay, PROJECTWATER_API);
+
+//Low level memory tags of the gameplay systems, run with -llm and shown with "stat LLMFULL".
+//The actors are tagged where this module spawns them: the pooled enemies, the pickup bursts, the snapshot restores,
+//the replays and the wave simulation. The actors spawned by the blueprints (crafted rockets, enemy drops) are only tagged
+//from their BeginPlay on, and the enemies the wave spawner spawns outside of the pool aren't tagged at all
+LLM_DECLARE_TAG_API(PWRockets, PROJECTWATER_API);
+LLM_DECLARE_TAG_API(PWEnemies, PROJECTWATER_API);
+LLM_DECLARE_TAG_API(PWPickups, PROJECTWATER_API);
+LLM_DECLARE_TAG_API(PWDayNight, PROJECTWATER_API);
+
+//Exclusive game thread time of the gameplay systems, kept for the last frames and shown by UPWGameplayDebugSubsystem
+#define PW_WITH_GAMEPLAY_TIMES !UE_BUILD_SHIPPING
+
+enum class EPWGameplaySystem : uint8
+{
+	Rockets,
+	Pickups,
+	Timers,
+	GravityField,
+	ZoneShapes,
+	ZoneReplication,
+	EnemyPool,
+	EnemySignificance,
+	MassEnemies,
+	FlightNavigation,
+	PathQueue,
+	PhysicsQueries,
+	PlacementPreview,
+
+	Count
+};
+
+#if PW_WITH_GAMEPLAY_TIMES
+namespace PWGameplayTimes
+{
+	constexpr int32 MaxHistoryFrames = 240;
+
+	//Times the scope on the game thread. The time of the scopes of other systems opened inside is given to them, not to this one
+	struct PROJECTWATER_API FScopedSystemTime
+	{
+		explicit FScopedSystemTime(EPWGameplaySystem InSystem);
+		~FScopedSystemTime();
+
+	private:
+		FScopedSystemTime* Parent = nullptr;
+		uint64 StartCycles = 0;
+		uint64 ChildCycles = 0;
+		EPWGameplaySystem System;
+		bool bIsGameThread = false;
+	};
+
+	//Average and maximum milliseconds of a system over the last frames
+	PROJECTWATER_API void GetSystemTimes(EPWGameplaySystem System, int32 NumFrames, float& OutAverageMs, float& OutMaxMs);
+
+	PROJECTWATER_API const TCHAR* GetSystemName(EPWGameplaySystem System);
+}
+
+#define PW_SCOPE_GAMEPLAY_TIME(System) PWGameplayTimes::FScopedSystemTime PREPROCESSOR_JOIN(PWGameplayTime, __LINE__)(EPWGameplaySystem::System)
+#else
+#define PW_SCOPE_GAMEPLAY_TIME(System)
+#endif
@@ -0,0 +1,407 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Creator/Items/CreationItems/PWGravityFieldSubsystem.h"
+#include "Async/ParallelFor.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "EngineUtils.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "Characters/Enemies/PWEnemyGravityStateComponent.h"
+#include "Characters/Enemies/PWEnemyMovementComponent.h"
+#include "Characters/Enemies/PWEnemyPoolSubsystem.h"
+#include "Characters/Enemies/Controllers/BlackboardKeys.h"
+#include "Characters/Enemies/Controllers/PWEnemyController.h"
+#include "Characters/Enemies/Navigation/PWPathRequestQueueSubsystem.h"
+#include "Characters/Player/PWPlayerCharacter.h"
+#include "Characters/Player/PWPlayerRocketStateComponent.h"
+#include "Core/PWGameplayStats.h"
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+static TAutoConsoleVariable<int32> CVarGravityFieldMode(
+	TEXT("pw.GravityZone.FieldMode"),
+	0,
+	TEXT("1 to replace the enter and exit overlaps of the rockets by a continuous gravity field with falloff."),
+	ECVF_Default);
+
+//Air control of the player out of the rocket zones
+static constexpr float PlayerDefaultAirControl = 0.2f;
+
+//Air control of the enemies out of the rocket zones, the same value the rockets and the enemy pool give back
+static constexpr float EnemyDefaultAirControl = 0.2f;
+
+bool UPWGravityFieldSubsystem::IsFieldModeEnabled()
+{
+	return CVarGravityFieldMode.GetValueOnGameThread() != 0;
+}
+
+FPWGravityFieldSample UPWGravityFieldSubsystem::SampleField(TConstArrayView<FPWGravityZoneInfo> Zones, const FVector& Location, const UClass* PawnClass, bool bIsPlayer, const FPWGravityFieldSettings& Settings)
+{
+	FPWGravityFieldSample Sample;
+
+	float StrengthSum = 0.0f;
+	float RemainingGravity = 1.0f;
+	float GravityScaleSum = 0.0f;
+	float ZoneSpeedSum = 0.0f;
+	float AirControlSum = 0.0f;
+	float ZVelocitySum = 0.0f;
+	float FrictionSum = 0.0f;
+
+	for(const FPWGravityZoneInfo& Zone : Zones)
+	{
+		if(bIsPlayer ? Zone.CanAffectPlayerClass(PawnClass) == false : Zone.CanAffectEnemyClass(PawnClass) == false)
+		{
+			continue;
+		}
+
+		//The field follows the surface of the volume. The distances are scaled by the inner radius of the shape,
+		//so a sphere zone gets a field of FieldRadiusScale times its radius
+		const float InnerRadius = Zone.Shape.GetInnerRadius();
+		if(InnerRadius <= 0.0f || Settings.FieldRadiusScale <= 0.0f)
+		{
+			continue;
+		}
+
+		const float FieldDistance = InnerRadius * (Settings.FieldRadiusScale - 1.0f);
+		if(FVector::DistSquared(Zone.Center, Location) >= FMath::Square(Zone.Radius + FMath::Max(FieldDistance, 0.0f)))
+		{
+			continue;
+		}
+
+		const float SignedDistance = Zone.Shape.GetSignedDistance(Location);
+		if(SignedDistance >= FieldDistance)
+		{
+			continue;
+		}
+
+		//Full strength deep in the zone, then falls off to 0 at the edge of the field
+		const float FullStrengthDistance = InnerRadius * (Settings.FieldRadiusScale * Settings.FullStrengthRatio - 1.0f);
+		const float FalloffAlpha = (SignedDistance - FullStrengthDistance) / FMath::Max(FieldDistance - FullStrengthDistance, UE_KINDA_SMALL_NUMBER);
+		const float Strength = SignedDistance <= FullStrengthDistance ? 1.0f : FMath::Pow(1.0f - FMath::Clamp(FalloffAlpha, 0.0f, 1.0f), Settings.FalloffExponent);
+		if(Strength <= 0.0f)
+		{
+			continue;
+		}
+
+		++Sample.NumZones;
+		StrengthSum += Strength;
+
+		//The zones combine like independent probabilities, two half zones give 0.75 and the strength never goes above 1
+		RemainingGravity *= 1.0f - Strength;
+
+		GravityScaleSum += Strength * (bIsPlayer ? Zone.PlayerGravityScale : Zone.EnemyGravityScale);
+		ZoneSpeedSum += Strength * Zone.EnemyGravityZoneSpeed;
+		AirControlSum += Strength * Zone.PlayerAirControl;
+		ZVelocitySum += Strength * Zone.PlayerZVelocity;
+		FrictionSum += Strength * Zone.PlayerMovementFriction;
+	}
+
+	if(StrengthSum > 0.0f)
+	{
+		Sample.Strength = 1.0f - RemainingGravity;
+		Sample.GravityScale = GravityScaleSum / StrengthSum;
+		Sample.ZoneSpeed = ZoneSpeedSum / StrengthSum;
+		Sample.PlayerAirControl = AirControlSum / StrengthSum;
+		Sample.PlayerZVelocity = ZVelocitySum / StrengthSum;
+		Sample.PlayerMovementFriction = FrictionSum / StrengthSum;
+	}
+
+	return Sample;
+}
+
+bool UPWGravityFieldSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	//The pawns of the editor and preview worlds are never moved by the field
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPWGravityFieldSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Collection.InitializeDependency<UPWGravityZoneSubsystem>();
+	Super::Initialize(Collection);
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UPWGravityFieldSubsystem::OnActorSpawned));
+}
+
+void UPWGravityFieldSubsystem::Deinitialize()
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	FieldPawns.Empty();
+
+	Super::Deinitialize();
+}
+
+void UPWGravityFieldSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//The pawns placed in the level
+	for(TActorIterator<ACharacter> It(&InWorld); It; ++It)
+	{
+		RegisterPawn(*It);
+	}
+}
+
+TStatId UPWGravityFieldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWGravityFieldSubsystem, STATGROUP_Tickables);
+}
+
+void UPWGravityFieldSubsystem::OnActorSpawned(AActor* SpawnedActor)
+{
+	RegisterPawn(SpawnedActor);
+}
+
+void UPWGravityFieldSubsystem::RegisterPawn(AActor* Actor)
+{
+	const bool bIsPlayer = Actor->IsA<APWPlayerCharacter>();
+	if(bIsPlayer == false && Actor->IsA<APWEnemyCharacter>() == false)
+	{
+		return;
+	}
+
+	ACharacter* Character = CastChecked<ACharacter>(Actor);
+	if(FieldPawns.ContainsByPredicate([Character](const FFieldPawn& FieldPawn) { return FieldPawn.Character == Character; }))
+	{
+		return;
+	}
+
+	FFieldPawn& NewPawn = FieldPawns.AddDefaulted_GetRef();
+	NewPawn.Character = Character;
+	NewPawn.bIsPlayer = bIsPlayer;
+}
+
+void UPWGravityFieldSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_PWGravityField);
+	PW_SCOPE_GAMEPLAY_TIME(GravityField);
+
+	if(IsFieldModeEnabled() == false)
+	{
+		if(bHasPawnsInField)
+		{
+			ReleaseAllPawns();
+		}
+		return;
+	}
+
+	const UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>();
+	if(GravityZoneSubsystem == nullptr || (GravityZoneSubsystem->GetActiveZones().IsEmpty() && bHasPawnsInField == false))
+	{
+		return;
+	}
+	const TArray<FPWGravityZoneInfo>& Zones = GravityZoneSubsystem->GetActiveZones();
+
+	FieldPawns.RemoveAllSwap([](const FFieldPawn& FieldPawn) { return FieldPawn.Character.IsValid() == false; });
+
+	//Pack what the batch reads, the workers never touch the actors
+	const int32 NumPawns = FieldPawns.Num();
+	PawnLocations.SetNumUninitialized(NumPawns);
+	PawnClasses.SetNumUninitialized(NumPawns);
+	PawnSamples.SetNum(NumPawns);
+	for(int32 i = 0; i < NumPawns; i++)
+	{
+		const ACharacter* Character = FieldPawns[i].Character.Get();
+		PawnLocations[i] = Character->GetActorLocation();
+		PawnClasses[i] = Character->GetClass();
+	}
+
+	ParallelFor(NumPawns, [this, &Zones](int32 PawnIndex)
+	{
+		PawnSamples[PawnIndex] = SampleField(Zones, PawnLocations[PawnIndex], PawnClasses[PawnIndex], FieldPawns[PawnIndex].bIsPlayer, FieldSettings);
+	}, NumPawns < MinPawnsForParallelBatch ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+	//Apply the resolved values on the game thread
+	const UPWEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UPWEnemyPoolSubsystem>();
+	bHasPawnsInField = false;
+	for(int32 i = 0; i < NumPawns; i++)
+	{
+		FFieldPawn& FieldPawn = FieldPawns[i];
+		if(FieldPawn.bIsPlayer)
+		{
+			ApplyToPlayer(FieldPawn, PawnSamples[i]);
+		}
+		else if(EnemyPool != nullptr && EnemyPool->IsPooled(Cast<APWEnemyCharacter>(FieldPawn.Character.Get())))
+		{
+			//The pool already gave back the default state to the enemy
+			FieldPawn.bFloating = false;
+			FieldPawn.bInField = false;
+		}
+		else
+		{
+			ApplyToEnemy(FieldPawn, PawnSamples[i]);
+		}
+
+		bHasPawnsInField |= FieldPawn.bInField || FieldPawn.bFloating;
+	}
+}
+
+void UPWGravityFieldSubsystem::ApplyToEnemy(FFieldPawn& FieldPawn, const FPWGravityFieldSample& Sample) const
+{
+	APWEnemyCharacter* Enemy = Cast<APWEnemyCharacter>(FieldPawn.Character.Get());
+	UPWEnemyMovementComponent* MovementComponent = Enemy != nullptr ? Cast<UPWEnemyMovementComponent>(Enemy->GetCharacterMovement()) : nullptr;
+	if(MovementComponent == nullptr || Enemy->HasAuthority() == false)
+	{
+		//The clients receive the movement of the enemies from the server
+		return;
+	}
+
+	if(Enemy->NbRocketOverlappingCounter != Sample.NumZones)
+	{
+		Enemy->setNumberOfOverlappingRocket(Sample.NumZones);
+	}
+
+	UPWEnemyGravityStateComponent* GravityState = UPWEnemyGravityStateComponent::FindGravityState(Enemy);
+	const APWEnemyController* AIController = Cast<APWEnemyController>(Enemy->GetController());
+
+	if(FieldPawn.bFloating == false && Sample.Strength >= FieldSettings.FloatThreshold)
+	{
+		//Same as entering a rocket zone
+		MovementComponent->Velocity = FVector::ZeroVector;
+		MovementComponent->SetUseAccelerationForPaths(false);
+		MovementComponent->SetMovementMode(EMovementMode::MOVE_Flying);
+		MovementComponent->AirControl = 1.0f;
+		Enemy->bIsInGravityZone = true;
+		Enemy->LaunchCharacter(FVector(0, 0, 10), false, true);
+		FieldPawn.bFloating = true;
+
+		if(GravityState != nullptr)
+		{
+			GravityState->EnterGravityZone();
+		}
+
+		if(AIController != nullptr)
+		{
+			AIController->GetBlackboard()->SetValueAsBool(BBKeys::GravityEnabled, true);
+		}
+	}
+	else if(FieldPawn.bFloating == true && Sample.Strength < FieldSettings.LandThreshold)
+	{
+		//Same as leaving the last rocket zone
+		MovementComponent->SetUseAccelerationForPaths(true);
+		MovementComponent->SetMovementMode(EMovementMode::MOVE_Walking);
+		MovementComponent->AirControl = EnemyDefaultAirControl;
+		Enemy->bIsInGravityZone = false;
+		FieldPawn.bFloating = false;
+
+		if(GravityState != nullptr)
+		{
+			GravityState->LeaveGravityZone();
+		}
+
+		if(UPWPathRequestQueueSubsystem* PathRequestQueue = GetWorld()->GetSubsystem<UPWPathRequestQueueSubsystem>())
+		{
+			PathRequestQueue->EnqueueLandingEnemy(Enemy);
+		}
+		else
+		{
+			if(AIController != nullptr)
+			{
+				AIController->GetBlackboard()->SetValueAsBool(BBKeys::GravityEnabled, false);
+			}
+
+			if(GravityState != nullptr)
+			{
+				GravityState->FinishLanding();
+			}
+		}
+	}
+
+	//One resolved gravity and speed, a strength of 0 gives back the default values once
+	if(Sample.NumZones > 0 || FieldPawn.bInField)
+	{
+		MovementComponent->GravityScale = FMath::Lerp(1.0f, Sample.GravityScale, Sample.Strength);
+		MovementComponent->MaxWalkSpeed = FMath::Lerp(Enemy->GetMovementSpeed(), Sample.ZoneSpeed, Sample.Strength);
+	}
+	FieldPawn.bInField = Sample.NumZones > 0;
+}
+
+void UPWGravityFieldSubsystem::ApplyToPlayer(FFieldPawn& FieldPawn, const FPWGravityFieldSample& Sample) const
+{
+	APWPlayerCharacter* Player = Cast<APWPlayerCharacter>(FieldPawn.Character.Get());
+	UCharacterMovementComponent* MovementComponent = Player != nullptr ? Player->GetCharacterMovement() : nullptr;
+	if(MovementComponent == nullptr || Player->HasAuthority() == false)
+	{
+		//Same as the rockets, only the server changes the movement
+		return;
+	}
+
+	if(Player->NbRocketOverlappingCounter != Sample.NumZones)
+	{
+		Player->setNumberOfOverlappingRocketForPlayer(Sample.NumZones);
+	}
+
+	if(FieldPawn.bFloating == false && Sample.Strength >= FieldSettings.FloatThreshold)
+	{
+		//Same as entering a rocket zone
+		MovementComponent->Velocity = FVector::ZeroVector;
+		MovementComponent->AirControl = Sample.PlayerAirControl;
+		MovementComponent->SetMovementMode(EMovementMode::MOVE_Flying);
+		MovementComponent->BrakingDecelerationFalling = Sample.PlayerMovementFriction;
+		Player->LaunchCharacter(FVector(0, 0, 5), false, true);
+		Player->bIsPlayerFlyingInGravityZone = true;
+		Player->GravityZoneZVelocity = Sample.PlayerZVelocity;
+		FieldPawn.bFloating = true;
+	}
+	else if(FieldPawn.bFloating == true && Sample.Strength < FieldSettings.LandThreshold)
+	{
+		//Same as leaving the last rocket zone
+		MovementComponent->AirControl = PlayerDefaultAirControl;
+		MovementComponent->SetMovementMode(EMovementMode::MOVE_Walking);
+		MovementComponent->BrakingDecelerationFalling = 0.0f;
+		Player->bIsPlayerFlyingInGravityZone = false;
+		FieldPawn.bFloating = false;
+	}
+
+	//The movement goes from its values out of the zones to the values of the zones with the strength,
+	//the jump itself stays owned by the rocket state of the player
+	if(Sample.NumZones > 0 || FieldPawn.bInField)
+	{
+		const UPWPlayerRocketStateComponent* RocketState = UPWPlayerRocketStateComponent::FindRocketState(Player);
+		const float BaseGravityScale = RocketState != nullptr ? RocketState->GetBaseGravityScale() : 1.0f;
+
+		MovementComponent->GravityScale = FMath::Lerp(BaseGravityScale, Sample.GravityScale, Sample.Strength);
+		MovementComponent->AirControl = FMath::Lerp(PlayerDefaultAirControl, Sample.PlayerAirControl, Sample.Strength);
+		MovementComponent->BrakingDecelerationFalling = FMath::Lerp(0.0f, Sample.PlayerMovementFriction, Sample.Strength);
+		if(FieldPawn.bFloating)
+		{
+			Player->GravityZoneZVelocity = Sample.PlayerZVelocity * Sample.Strength;
+		}
+	}
+	FieldPawn.bInField = Sample.NumZones > 0;
+}
+
+void UPWGravityFieldSubsystem::ResetPawnStates()
+{
+	for(FFieldPawn& FieldPawn : FieldPawns)
+	{
+		FieldPawn.bFloating = false;
+		FieldPawn.bInField = false;
+	}
+
+	bHasPawnsInField = false;
+}
+
+void UPWGravityFieldSubsystem::ReleaseAllPawns()
+{
+	//A sample of strength 0 lands the pawns and gives back their default values
+	const FPWGravityFieldSample EmptySample;
+	for(FFieldPawn& FieldPawn : FieldPawns)
+	{
+		if(FieldPawn.Character.IsValid() && (FieldPawn.bFloating || FieldPawn.bInField))
+		{
+			if(FieldPawn.bIsPlayer)
+			{
+				ApplyToPlayer(FieldPawn, EmptySample);
+			}
+			else
+			{
+				ApplyToEnemy(FieldPawn, EmptySample);
+			}
+		}
+	}
+
+	bHasPawnsInField = false;
+}
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PWGravityFieldSubsystem.generated.h"
+
+class ACharacter;
+struct FPWGravityZoneInfo;
+
+//Shape of the field around each rocket
+USTRUCT(BlueprintType)
+struct FPWGravityFieldSettings
+{
+	GENERATED_BODY()
+
+	//Radius of influence of a rocket, relative to the radius of its collision sphere.
+	//The other shapes get the same margin around their surface, relative to their inner radius
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float FieldRadiusScale = 1.25f;
+
+	//Part of the radius of influence where the rocket has its full strength
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float FullStrengthRatio = 0.6f;
+
+	//Curve of the falloff between the full strength and the edge of the field, 1 is linear
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float FalloffExponent = 2.0f;
+
+	//A pawn starts floating above this strength and lands below the land threshold
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float FloatThreshold = 0.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float LandThreshold = 0.3f;
+};
+
+//Gravity field resolved at one location, the zone settings are weighted by the strength of each zone
+struct FPWGravityFieldSample
+{
+	//0 is the normal gravity, 1 is fully inside a zone
+	float Strength = 0.0f;
+
+	//Number of zones with a strength above 0
+	int32 NumZones = 0;
+
+	float GravityScale = 1.0f;
+	float ZoneSpeed = 0.0f;
+	float PlayerAirControl = 1.0f;
+	float PlayerZVelocity = 0.0f;
+	float PlayerMovementFriction = 0.0f;
+};
+
+/**
+ * Continuous gravity field mode, enabled with pw.GravityZone.FieldMode.
+ * Each rocket has a strength that falls off with the distance, and overlapping rockets combine.
+ * The field is sampled for every pawn each frame in a parallel batch and applied as one resolved gravity and speed,
+ * the enter and exit overlaps of the rockets are ignored while the mode is on.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWGravityFieldSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static bool IsFieldModeEnabled();
+
+	//Sample the field of the zones at a location for a pawn of this class
+	static FPWGravityFieldSample SampleField(TConstArrayView<FPWGravityZoneInfo> Zones, const FVector& Location, const UClass* PawnClass, bool bIsPlayer, const FPWGravityFieldSettings& Settings);
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	int32 GetNumFieldPawns() const { return FieldPawns.Num(); }
+
+	//Forget which pawns the field made float, when their state was reset by something else
+	void ResetPawnStates();
+
+	UPROPERTY(Config)
+	FPWGravityFieldSettings FieldSettings;
+
+	//Below this number of pawns the field is sampled on the game thread only
+	UPROPERTY(Config)
+	int32 MinPawnsForParallelBatch = 32;
+
+private:
+	struct FFieldPawn
+	{
+		TWeakObjectPtr<ACharacter> Character;
+		bool bIsPlayer = false;
+
+		//Floating because of the field
+		bool bFloating = false;
+
+		//Had a strength above 0 on the last frame
+		bool bInField = false;
+	};
+
+	void OnActorSpawned(AActor* SpawnedActor);
+	void RegisterPawn(AActor* Actor);
+
+	void ApplyToEnemy(FFieldPawn& FieldPawn, const FPWGravityFieldSample& Sample) const;
+	void ApplyToPlayer(FFieldPawn& FieldPawn, const FPWGravityFieldSample& Sample) const;
+
+	//Give back the normal gravity to every pawn floated by the field, when the mode is turned off
+	void ReleaseAllPawns();
+
+	TArray<FFieldPawn> FieldPawns;
+
+	//Reused every frame by the parallel batch
+	TArray<FVector> PawnLocations;
+	TArray<const UClass*> PawnClasses;
+	TArray<FPWGravityFieldSample> PawnSamples;
+
+	bool bHasPawnsInField = false;
+
+	FDelegateHandle ActorSpawnedHandle;
+};
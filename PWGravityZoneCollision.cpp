@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Creator/Items/CreationItems/PWGravityZoneCollision.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/CollisionProfile.h"
+
+void PWGravityZoneCollision::ApplyGravityZoneCollision(UPrimitiveComponent* ZoneComponent)
+{
+	if(ZoneComponent == nullptr)
+	{
+		return;
+	}
+
+	ZoneComponent->SetGenerateOverlapEvents(true);
+
+	//Use the profile from the config when it exists
+	FCollisionResponseTemplate ProfileTemplate;
+	if(UCollisionProfile::Get()->GetProfileTemplate(GravityZoneProfile, ProfileTemplate))
+	{
+		ZoneComponent->SetCollisionProfileName(GravityZoneProfile);
+		return;
+	}
+
+	//Else set the same responses by hand: only the pawns can produce an overlap pair with the zone,
+	//so the pickups, props and creation items never reach the overlap handlers of the rocket
+	ZoneComponent->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	ZoneComponent->SetCollisionObjectType(GravityZoneChannel);
+	ZoneComponent->SetCollisionResponseToAllChannels(ECR_Ignore);
+	ZoneComponent->SetCollisionResponseToChannel(ECC_Pawn, ECR_Overlap);
+}
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+
+/**
+ * Collision setup shared by every rocket gravity zone.
+ *
+ * The object channel is declared in DefaultEngine.ini with a default response of Overlap, so the pawn capsules
+ * (which keep their default response) overlap it, while the zone itself only answers to the Pawn channel:
+ *	+DefaultChannelResponses=(Channel=ECC_GameTraceChannel2,DefaultResponse=ECR_Overlap,bTraceType=False,bStaticObject=False,Name="GravityZone")
+ *	+Profiles=(Name="GravityZone",CollisionEnabled=QueryOnly,bCanModify=False,ObjectTypeName="GravityZone",CustomResponses=((Channel="WorldStatic",Response=ECR_Ignore),(Channel="WorldDynamic",Response=ECR_Ignore),(Channel="Pawn",Response=ECR_Overlap),(Channel="Visibility",Response=ECR_Ignore),(Channel="Camera",Response=ECR_Ignore),(Channel="PhysicsBody",Response=ECR_Ignore),(Channel="Vehicle",Response=ECR_Ignore),(Channel="Destructible",Response=ECR_Ignore)))
+ */
+namespace PWGravityZoneCollision
+{
+	//Object channel used by the gravity zone components
+	constexpr ECollisionChannel GravityZoneChannel = ECC_GameTraceChannel2;
+
+	//Collision profile of the gravity zone components
+	inline const FName GravityZoneProfile = FName(TEXT("GravityZone"));
+
+	//Apply the gravity zone profile to a zone component, or the same responses by hand if the profile is missing from the config
+	PROJECTWATER_API void ApplyGravityZoneCollision(UPrimitiveComponent* ZoneComponent);
+}
@@ -0,0 +1,323 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Creator/Items/CreationItems/PWGravityZoneReplication.h"
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+#include "Core/PWGameplayStats.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Net/UnrealNetwork.h"
+
+static TAutoConsoleVariable<int32> CVarLogGravityZoneBandwidth(
+	TEXT("pw.GravityZone.LogReplicationBandwidth"),
+	0,
+	TEXT("1 to log every second the bytes sent or received by the gravity zone replication."),
+	ECVF_Default);
+
+//Measure the size of the delta written by the server or read by the client
+template<typename ItemType, typename ArrayType>
+static bool SerializeAndMeasure(TArray<ItemType>& Items, FNetDeltaSerializeInfo& DeltaParms, ArrayType& ArraySerializer)
+{
+	const int64 WriterBitsBefore = DeltaParms.Writer != nullptr ? DeltaParms.Writer->GetNumBits() : 0;
+	const int64 ReaderBitsBefore = DeltaParms.Reader != nullptr ? DeltaParms.Reader->GetPosBits() : 0;
+
+	const bool bResult = FFastArraySerializer::FastArrayDeltaSerialize<ItemType, ArrayType>(Items, DeltaParms, ArraySerializer);
+
+	if(ArraySerializer.Owner != nullptr)
+	{
+		if(DeltaParms.Writer != nullptr)
+		{
+			ArraySerializer.Owner->AddReplicatedBits(DeltaParms.Writer->GetNumBits() - WriterBitsBefore);
+		}
+		else if(DeltaParms.Reader != nullptr)
+		{
+			ArraySerializer.Owner->AddReplicatedBits(DeltaParms.Reader->GetPosBits() - ReaderBitsBefore);
+		}
+	}
+
+	return bResult;
+}
+
+bool FPWGravityZoneNetArray::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	return SerializeAndMeasure(Items, DeltaParms, *this);
+}
+
+bool FPWPawnGravityStateArray::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	return SerializeAndMeasure(Items, DeltaParms, *this);
+}
+
+void FPWPawnGravityStateItem::PostReplicatedAdd(const FPWPawnGravityStateArray& InArraySerializer)
+{
+	if(InArraySerializer.Owner != nullptr)
+	{
+		InArraySerializer.Owner->HandlePawnGravityStateReplicated(*this);
+	}
+}
+
+void FPWPawnGravityStateItem::PostReplicatedChange(const FPWPawnGravityStateArray& InArraySerializer)
+{
+	if(InArraySerializer.Owner != nullptr)
+	{
+		InArraySerializer.Owner->HandlePawnGravityStateReplicated(*this);
+	}
+}
+
+void FPWPawnGravityStateItem::PreReplicatedRemove(const FPWPawnGravityStateArray& InArraySerializer)
+{
+	//The server removes the item instead of sending the ground state, the clients apply it themselves
+	if(InArraySerializer.Owner != nullptr)
+	{
+		FPWPawnGravityStateItem GroundedState;
+		GroundedState.Pawn = Pawn;
+		InArraySerializer.Owner->HandlePawnGravityStateReplicated(GroundedState);
+	}
+}
+
+APWGravityZoneReplicator::APWGravityZoneReplicator()
+{
+	bReplicates = true;
+	bAlwaysRelevant = true;
+
+	//Only used to report the bandwidth
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickInterval = 1.0f;
+}
+
+void APWGravityZoneReplicator::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(APWGravityZoneReplicator, ZoneStates);
+	DOREPLIFETIME(APWGravityZoneReplicator, PawnStates);
+}
+
+void APWGravityZoneReplicator::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	//Before the first replicated properties are received on the clients
+	ZoneStates.Owner = this;
+	PawnStates.Owner = this;
+}
+
+void APWGravityZoneReplicator::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>();
+	if(GravityZoneSubsystem == nullptr)
+	{
+		return;
+	}
+
+	GravityZoneSubsystem->SetReplicator(this);
+
+	if(HasAuthority())
+	{
+		for(const FPWGravityZoneInfo& Zone : GravityZoneSubsystem->GetActiveZones())
+		{
+			HandleZoneAdded(Zone);
+		}
+
+		ZoneAddedHandle = GravityZoneSubsystem->OnZoneAdded.AddUObject(this, &APWGravityZoneReplicator::HandleZoneAdded);
+		ZoneRemovedHandle = GravityZoneSubsystem->OnZoneRemoved.AddUObject(this, &APWGravityZoneReplicator::HandleZoneRemoved);
+		ZoneRefreshedHandle = GravityZoneSubsystem->OnZoneRefreshed.AddUObject(this, &APWGravityZoneReplicator::HandleZoneRefreshed);
+	}
+}
+
+void APWGravityZoneReplicator::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		GravityZoneSubsystem->OnZoneAdded.Remove(ZoneAddedHandle);
+		GravityZoneSubsystem->OnZoneRemoved.Remove(ZoneRemovedHandle);
+		GravityZoneSubsystem->OnZoneRefreshed.Remove(ZoneRefreshedHandle);
+
+		if(GravityZoneSubsystem->GetReplicator() == this)
+		{
+			GravityZoneSubsystem->SetReplicator(nullptr);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void APWGravityZoneReplicator::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	PW_SCOPE_GAMEPLAY_TIME(ZoneReplication);
+
+	//Forget the pawns destroyed while they were in a zone
+	if(HasAuthority() && PawnStates.Items.RemoveAllSwap([](const FPWPawnGravityStateItem& Item) { return Item.Pawn == nullptr; }) > 0)
+	{
+		PawnStates.MarkArrayDirty();
+		RebuildPawnItemIndices();
+	}
+
+	BandwidthElapsedTime += DeltaSeconds;
+	if(BandwidthElapsedTime < 1.0f)
+	{
+		return;
+	}
+
+	ReplicatedBytesPerSecond = static_cast<int32>(ReplicatedBitsThisSecond / 8 / BandwidthElapsedTime);
+	ReplicatedBitsThisSecond = 0;
+	BandwidthElapsedTime = 0.0f;
+
+	SET_DWORD_STAT(STAT_PWGravityZoneReplicatedBytes, ReplicatedBytesPerSecond);
+
+	if(CVarLogGravityZoneBandwidth.GetValueOnGameThread() != 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Gravity zone replication %s %d bytes/s (%d zones, %d pawns)"),
+			HasAuthority() ? TEXT("sent") : TEXT("received"), ReplicatedBytesPerSecond, ZoneStates.Items.Num(), PawnStates.Items.Num());
+	}
+}
+
+void APWGravityZoneReplicator::SetPawnGravityState(APawn* Pawn, uint8 OverlappingZoneCount, EPWPawnGravityFlags Flags)
+{
+	if(Pawn == nullptr || HasAuthority() == false)
+	{
+		return;
+	}
+
+	const int32* ItemIndexPtr = PawnItemIndices.Find(Pawn);
+	const int32 ItemIndex = ItemIndexPtr != nullptr ? *ItemIndexPtr : INDEX_NONE;
+
+	//A pawn out of every zone doesn't need an item anymore, the clients put it back on the ground when the item is removed
+	if(OverlappingZoneCount == 0 && EnumHasAnyFlags(Flags, EPWPawnGravityFlags::Floating | EPWPawnGravityFlags::MoonJump) == false)
+	{
+		if(ItemIndex != INDEX_NONE)
+		{
+			PawnStates.Items.RemoveAtSwap(ItemIndex);
+			PawnStates.MarkArrayDirty();
+			PawnItemIndices.Remove(Pawn);
+
+			//The last item took the place of the removed one
+			if(PawnStates.Items.IsValidIndex(ItemIndex))
+			{
+				PawnItemIndices.Add(PawnStates.Items[ItemIndex].Pawn.Get(), ItemIndex);
+			}
+		}
+		return;
+	}
+
+	if(ItemIndex == INDEX_NONE)
+	{
+		PawnItemIndices.Add(Pawn, PawnStates.Items.Num());
+		FPWPawnGravityStateItem& NewItem = PawnStates.Items.AddDefaulted_GetRef();
+		NewItem.Pawn = Pawn;
+		NewItem.OverlappingZoneCount = OverlappingZoneCount;
+		NewItem.Flags = static_cast<uint8>(Flags);
+		PawnStates.MarkItemDirty(NewItem);
+		return;
+	}
+
+	//Only the changed items are sent to the clients
+	FPWPawnGravityStateItem& Item = PawnStates.Items[ItemIndex];
+	if(Item.OverlappingZoneCount != OverlappingZoneCount || Item.Flags != static_cast<uint8>(Flags))
+	{
+		Item.OverlappingZoneCount = OverlappingZoneCount;
+		Item.Flags = static_cast<uint8>(Flags);
+		PawnStates.MarkItemDirty(Item);
+	}
+}
+
+const FPWPawnGravityStateItem* APWGravityZoneReplicator::FindPawnGravityState(const APawn* Pawn) const
+{
+	if(HasAuthority())
+	{
+		const int32* ItemIndex = PawnItemIndices.Find(Pawn);
+		return ItemIndex != nullptr ? &PawnStates.Items[*ItemIndex] : nullptr;
+	}
+
+	return PawnStates.Items.FindByPredicate([Pawn](const FPWPawnGravityStateItem& Item) { return Item.Pawn == Pawn; });
+}
+
+void APWGravityZoneReplicator::RebuildPawnItemIndices()
+{
+	PawnItemIndices.Reset();
+	for(int32 ItemIndex = 0; ItemIndex < PawnStates.Items.Num(); ItemIndex++)
+	{
+		PawnItemIndices.Add(PawnStates.Items[ItemIndex].Pawn.Get(), ItemIndex);
+	}
+}
+
+void APWGravityZoneReplicator::HandlePawnGravityStateReplicated(const FPWPawnGravityStateItem& State)
+{
+	//The local player predicts his own floating with the overlaps, only the simulated pawns are corrected
+	ACharacter* Character = Cast<ACharacter>(State.Pawn);
+	if(Character != nullptr && Character->IsLocallyControlled() == false)
+	{
+		UCharacterMovementComponent* MovementComponent = Character->GetCharacterMovement();
+		const bool bIsFloating = State.HasFlag(EPWPawnGravityFlags::Floating);
+		if(MovementComponent != nullptr && MovementComponent->IsFlying() != bIsFloating)
+		{
+			MovementComponent->SetMovementMode(bIsFloating ? EMovementMode::MOVE_Flying : EMovementMode::MOVE_Walking);
+		}
+	}
+
+	OnPawnGravityStateReplicated.Broadcast(State);
+}
+
+FPWGravityZoneShape FPWGravityZoneNetItem::GetShape() const
+{
+	FPWGravityZoneShape Shape;
+	Shape.Type = ShapeType;
+	Shape.Center = Center;
+	Shape.Rotation = Rotation.Quaternion();
+	Shape.Radius = Radius;
+	Shape.HalfHeight = HalfHeight;
+	Shape.BoxExtent = BoxExtent;
+	return Shape;
+}
+
+bool APWGravityZoneReplicator::FillZoneItem(const FPWGravityZoneInfo& Zone, FPWGravityZoneNetItem& Item)
+{
+	const FPWGravityZoneShape& Shape = Zone.Shape;
+	const FRotator Rotation = Shape.Rotation.Rotator();
+	const bool bChanged = Item.ZoneId != Zone.ZoneId || Item.ShapeType != Shape.Type || FVector(Item.Center) != Shape.Center || Item.Rotation != Rotation
+		|| Item.Radius != Shape.Radius || Item.HalfHeight != Shape.HalfHeight || FVector(Item.BoxExtent) != Shape.BoxExtent
+		|| Item.EnemyGravityScale != Zone.EnemyGravityScale || Item.bAffectsEnemies != Zone.bAffectsEnemies || Item.bAffectsPlayer != Zone.bAffectsPlayer;
+
+	Item.ZoneId = Zone.ZoneId;
+	Item.ShapeType = Shape.Type;
+	Item.Center = Shape.Center;
+	Item.Rotation = Rotation;
+	Item.Radius = Shape.Radius;
+	Item.HalfHeight = Shape.HalfHeight;
+	Item.BoxExtent = Shape.BoxExtent;
+	Item.EnemyGravityScale = Zone.EnemyGravityScale;
+	Item.bAffectsEnemies = Zone.bAffectsEnemies;
+	Item.bAffectsPlayer = Zone.bAffectsPlayer;
+	return bChanged;
+}
+
+void APWGravityZoneReplicator::HandleZoneAdded(const FPWGravityZoneInfo& Zone)
+{
+	FPWGravityZoneNetItem& NewItem = ZoneStates.Items.AddDefaulted_GetRef();
+	FillZoneItem(Zone, NewItem);
+	ZoneStates.MarkItemDirty(NewItem);
+}
+
+void APWGravityZoneReplicator::HandleZoneRefreshed(const FPWGravityZoneInfo& Zone)
+{
+	//Only the changed zone is sent again
+	FPWGravityZoneNetItem* Item = ZoneStates.Items.FindByPredicate([&Zone](const FPWGravityZoneNetItem& Candidate) { return Candidate.ZoneId == Zone.ZoneId; });
+	if(Item != nullptr && FillZoneItem(Zone, *Item))
+	{
+		ZoneStates.MarkItemDirty(*Item);
+	}
+}
+
+void APWGravityZoneReplicator::HandleZoneRemoved(const FPWGravityZoneInfo& Zone)
+{
+	const int32 ItemIndex = ZoneStates.Items.IndexOfByPredicate([&Zone](const FPWGravityZoneNetItem& Item) { return Item.ZoneId == Zone.ZoneId; });
+	if(ItemIndex != INDEX_NONE)
+	{
+		ZoneStates.Items.RemoveAtSwap(ItemIndex);
+		ZoneStates.MarkArrayDirty();
+	}
+}
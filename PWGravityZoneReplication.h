@@ -0,0 +1,201 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Creator/Items/CreationItems/PWGravityZoneShape.h"
+#include "GameFramework/Info.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "UObject/ObjectKey.h"
+#include "PWGravityZoneReplication.generated.h"
+
+class APWGravityZoneReplicator;
+struct FPWGravityZoneInfo;
+
+//Gravity state of a pawn, packed in a single byte of the replicated items
+enum class EPWPawnGravityFlags : uint8
+{
+	None = 0,
+	Floating = 1 << 0,
+	Player = 1 << 1,
+	AlreadyInsideOnCraft = 1 << 2,
+	MoonJump = 1 << 3
+};
+ENUM_CLASS_FLAGS(EPWPawnGravityFlags);
+
+//Replicated copy of an active gravity zone, enough for the clients to predict the floating locally
+USTRUCT()
+struct FPWGravityZoneNetItem : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 ZoneId = INDEX_NONE;
+
+	//Volume of the zone, see FPWGravityZoneShape
+	UPROPERTY()
+	EPWGravityZoneShapeType ShapeType = EPWGravityZoneShapeType::Sphere;
+
+	UPROPERTY()
+	FVector_NetQuantize10 Center = FVector::ZeroVector;
+
+	UPROPERTY()
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	UPROPERTY()
+	float Radius = 0.0f;
+
+	UPROPERTY()
+	float HalfHeight = 0.0f;
+
+	UPROPERTY()
+	FVector_NetQuantize10 BoxExtent = FVector::ZeroVector;
+
+	UPROPERTY()
+	float EnemyGravityScale = 0.0f;
+
+	UPROPERTY()
+	bool bAffectsEnemies = true;
+
+	UPROPERTY()
+	bool bAffectsPlayer = true;
+
+	//Volume of the zone rebuilt from the replicated values
+	FPWGravityZoneShape GetShape() const;
+};
+
+USTRUCT()
+struct FPWGravityZoneNetArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FPWGravityZoneNetItem> Items;
+
+	//Set by the replicator, receives the size of each delta
+	APWGravityZoneReplicator* Owner = nullptr;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+};
+
+template<>
+struct TStructOpsTypeTraits<FPWGravityZoneNetArray> : public TStructOpsTypeTraitsBase2<FPWGravityZoneNetArray>
+{
+	enum { WithNetDeltaSerializer = true };
+};
+
+//Replicated zone membership and float state of a pawn, only the pawns affected by at least one zone have an item
+USTRUCT()
+struct FPWPawnGravityStateItem : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<APawn> Pawn = nullptr;
+
+	//Number of gravity zones the pawn is overlapping
+	UPROPERTY()
+	uint8 OverlappingZoneCount = 0;
+
+	//EPWPawnGravityFlags
+	UPROPERTY()
+	uint8 Flags = 0;
+
+	bool HasFlag(EPWPawnGravityFlags Flag) const { return EnumHasAnyFlags(static_cast<EPWPawnGravityFlags>(Flags), Flag); }
+
+	void PostReplicatedAdd(const struct FPWPawnGravityStateArray& InArraySerializer);
+	void PostReplicatedChange(const struct FPWPawnGravityStateArray& InArraySerializer);
+
+	//The pawn left every zone and lost the moon jump, it is corrected back to the ground state
+	void PreReplicatedRemove(const struct FPWPawnGravityStateArray& InArraySerializer);
+};
+
+USTRUCT()
+struct FPWPawnGravityStateArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FPWPawnGravityStateItem> Items;
+
+	//Set by the replicator, receives the size of each delta
+	APWGravityZoneReplicator* Owner = nullptr;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+};
+
+template<>
+struct TStructOpsTypeTraits<FPWPawnGravityStateArray> : public TStructOpsTypeTraitsBase2<FPWPawnGravityStateArray>
+{
+	enum { WithNetDeltaSerializer = true };
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnPawnGravityStateReplicated, const FPWPawnGravityStateItem& /*State*/);
+
+/**
+ * Replicates the gravity zones and the gravity state of the pawns from the server, spawned by UPWGravityZoneSubsystem.
+ * The overlaps still run on the clients to predict the floating, the replicated state corrects the simulated pawns.
+ * Only the changed items are sent, the replicated bytes per second are shown in "stat PWGameplay".
+ */
+UCLASS(NotPlaceable, Transient)
+class PROJECTWATER_API APWGravityZoneReplicator : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	APWGravityZoneReplicator();
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PostInitializeComponents() override;
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+
+	//Server only, update the replicated state of a pawn. The item is removed once the pawn is out of every zone and lost the moon jump
+	void SetPawnGravityState(APawn* Pawn, uint8 OverlappingZoneCount, EPWPawnGravityFlags Flags);
+
+	const TArray<FPWGravityZoneNetItem>& GetReplicatedZones() const { return ZoneStates.Items; }
+
+	//Replicated state of a pawn, nullptr if the pawn is not in a gravity zone
+	const FPWPawnGravityStateItem* FindPawnGravityState(const APawn* Pawn) const;
+
+	//Bytes sent (server) or received (client) by the two arrays during the last second, see pw.GravityZone.LogReplicationBandwidth
+	int32 GetReplicatedBytesPerSecond() const { return ReplicatedBytesPerSecond; }
+
+	//Called by the arrays after each delta serialization
+	void AddReplicatedBits(int64 NumBits) { ReplicatedBitsThisSecond += NumBits; }
+
+	//Called on the clients when the state of a pawn is received
+	void HandlePawnGravityStateReplicated(const FPWPawnGravityStateItem& State);
+
+	//Broadcasted on the clients when the state of a pawn is received
+	FOnPawnGravityStateReplicated OnPawnGravityStateReplicated;
+
+private:
+	void HandleZoneAdded(const FPWGravityZoneInfo& Zone);
+	void HandleZoneRemoved(const FPWGravityZoneInfo& Zone);
+	void HandleZoneRefreshed(const FPWGravityZoneInfo& Zone);
+
+	//Copy the replicated settings of the zone, return true if one of them changed
+	static bool FillZoneItem(const FPWGravityZoneInfo& Zone, FPWGravityZoneNetItem& Item);
+
+	//Server only, rebuilt after the items are removed with a swap
+	void RebuildPawnItemIndices();
+
+	UPROPERTY(Replicated)
+	FPWGravityZoneNetArray ZoneStates;
+
+	UPROPERTY(Replicated)
+	FPWPawnGravityStateArray PawnStates;
+
+	//Index of the item of each pawn in PawnStates, only on the server
+	TMap<TObjectKey<APawn>, int32> PawnItemIndices;
+
+	int64 ReplicatedBitsThisSecond = 0;
+	float BandwidthElapsedTime = 0.0f;
+	int32 ReplicatedBytesPerSecond = 0;
+
+	FDelegateHandle ZoneAddedHandle;
+	FDelegateHandle ZoneRemovedHandle;
+	FDelegateHandle ZoneRefreshedHandle;
+};
@@ -0,0 +1,275 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Creator/Items/CreationItems/PWGravityZoneShape.h"
+#include "CollisionShape.h"
+
+namespace PWGravityZoneShape
+{
+	//Shape constants splat in the 4 lanes once for the whole batch
+	struct FBatchConstants
+	{
+		VectorRegister4Double CenterX, CenterY, CenterZ;
+		VectorRegister4Float AxisXX, AxisXY, AxisXZ;
+		VectorRegister4Float AxisYX, AxisYY, AxisYZ;
+		VectorRegister4Float AxisZX, AxisZY, AxisZZ;
+		VectorRegister4Float RadiusSquared;
+		VectorRegister4Float HalfHeight;
+		VectorRegister4Float SegmentHalfLength;
+		VectorRegister4Float NegSegmentHalfLength;
+		VectorRegister4Float ExtentX, ExtentY, ExtentZ;
+	};
+
+	FORCEINLINE VectorRegister4Float Dot3(VectorRegister4Float X, VectorRegister4Float Y, VectorRegister4Float Z,
+		VectorRegister4Float AxisX, VectorRegister4Float AxisY, VectorRegister4Float AxisZ)
+	{
+		return VectorMultiplyAdd(Z, AxisZ, VectorMultiplyAdd(Y, AxisY, VectorMultiply(X, AxisX)));
+	}
+
+	//Mask of the 4 lanes inside the shape, the deltas are relative to the center of the shape
+	template<EPWGravityZoneShapeType ShapeType>
+	FORCEINLINE VectorRegister4Float TestLanes(const FBatchConstants& Constants, VectorRegister4Float DeltaX, VectorRegister4Float DeltaY, VectorRegister4Float DeltaZ)
+	{
+		if constexpr (ShapeType == EPWGravityZoneShapeType::Sphere)
+		{
+			//No rotation needed
+			return VectorCompareLE(Dot3(DeltaX, DeltaY, DeltaZ, DeltaX, DeltaY, DeltaZ), Constants.RadiusSquared);
+		}
+		else
+		{
+			//Into the local space of the shape
+			const VectorRegister4Float LocalX = Dot3(DeltaX, DeltaY, DeltaZ, Constants.AxisXX, Constants.AxisXY, Constants.AxisXZ);
+			const VectorRegister4Float LocalY = Dot3(DeltaX, DeltaY, DeltaZ, Constants.AxisYX, Constants.AxisYY, Constants.AxisYZ);
+			const VectorRegister4Float LocalZ = Dot3(DeltaX, DeltaY, DeltaZ, Constants.AxisZX, Constants.AxisZY, Constants.AxisZZ);
+
+			if constexpr (ShapeType == EPWGravityZoneShapeType::Box)
+			{
+				return VectorBitwiseAnd(VectorBitwiseAnd(
+					VectorCompareLE(VectorAbs(LocalX), Constants.ExtentX),
+					VectorCompareLE(VectorAbs(LocalY), Constants.ExtentY)),
+					VectorCompareLE(VectorAbs(LocalZ), Constants.ExtentZ));
+			}
+			else if constexpr (ShapeType == EPWGravityZoneShapeType::Cylinder)
+			{
+				const VectorRegister4Float RadialSquared = VectorMultiplyAdd(LocalY, LocalY, VectorMultiply(LocalX, LocalX));
+				return VectorBitwiseAnd(VectorCompareLE(RadialSquared, Constants.RadiusSquared), VectorCompareLE(VectorAbs(LocalZ), Constants.HalfHeight));
+			}
+			else
+			{
+				//Distance to the inner segment of the capsule
+				const VectorRegister4Float ClampedZ = VectorMin(VectorMax(LocalZ, Constants.NegSegmentHalfLength), Constants.SegmentHalfLength);
+				const VectorRegister4Float SegmentDeltaZ = VectorSubtract(LocalZ, ClampedZ);
+				return VectorCompareLE(Dot3(LocalX, LocalY, SegmentDeltaZ, LocalX, LocalY, SegmentDeltaZ), Constants.RadiusSquared);
+			}
+		}
+	}
+
+	template<EPWGravityZoneShapeType ShapeType>
+	int32 ContainsBatch(const FBatchConstants& Constants, const FPWPackedPositions& Positions, TBitArray<>& OutInside)
+	{
+		const int32 NumPositions = Positions.Num();
+		int32 NumInside = 0;
+
+		for(int32 Index = 0; Index < NumPositions; Index += 4)
+		{
+			//Relative to the center in double first, the deltas are small enough for the float lanes
+			const VectorRegister4Float DeltaX = MakeVectorRegisterFloatFromDouble(VectorSubtract(VectorLoadAligned(&Positions.X[Index]), Constants.CenterX));
+			const VectorRegister4Float DeltaY = MakeVectorRegisterFloatFromDouble(VectorSubtract(VectorLoadAligned(&Positions.Y[Index]), Constants.CenterY));
+			const VectorRegister4Float DeltaZ = MakeVectorRegisterFloatFromDouble(VectorSubtract(VectorLoadAligned(&Positions.Z[Index]), Constants.CenterZ));
+
+			const int32 LaneBits = VectorMaskBits(TestLanes<ShapeType>(Constants, DeltaX, DeltaY, DeltaZ));
+			if(LaneBits == 0)
+			{
+				continue;
+			}
+
+			//The padding lanes after the last position are ignored
+			const int32 NumLanes = FMath::Min(4, NumPositions - Index);
+			for(int32 Lane = 0; Lane < NumLanes; Lane++)
+			{
+				if(LaneBits & (1 << Lane))
+				{
+					OutInside[Index + Lane] = true;
+					++NumInside;
+				}
+			}
+		}
+
+		return NumInside;
+	}
+}
+
+void FPWPackedPositions::Reset()
+{
+	X.Reset();
+	Y.Reset();
+	Z.Reset();
+	NumPositions = 0;
+}
+
+void FPWPackedPositions::Add(const FVector& Position)
+{
+	//Grow by a full group of 4 lanes
+	if(NumPositions % 4 == 0)
+	{
+		X.AddZeroed(4);
+		Y.AddZeroed(4);
+		Z.AddZeroed(4);
+	}
+
+	X[NumPositions] = Position.X;
+	Y[NumPositions] = Position.Y;
+	Z[NumPositions] = Position.Z;
+	++NumPositions;
+}
+
+bool FPWGravityZoneShape::Contains(const FVector& Location) const
+{
+	const FVector Delta = Location - Center;
+	if(Type == EPWGravityZoneShapeType::Sphere)
+	{
+		return Delta.SizeSquared() <= FMath::Square(Radius);
+	}
+
+	const FVector Local = Rotation.UnrotateVector(Delta);
+	switch (Type)
+	{
+		case EPWGravityZoneShapeType::Box:
+			return FMath::Abs(Local.X) <= BoxExtent.X && FMath::Abs(Local.Y) <= BoxExtent.Y && FMath::Abs(Local.Z) <= BoxExtent.Z;
+		case EPWGravityZoneShapeType::Cylinder:
+			return Local.SizeSquared2D() <= FMath::Square(Radius) && FMath::Abs(Local.Z) <= HalfHeight;
+		case EPWGravityZoneShapeType::Capsule:
+		{
+			const double SegmentHalfLength = FMath::Max(HalfHeight - Radius, 0.0f);
+			const double SegmentDeltaZ = Local.Z - FMath::Clamp(Local.Z, -SegmentHalfLength, SegmentHalfLength);
+			return Local.SizeSquared2D() + FMath::Square(SegmentDeltaZ) <= FMath::Square(Radius);
+		}
+		default:
+			return false;
+	}
+}
+
+float FPWGravityZoneShape::GetBoundingRadius() const
+{
+	switch (Type)
+	{
+		case EPWGravityZoneShapeType::Capsule:
+			return FMath::Max(HalfHeight, Radius);
+		case EPWGravityZoneShapeType::Box:
+			return static_cast<float>(BoxExtent.Size());
+		case EPWGravityZoneShapeType::Cylinder:
+			return FMath::Sqrt(FMath::Square(Radius) + FMath::Square(HalfHeight));
+		default:
+			return Radius;
+	}
+}
+
+float FPWGravityZoneShape::GetSignedDistance(const FVector& Location) const
+{
+	const FVector Delta = Location - Center;
+	if(Type == EPWGravityZoneShapeType::Sphere)
+	{
+		return static_cast<float>(Delta.Size()) - Radius;
+	}
+
+	const FVector Local = Rotation.UnrotateVector(Delta);
+	switch (Type)
+	{
+		case EPWGravityZoneShapeType::Box:
+		{
+			const FVector Outside = Local.GetAbs() - BoxExtent;
+			return static_cast<float>(Outside.ComponentMax(FVector::ZeroVector).Size() + FMath::Min(Outside.GetMax(), 0.0));
+		}
+		case EPWGravityZoneShapeType::Cylinder:
+		{
+			const double RadialOutside = Local.Size2D() - Radius;
+			const double HeightOutside = FMath::Abs(Local.Z) - HalfHeight;
+			const double OutsideDistance = FMath::Sqrt(FMath::Square(FMath::Max(RadialOutside, 0.0)) + FMath::Square(FMath::Max(HeightOutside, 0.0)));
+			return static_cast<float>(OutsideDistance + FMath::Min(FMath::Max(RadialOutside, HeightOutside), 0.0));
+		}
+		case EPWGravityZoneShapeType::Capsule:
+		{
+			const double SegmentHalfLength = FMath::Max(HalfHeight - Radius, 0.0f);
+			const FVector SegmentDelta(Local.X, Local.Y, Local.Z - FMath::Clamp(Local.Z, -SegmentHalfLength, SegmentHalfLength));
+			return static_cast<float>(SegmentDelta.Size()) - Radius;
+		}
+		default:
+			return 0.0f;
+	}
+}
+
+float FPWGravityZoneShape::GetInnerRadius() const
+{
+	switch (Type)
+	{
+		case EPWGravityZoneShapeType::Box:
+			return static_cast<float>(BoxExtent.GetMin());
+		case EPWGravityZoneShapeType::Cylinder:
+			return FMath::Min(Radius, HalfHeight);
+		default:
+			return Radius;
+	}
+}
+
+int32 FPWGravityZoneShape::ContainsBatch(const FPWPackedPositions& Positions, TBitArray<>& OutInside) const
+{
+	OutInside.Init(false, Positions.Num());
+	if(Positions.Num() == 0)
+	{
+		return 0;
+	}
+
+	const FVector3f AxisX = FVector3f(Rotation.GetAxisX());
+	const FVector3f AxisY = FVector3f(Rotation.GetAxisY());
+	const FVector3f AxisZ = FVector3f(Rotation.GetAxisZ());
+	const float SegmentHalfLength = FMath::Max(HalfHeight - Radius, 0.0f);
+
+	PWGravityZoneShape::FBatchConstants Constants;
+	Constants.CenterX = VectorSetDouble1(Center.X);
+	Constants.CenterY = VectorSetDouble1(Center.Y);
+	Constants.CenterZ = VectorSetDouble1(Center.Z);
+	Constants.AxisXX = VectorSetFloat1(AxisX.X);
+	Constants.AxisXY = VectorSetFloat1(AxisX.Y);
+	Constants.AxisXZ = VectorSetFloat1(AxisX.Z);
+	Constants.AxisYX = VectorSetFloat1(AxisY.X);
+	Constants.AxisYY = VectorSetFloat1(AxisY.Y);
+	Constants.AxisYZ = VectorSetFloat1(AxisY.Z);
+	Constants.AxisZX = VectorSetFloat1(AxisZ.X);
+	Constants.AxisZY = VectorSetFloat1(AxisZ.Y);
+	Constants.AxisZZ = VectorSetFloat1(AxisZ.Z);
+	Constants.RadiusSquared = VectorSetFloat1(FMath::Square(Radius));
+	Constants.HalfHeight = VectorSetFloat1(HalfHeight);
+	Constants.SegmentHalfLength = VectorSetFloat1(SegmentHalfLength);
+	Constants.NegSegmentHalfLength = VectorSetFloat1(-SegmentHalfLength);
+	Constants.ExtentX = VectorSetFloat1(static_cast<float>(BoxExtent.X));
+	Constants.ExtentY = VectorSetFloat1(static_cast<float>(BoxExtent.Y));
+	Constants.ExtentZ = VectorSetFloat1(static_cast<float>(BoxExtent.Z));
+
+	//One loop per shape, so the shape isn't tested for every group of positions
+	switch (Type)
+	{
+		case EPWGravityZoneShapeType::Capsule:
+			return PWGravityZoneShape::ContainsBatch<EPWGravityZoneShapeType::Capsule>(Constants, Positions, OutInside);
+		case EPWGravityZoneShapeType::Box:
+			return PWGravityZoneShape::ContainsBatch<EPWGravityZoneShapeType::Box>(Constants, Positions, OutInside);
+		case EPWGravityZoneShapeType::Cylinder:
+			return PWGravityZoneShape::ContainsBatch<EPWGravityZoneShapeType::Cylinder>(Constants, Positions, OutInside);
+		default:
+			return PWGravityZoneShape::ContainsBatch<EPWGravityZoneShapeType::Sphere>(Constants, Positions, OutInside);
+	}
+}
+
+FCollisionShape FPWGravityZoneShape::ToCollisionShape() const
+{
+	switch (Type)
+	{
+		case EPWGravityZoneShapeType::Capsule:
+			return FCollisionShape::MakeCapsule(Radius, HalfHeight);
+		case EPWGravityZoneShapeType::Box:
+			return FCollisionShape::MakeBox(BoxExtent);
+		case EPWGravityZoneShapeType::Cylinder:
+			return FCollisionShape::MakeBox(FVector(Radius, Radius, HalfHeight));
+		default:
+			return FCollisionShape::MakeSphere(Radius);
+	}
+}
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PWGravityZoneShape.generated.h"
+
+struct FCollisionShape;
+
+//Volume of a rocket gravity zone. The capsule and the cylinder are along the up axis of the rocket
+UENUM(BlueprintType)
+enum class EPWGravityZoneShapeType : uint8
+{
+	Sphere,
+	Capsule,
+	Box,
+	Cylinder
+};
+
+//Positions of many pawns packed by axis, so 4 pawns are tested at once against a zone.
+//Kept in double, each zone subtracts its center before the lanes go to float so the test keeps its precision far from the origin
+struct PROJECTWATER_API FPWPackedPositions
+{
+	//Remove every position, the memory is kept for the next frame
+	void Reset();
+
+	void Add(const FVector& Position);
+
+	int32 Num() const { return NumPositions; }
+
+	//Padded to a multiple of 4 with zeros, the padding lanes are never reported as inside
+	TArray<double, TAlignedHeapAllocator<32>> X;
+	TArray<double, TAlignedHeapAllocator<32>> Y;
+	TArray<double, TAlignedHeapAllocator<32>> Z;
+
+private:
+	int32 NumPositions = 0;
+};
+
+//World space volume of a gravity zone
+USTRUCT()
+struct PROJECTWATER_API FPWGravityZoneShape
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	EPWGravityZoneShapeType Type = EPWGravityZoneShapeType::Sphere;
+
+	UPROPERTY()
+	FVector Center = FVector::ZeroVector;
+
+	UPROPERTY()
+	FQuat Rotation = FQuat::Identity;
+
+	//Radius of the sphere, capsule and cylinder
+	UPROPERTY()
+	float Radius = 0.0f;
+
+	//Half height of the capsule (with its caps) and of the cylinder
+	UPROPERTY()
+	float HalfHeight = 0.0f;
+
+	//Half size of the box
+	UPROPERTY()
+	FVector BoxExtent = FVector::ZeroVector;
+
+	//Return true if the location is inside the volume
+	bool Contains(const FVector& Location) const;
+
+	//Radius of the smallest sphere around the center that contains the whole volume
+	float GetBoundingRadius() const;
+
+	//Distance from the location to the surface of the volume, negative inside
+	float GetSignedDistance(const FVector& Location) const;
+
+	//Distance from the center to the closest point of the surface, the radius of a sphere zone
+	float GetInnerRadius() const;
+
+	//Test every packed position against the volume with SIMD, 4 positions at a time.
+	//OutInside has one bit per position. Return the number of positions inside
+	int32 ContainsBatch(const FPWPackedPositions& Positions, TBitArray<>& OutInside) const;
+
+	//Same shape for the physics overlaps, the cylinder is approximated by its box
+	FCollisionShape ToCollisionShape() const;
+};
@@ -0,0 +1,305 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Creator/Items/CreationItems/PWGravityZoneShapeSubsystem.h"
+#include "EngineUtils.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "Characters/Player/PWPlayerCharacter.h"
+#include "Core/PWGameplayStats.h"
+#include "Creator/Items/CreationItems/PW_RocketCreation.h"
+#include "Creator/Items/CreationItems/PWGravityFieldSubsystem.h"
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkZoneShapesCommand(
+	TEXT("pw.GravityZone.BenchmarkShapes"),
+	TEXT("Compare the scalar test, the SIMD batch and the physics overlaps for the active gravity zones. ")
+	TEXT("Optional number of random positions (0 uses the pawns of the world) and number of iterations, 0 and 100 by default."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if(const UPWGravityZoneShapeSubsystem* ShapeSubsystem = World != nullptr ? World->GetSubsystem<UPWGravityZoneShapeSubsystem>() : nullptr)
+		{
+			ShapeSubsystem->BenchmarkContainment(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 0, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 100);
+		}
+	}));
+
+bool UPWGravityZoneShapeSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	//The rockets of the editor and preview worlds never receive enter and leave events
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPWGravityZoneShapeSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Collection.InitializeDependency<UPWGravityZoneSubsystem>();
+	Super::Initialize(Collection);
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UPWGravityZoneShapeSubsystem::OnActorSpawned));
+}
+
+void UPWGravityZoneShapeSubsystem::Deinitialize()
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	Pawns.Empty();
+	ZoneMembers.Empty();
+
+	Super::Deinitialize();
+}
+
+void UPWGravityZoneShapeSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//The pawns placed in the level
+	for(TActorIterator<APawn> It(&InWorld); It; ++It)
+	{
+		RegisterPawn(*It);
+	}
+}
+
+TStatId UPWGravityZoneShapeSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWGravityZoneShapeSubsystem, STATGROUP_Tickables);
+}
+
+void UPWGravityZoneShapeSubsystem::OnActorSpawned(AActor* SpawnedActor)
+{
+	RegisterPawn(SpawnedActor);
+}
+
+void UPWGravityZoneShapeSubsystem::RegisterPawn(AActor* Actor)
+{
+	if(Actor->IsA<APWEnemyCharacter>() || Actor->IsA<APWPlayerCharacter>())
+	{
+		Pawns.AddUnique(CastChecked<APawn>(Actor));
+	}
+}
+
+void UPWGravityZoneShapeSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_PWGravityZoneShapes);
+	PW_SCOPE_GAMEPLAY_TIME(ZoneShapes);
+
+	//Forget the rockets that are gone
+	for(auto It = ZoneMembers.CreateIterator(); It; ++It)
+	{
+		if(It->Key.IsValid() == false)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	//The gravity field replaces the enter and leave events of every zone
+	const UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>();
+	if(GravityZoneSubsystem == nullptr || UPWGravityFieldSubsystem::IsFieldModeEnabled() == true)
+	{
+		return;
+	}
+
+	//Copy the shaped zones, the rockets can refresh their zone from the event handlers
+	TArray<FPWGravityZoneInfo, TInlineAllocator<8>> ShapedZones;
+	for(const FPWGravityZoneInfo& Zone : GravityZoneSubsystem->GetActiveZones())
+	{
+		if(Zone.Shape.Type != EPWGravityZoneShapeType::Sphere)
+		{
+			ShapedZones.Add(Zone);
+		}
+	}
+
+	if(ShapedZones.IsEmpty())
+	{
+		return;
+	}
+
+	//Pack the positions once for every zone
+	Pawns.RemoveAllSwap([](const TWeakObjectPtr<APawn>& Pawn) { return Pawn.IsValid() == false; });
+	PackedPositions.Reset();
+	for(const TWeakObjectPtr<APawn>& Pawn : Pawns)
+	{
+		PackedPositions.Add(Pawn->GetActorLocation());
+	}
+
+	TArray<APawn*> EnteredPawns;
+	TArray<APawn*> LeftPawns;
+	for(const FPWGravityZoneInfo& Zone : ShapedZones)
+	{
+		APW_RocketCreation* Rocket = Zone.Rocket.Get();
+		if(Rocket == nullptr)
+		{
+			continue;
+		}
+
+		Zone.Shape.ContainsBatch(PackedPositions, InsideBits);
+
+		//The destroyed pawns leave silently, like their overlaps would
+		TSet<TWeakObjectPtr<APawn>>& Members = ZoneMembers.FindOrAdd(Rocket);
+		for(auto It = Members.CreateIterator(); It; ++It)
+		{
+			if(It->IsValid() == false)
+			{
+				It.RemoveCurrent();
+			}
+		}
+
+		EnteredPawns.Reset();
+		LeftPawns.Reset();
+		for(int32 i = 0; i < Pawns.Num(); i++)
+		{
+			APawn* Pawn = Pawns[i].Get();
+			const bool bIsInside = InsideBits[i];
+			if(bIsInside != Members.Contains(Pawn))
+			{
+				(bIsInside ? EnteredPawns : LeftPawns).Add(Pawn);
+			}
+		}
+
+		for(APawn* Pawn : LeftPawns)
+		{
+			Members.Remove(Pawn);
+			Rocket->HandlePawnLeftZone(Pawn);
+		}
+
+		for(APawn* Pawn : EnteredPawns)
+		{
+			Members.Add(Pawn);
+			Rocket->HandlePawnEnteredZone(Pawn);
+		}
+	}
+}
+
+void UPWGravityZoneShapeSubsystem::GetPawnsInsideZone(const APW_RocketCreation* Rocket, TArray<AActor*>& OutPawns, const UClass* ClassFilter) const
+{
+	const TSet<TWeakObjectPtr<APawn>>* Members = ZoneMembers.Find(Rocket);
+	if(Members == nullptr)
+	{
+		return;
+	}
+
+	for(const TWeakObjectPtr<APawn>& Member : *Members)
+	{
+		if(APawn* Pawn = Member.Get(); Pawn != nullptr && (ClassFilter == nullptr || Pawn->IsA(ClassFilter)))
+		{
+			OutPawns.Add(Pawn);
+		}
+	}
+}
+
+SIZE_T UPWGravityZoneShapeSubsystem::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = Pawns.GetAllocatedSize() + ZoneMembers.GetAllocatedSize() + InsideBits.GetAllocatedSize();
+	AllocatedSize += PackedPositions.X.GetAllocatedSize() + PackedPositions.Y.GetAllocatedSize() + PackedPositions.Z.GetAllocatedSize();
+	for(const TPair<TWeakObjectPtr<APW_RocketCreation>, TSet<TWeakObjectPtr<APawn>>>& Members : ZoneMembers)
+	{
+		AllocatedSize += Members.Value.GetAllocatedSize();
+	}
+	return AllocatedSize;
+}
+
+void UPWGravityZoneShapeSubsystem::SyncZoneMembers(APW_RocketCreation* Rocket)
+{
+	if(Rocket == nullptr || Rocket->UsesShapeContainment() == false)
+	{
+		return;
+	}
+
+	const FPWGravityZoneShape Shape = Rocket->GetZoneShape();
+	TSet<TWeakObjectPtr<APawn>>& Members = ZoneMembers.FindOrAdd(Rocket);
+	Members.Reset();
+	for(const TWeakObjectPtr<APawn>& Pawn : Pawns)
+	{
+		if(Pawn.IsValid() && Shape.Contains(Pawn->GetActorLocation()))
+		{
+			Members.Add(Pawn);
+		}
+	}
+}
+
+void UPWGravityZoneShapeSubsystem::BenchmarkContainment(int32 NumRandomPositions, int32 NumIterations) const
+{
+	const UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>();
+	if(GravityZoneSubsystem == nullptr || GravityZoneSubsystem->GetActiveZones().IsEmpty())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Gravity zone benchmark: no active gravity zone"));
+		return;
+	}
+
+	const TArray<FPWGravityZoneInfo>& Zones = GravityZoneSubsystem->GetActiveZones();
+	NumIterations = FMath::Max(NumIterations, 1);
+
+	//Random positions around the zones, or the pawns of the world
+	TArray<FVector> Locations;
+	if(NumRandomPositions > 0)
+	{
+		FRandomStream RandomStream(NumRandomPositions);
+		for(int32 i = 0; i < NumRandomPositions; i++)
+		{
+			const FPWGravityZoneInfo& Zone = Zones[i % Zones.Num()];
+			Locations.Add(Zone.Center + RandomStream.VRand() * RandomStream.FRandRange(0.0f, Zone.Radius * 1.5f));
+		}
+	}
+	else
+	{
+		for(const TWeakObjectPtr<APawn>& Pawn : Pawns)
+		{
+			if(Pawn.IsValid())
+			{
+				Locations.Add(Pawn->GetActorLocation());
+			}
+		}
+	}
+
+	FPWPackedPositions Positions;
+	for(const FVector& Location : Locations)
+	{
+		Positions.Add(Location);
+	}
+
+	//One point at a time
+	int64 NumScalarInside = 0;
+	double StartTime = FPlatformTime::Seconds();
+	for(int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		for(const FPWGravityZoneInfo& Zone : Zones)
+		{
+			for(const FVector& Location : Locations)
+			{
+				NumScalarInside += Zone.Shape.Contains(Location) ? 1 : 0;
+			}
+		}
+	}
+	const double ScalarMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumIterations;
+
+	//4 points at a time
+	TBitArray<> BatchInsideBits;
+	int64 NumBatchInside = 0;
+	StartTime = FPlatformTime::Seconds();
+	for(int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		for(const FPWGravityZoneInfo& Zone : Zones)
+		{
+			NumBatchInside += Zone.Shape.ContainsBatch(Positions, BatchInsideBits);
+		}
+	}
+	const double BatchMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumIterations;
+
+	//What the overlaps of the rockets cost, one query per zone against the pawn capsules of the world
+	TArray<FOverlapResult> Overlaps;
+	const FCollisionObjectQueryParams ObjectQueryParams(ECC_Pawn);
+	int64 NumOverlaps = 0;
+	StartTime = FPlatformTime::Seconds();
+	for(int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		for(const FPWGravityZoneInfo& Zone : Zones)
+		{
+			GetWorld()->OverlapMultiByObjectType(Overlaps, Zone.Shape.Center, Zone.Shape.Rotation, ObjectQueryParams, Zone.Shape.ToCollisionShape());
+			NumOverlaps += Overlaps.Num();
+		}
+	}
+	const double OverlapMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumIterations;
+
+	UE_LOG(LogTemp, Log, TEXT("Gravity zone benchmark, %d positions in %d zones over %d iterations:"), Locations.Num(), Zones.Num(), NumIterations);
+	UE_LOG(LogTemp, Log, TEXT("  scalar test  %.4f ms (%lld inside)"), ScalarMs, NumScalarInside / NumIterations);
+	UE_LOG(LogTemp, Log, TEXT("  SIMD batch   %.4f ms (%lld inside)"), BatchMs, NumBatchInside / NumIterations);
+	UE_LOG(LogTemp, Log, TEXT("  overlaps     %.4f ms (%lld pawns of the world overlapping)"), OverlapMs, NumOverlaps / NumIterations);
+}
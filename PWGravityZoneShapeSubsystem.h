@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Creator/Items/CreationItems/PWGravityZoneShape.h"
+#include "PWGravityZoneShapeSubsystem.generated.h"
+
+class APW_RocketCreation;
+
+/**
+ * Containment of the pawns in the gravity zones that are not spheres, without the physics overlaps.
+ * Every frame the pawn positions are packed once and tested against each capsule, box and cylinder zone with SIMD,
+ * then the rockets receive the same enter and leave events as their overlaps would give.
+ * The sphere zones keep using the overlaps of their collision sphere.
+ */
+UCLASS()
+class PROJECTWATER_API UPWGravityZoneShapeSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//The pawns of this class inside the zone of the rocket since the last update
+	void GetPawnsInsideZone(const APW_RocketCreation* Rocket, TArray<AActor*>& OutPawns, const UClass* ClassFilter) const;
+
+	//Set the pawns inside the zone of the rocket right away without any enter event, used after a world snapshot restore
+	void SyncZoneMembers(APW_RocketCreation* Rocket);
+
+	//Log the cost of the scalar test, the SIMD batch and the physics overlaps over the active zones,
+	//with the pawns of the world or with random positions around the zones
+	void BenchmarkContainment(int32 NumRandomPositions, int32 NumIterations) const;
+
+	//Bytes allocated by the pawn list, the zone members and the packed positions
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	void OnActorSpawned(AActor* SpawnedActor);
+	void RegisterPawn(AActor* Actor);
+
+	TArray<TWeakObjectPtr<APawn>> Pawns;
+
+	//Pawns inside each shaped zone, kept after the zone is removed until its rocket is destroyed
+	TMap<TWeakObjectPtr<APW_RocketCreation>, TSet<TWeakObjectPtr<APawn>>> ZoneMembers;
+
+	//Reused every frame
+	FPWPackedPositions PackedPositions;
+	TBitArray<> InsideBits;
+
+	FDelegateHandle ActorSpawnedHandle;
+};
@@ -0,0 +1,293 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+#include "Creator/Items/CreationItems/PW_RocketCreation.h"
+#include "Creator/Items/CreationItems/PWGravityZoneReplication.h"
+#include "Characters/Player/PWPlayerCharacter.h"
+#include "Characters/Player/PWPlayerRocketStateComponent.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "Characters/Enemies/PWEnemyGravityStateComponent.h"
+#include "Core/PWGameplayStats.h"
+#include "DrawDebugHelpers.h"
+#include "EngineUtils.h"
+
+static FAutoConsoleCommandWithWorldAndArgs DrawFloatingEnemiesCommand(
+	TEXT("pw.GravityZone.DrawFloaters"),
+	TEXT("Draw the floating enemies and the gravity zones. Optional duration in seconds, 5 by default."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if(const UPWGravityZoneSubsystem* GravityZoneSubsystem = World != nullptr ? World->GetSubsystem<UPWGravityZoneSubsystem>() : nullptr)
+		{
+			GravityZoneSubsystem->DrawFloatingEnemies(Args.Num() > 0 ? FCString::Atof(*Args[0]) : 5.0f);
+		}
+	}));
+
+bool FPWGravityZoneInfo::CanAffectEnemyClass(const UClass* EnemyClass) const
+{
+	return bAffectsEnemies && IsIgnoredClass(EnemyClass) == false;
+}
+
+bool FPWGravityZoneInfo::CanAffectPlayerClass(const UClass* PlayerClass) const
+{
+	return bAffectsPlayer && IsIgnoredClass(PlayerClass) == false;
+}
+
+bool FPWGravityZoneInfo::IsIgnoredClass(const UClass* PawnClass) const
+{
+	for(const UClass* IgnoredClass : IgnoredPawnClasses)
+	{
+		if(IgnoredClass != nullptr && PawnClass != nullptr && PawnClass->IsChildOf(IgnoredClass))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void UPWGravityZoneSubsystem::FillZoneInfo(APW_RocketCreation* Rocket, FPWGravityZoneInfo& OutZone)
+{
+	OutZone.Rocket = Rocket;
+	OutZone.Shape = Rocket->GetZoneShape();
+	OutZone.Center = OutZone.Shape.Center;
+	OutZone.Radius = OutZone.Shape.GetBoundingRadius();
+	OutZone.EnemyGravityZoneSpeed = Rocket->EnemyGravityZoneSpeed;
+	OutZone.EnemyGravityScale = Rocket->EnemyGravityScale;
+	OutZone.bAffectsEnemies = Rocket->bCanEnemiesFloatInRocketZone;
+	OutZone.bAffectsPlayer = Rocket->bCanPlayerFloatInRocketZone;
+	OutZone.PlayerGravityScale = Rocket->GravityScaleForPlayer;
+	OutZone.PlayerAirControl = Rocket->AirControlPlayer;
+	OutZone.PlayerZVelocity = Rocket->ZVelocityFloatingPlayer;
+	OutZone.PlayerMovementFriction = Rocket->RocketMovementFriction;
+	OutZone.bGivesPlayerMoonJump = Rocket->bCanPlayerMoonJump;
+	OutZone.PlayerMoonJumpZVelocity = Rocket->NewPlayerMoonJumpZVelocity;
+	OutZone.PlayerMoonJumpGravityScale = Rocket->NewPlayerMoonJumpGravityScale;
+
+	OutZone.IgnoredPawnClasses.Reset();
+	for(const TSubclassOf<APawn>& IgnoredClass : Rocket->IgnoredPawnClasses)
+	{
+		OutZone.IgnoredPawnClasses.Add(IgnoredClass.Get());
+	}
+}
+
+bool UPWGravityZoneSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	//The pawns of the editor and preview worlds must not get the rocket and gravity state components, they would be saved with the level
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UPWGravityZoneSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UPWGravityZoneSubsystem::OnActorSpawned));
+}
+
+void UPWGravityZoneSubsystem::Deinitialize()
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	PlayerRocketStates.Empty();
+	FloatingEnemies.Empty();
+	FloatingStates.Empty();
+
+	Super::Deinitialize();
+}
+
+void UPWGravityZoneSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//The pawns placed in the level
+	for(TActorIterator<APWPlayerCharacter> It(&InWorld); It; ++It)
+	{
+		AddPlayerRocketState(*It);
+	}
+
+	for(TActorIterator<APWEnemyCharacter> It(&InWorld); It; ++It)
+	{
+		AddEnemyGravityState(*It);
+	}
+
+	//The clients receive the replicator from the server, a standalone game doesn't need it
+	const ENetMode NetMode = InWorld.GetNetMode();
+	if(NetMode == NM_DedicatedServer || NetMode == NM_ListenServer)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		Replicator = InWorld.SpawnActor<APWGravityZoneReplicator>(SpawnParameters);
+	}
+}
+
+void UPWGravityZoneSubsystem::OnActorSpawned(AActor* SpawnedActor)
+{
+	if(APWPlayerCharacter* Player = Cast<APWPlayerCharacter>(SpawnedActor))
+	{
+		AddPlayerRocketState(Player);
+	}
+	else if(APWEnemyCharacter* Enemy = Cast<APWEnemyCharacter>(SpawnedActor))
+	{
+		AddEnemyGravityState(Enemy);
+	}
+}
+
+void UPWGravityZoneSubsystem::AddPlayerRocketState(APWPlayerCharacter* Player)
+{
+	UPWPlayerRocketStateComponent* RocketState = UPWPlayerRocketStateComponent::FindRocketState(Player);
+	if(RocketState == nullptr)
+	{
+		RocketState = NewObject<UPWPlayerRocketStateComponent>(Player, TEXT("RocketState"));
+		Player->AddInstanceComponent(RocketState);
+		RocketState->RegisterComponent();
+	}
+
+	PlayerRocketStates.AddUnique(RocketState);
+}
+
+void UPWGravityZoneSubsystem::AddEnemyGravityState(APWEnemyCharacter* Enemy)
+{
+	if(UPWEnemyGravityStateComponent::FindGravityState(Enemy) == nullptr)
+	{
+		UPWEnemyGravityStateComponent* GravityState = NewObject<UPWEnemyGravityStateComponent>(Enemy, TEXT("GravityState"));
+		Enemy->AddInstanceComponent(GravityState);
+		GravityState->RegisterComponent();
+	}
+}
+
+void UPWGravityZoneSubsystem::AddFloatingEnemy(UPWEnemyGravityStateComponent* GravityState)
+{
+	LLM_SCOPE_BYTAG(PWEnemies);
+
+	APWEnemyCharacter* Enemy = Cast<APWEnemyCharacter>(GravityState->GetOwner());
+	if(Enemy == nullptr || GravityState->FloatingIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	GravityState->FloatingIndex = FloatingEnemies.Add(Enemy);
+	FloatingStates.Add(GravityState);
+}
+
+void UPWGravityZoneSubsystem::RemoveFloatingEnemy(UPWEnemyGravityStateComponent* GravityState)
+{
+	const int32 Index = GravityState->FloatingIndex;
+	if(FloatingStates.IsValidIndex(Index) == false || FloatingStates[Index] != GravityState)
+	{
+		return;
+	}
+
+	//Swap the last enemy in the removed slot and fix its index
+	FloatingEnemies.RemoveAtSwap(Index);
+	FloatingStates.RemoveAtSwap(Index);
+	if(FloatingStates.IsValidIndex(Index))
+	{
+		FloatingStates[Index]->FloatingIndex = Index;
+	}
+
+	GravityState->FloatingIndex = INDEX_NONE;
+}
+
+SIZE_T UPWGravityZoneSubsystem::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = ActiveZones.GetAllocatedSize() + PlayerRocketStates.GetAllocatedSize() + FloatingEnemies.GetAllocatedSize() + FloatingStates.GetAllocatedSize();
+	for(const FPWGravityZoneInfo& Zone : ActiveZones)
+	{
+		AllocatedSize += Zone.IgnoredPawnClasses.GetAllocatedSize();
+	}
+	return AllocatedSize;
+}
+
+void UPWGravityZoneSubsystem::DrawFloatingEnemies(float Duration) const
+{
+#if ENABLE_DRAW_DEBUG
+	for(const FPWGravityZoneInfo& Zone : ActiveZones)
+	{
+		const FPWGravityZoneShape& Shape = Zone.Shape;
+		switch (Shape.Type)
+		{
+			case EPWGravityZoneShapeType::Capsule:
+				DrawDebugCapsule(GetWorld(), Shape.Center, Shape.HalfHeight, Shape.Radius, Shape.Rotation, FColor::Cyan, false, Duration);
+				break;
+			case EPWGravityZoneShapeType::Box:
+				DrawDebugBox(GetWorld(), Shape.Center, Shape.BoxExtent, Shape.Rotation, FColor::Cyan, false, Duration);
+				break;
+			case EPWGravityZoneShapeType::Cylinder:
+			{
+				const FVector HalfAxis = Shape.Rotation.GetAxisZ() * Shape.HalfHeight;
+				DrawDebugCylinder(GetWorld(), Shape.Center - HalfAxis, Shape.Center + HalfAxis, Shape.Radius, 24, FColor::Cyan, false, Duration);
+				break;
+			}
+			default:
+				DrawDebugSphere(GetWorld(), Zone.Center, Zone.Radius, 24, FColor::Cyan, false, Duration);
+				break;
+		}
+	}
+
+	for(const APWEnemyCharacter* Enemy : FloatingEnemies)
+	{
+		if(Enemy != nullptr)
+		{
+			DrawDebugSphere(GetWorld(), Enemy->GetActorLocation(), 50.0f, 8, FColor::Orange, false, Duration);
+			DrawDebugString(GetWorld(), Enemy->GetActorLocation() + FVector(0, 0, 100), FString::Printf(TEXT("%d zones"), Enemy->NbRocketOverlappingCounter), nullptr, FColor::White, Duration);
+		}
+	}
+#endif
+
+	UE_LOG(LogTemp, Log, TEXT("%d floating enemies in %d gravity zones"), FloatingEnemies.Num(), ActiveZones.Num());
+}
+
+void UPWGravityZoneSubsystem::RegisterZone(APW_RocketCreation* Rocket)
+{
+	LLM_SCOPE_BYTAG(PWRockets);
+
+	if(Rocket == nullptr || ActiveZones.ContainsByPredicate([Rocket](const FPWGravityZoneInfo& Zone) { return Zone.Rocket == Rocket; }))
+	{
+		return;
+	}
+
+	FPWGravityZoneInfo& NewZone = ActiveZones.AddDefaulted_GetRef();
+	FillZoneInfo(Rocket, NewZone);
+	NewZone.ZoneId = NextZoneId++;
+
+	OnZoneAdded.Broadcast(NewZone);
+}
+
+void UPWGravityZoneSubsystem::RefreshZone(APW_RocketCreation* Rocket)
+{
+	for(FPWGravityZoneInfo& Zone : ActiveZones)
+	{
+		if(Zone.Rocket == Rocket)
+		{
+			FillZoneInfo(Rocket, Zone);
+			OnZoneRefreshed.Broadcast(Zone);
+			return;
+		}
+	}
+}
+
+void UPWGravityZoneSubsystem::UnregisterZone(APW_RocketCreation* Rocket)
+{
+	const int32 ZoneIndex = ActiveZones.IndexOfByPredicate([Rocket](const FPWGravityZoneInfo& Zone) { return Zone.Rocket == Rocket; });
+	if(ZoneIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	const FPWGravityZoneInfo RemovedZone = ActiveZones[ZoneIndex];
+	ActiveZones.RemoveAtSwap(ZoneIndex);
+
+	OnZoneRemoved.Broadcast(RemovedZone);
+}
+
+int32 UPWGravityZoneSubsystem::CountEnemyZonesContaining(const FVector& Location, const UClass* EnemyClass) const
+{
+	int32 Count = 0;
+	for(const FPWGravityZoneInfo& Zone : ActiveZones)
+	{
+		if(Zone.Contains(Location) && Zone.CanAffectEnemyClass(EnemyClass))
+		{
+			++Count;
+		}
+	}
+	return Count;
+}
@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Characters/Enemies/PWEnemyGravityStateComponent.h"
+#include "Creator/Items/CreationItems/PWGravityZoneShape.h"
+#include "PWGravityZoneSubsystem.generated.h"
+
+class APW_RocketCreation;
+class APWGravityZoneReplicator;
+class APWPlayerCharacter;
+class APWEnemyCharacter;
+class UPWPlayerRocketStateComponent;
+class UPWEnemyGravityStateComponent;
+
+//Plain copy of the settings of an active rocket gravity zone, readable outside of the game thread
+USTRUCT()
+struct FPWGravityZoneInfo
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TWeakObjectPtr<APW_RocketCreation> Rocket;
+
+	//Unique id of the zone in this world, shared with the clients
+	UPROPERTY()
+	int32 ZoneId = INDEX_NONE;
+
+	//Volume of the zone
+	UPROPERTY()
+	FPWGravityZoneShape Shape;
+
+	//Bounding sphere of the volume, the same as the volume for a sphere zone
+	UPROPERTY()
+	FVector Center = FVector::ZeroVector;
+
+	UPROPERTY()
+	float Radius = 0.0f;
+
+	//The speed and gravity scale of the enemies floating in the zone
+	UPROPERTY()
+	float EnemyGravityZoneSpeed = 0.0f;
+
+	UPROPERTY()
+	float EnemyGravityScale = 0.0f;
+
+	//Filter of the zone, see APW_RocketCreation::CanAffectActor
+	UPROPERTY()
+	bool bAffectsEnemies = true;
+
+	UPROPERTY()
+	TArray<TObjectPtr<UClass>> IgnoredPawnClasses;
+
+	//Floating settings of the players in the zone
+	UPROPERTY()
+	bool bAffectsPlayer = true;
+
+	UPROPERTY()
+	float PlayerGravityScale = 0.0f;
+
+	UPROPERTY()
+	float PlayerAirControl = 1.0f;
+
+	UPROPERTY()
+	float PlayerZVelocity = 0.0f;
+
+	UPROPERTY()
+	float PlayerMovementFriction = 0.0f;
+
+	//Moon jump given to the players while the rocket is active
+	UPROPERTY()
+	bool bGivesPlayerMoonJump = false;
+
+	UPROPERTY()
+	float PlayerMoonJumpZVelocity = 0.0f;
+
+	UPROPERTY()
+	float PlayerMoonJumpGravityScale = 1.0f;
+
+	//Return true if the location is inside the zone
+	bool Contains(const FVector& Location) const
+	{
+		return FVector::DistSquared(Center, Location) <= FMath::Square(Radius) && Shape.Contains(Location);
+	}
+
+	//Return true if an enemy of this class can float in the zone
+	bool CanAffectEnemyClass(const UClass* EnemyClass) const;
+
+	//Return true if a player of this class can float in the zone
+	bool CanAffectPlayerClass(const UClass* PlayerClass) const;
+
+private:
+	bool IsIgnoredClass(const UClass* PawnClass) const;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnGravityZoneChanged, const FPWGravityZoneInfo& /*Zone*/);
+
+/**
+ * Registry of the active rocket gravity zones.
+ * Lets the systems that don't rely on the physics overlaps (like the enemies simulated as mass entities)
+ * apply exactly the same zones as the rockets.
+ */
+UCLASS()
+class PROJECTWATER_API UPWGravityZoneSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	//Spawns the replicator of the gravity state on the servers and gives their state components to the pawns already there
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	//Add a rocket to the active zones, called when the rocket is spawned
+	void RegisterZone(APW_RocketCreation* Rocket);
+
+	//Update the copy of the rocket settings, called when the zone filter changes
+	void RefreshZone(APW_RocketCreation* Rocket);
+
+	//Remove a rocket from the active zones, called when the rocket is launched
+	void UnregisterZone(APW_RocketCreation* Rocket);
+
+	const TArray<FPWGravityZoneInfo>& GetActiveZones() const { return ActiveZones; }
+
+	//Number of zones that contain the location and can affect an enemy of this class
+	int32 CountEnemyZonesContaining(const FVector& Location, const UClass* EnemyClass) const;
+
+	//Broadcasted when a zone appears or disappears
+	FOnGravityZoneChanged OnZoneAdded;
+	FOnGravityZoneChanged OnZoneRemoved;
+
+	//Broadcasted when the settings of an active zone change, like its filter
+	FOnGravityZoneChanged OnZoneRefreshed;
+
+	//Broadcasted on the gravity state transitions of every enemy
+	FOnEnemyGravityStateChanged OnEnemyGravityStateChanged;
+
+	//Replicator of the gravity state, nullptr in standalone games and until it is replicated on the clients
+	APWGravityZoneReplicator* GetReplicator() const { return Replicator.Get(); }
+	void SetReplicator(APWGravityZoneReplicator* InReplicator) { Replicator = InReplicator; }
+
+	//Rocket state of every player of the world, local or remote
+	const TArray<TWeakObjectPtr<UPWPlayerRocketStateComponent>>& GetPlayerRocketStates() const { return PlayerRocketStates; }
+
+	//Every enemy currently floating, without holes. Copy it before changing the gravity state of the enemies
+	const TArray<TObjectPtr<APWEnemyCharacter>>& GetFloatingEnemies() const { return FloatingEnemies; }
+
+	int32 GetNumFloatingEnemies() const { return FloatingEnemies.Num(); }
+
+	//Bytes allocated by the zone and floating lists, for the memory report
+	SIZE_T GetAllocatedSize() const;
+
+	//Called by the gravity state components on their transitions
+	void AddFloatingEnemy(UPWEnemyGravityStateComponent* GravityState);
+	void RemoveFloatingEnemy(UPWEnemyGravityStateComponent* GravityState);
+
+	//While suspended, the rockets ignore their enter and leave events, used while a world snapshot moves every actor
+	void SetZoneEventsSuspended(bool bSuspended) { bZoneEventsSuspended = bSuspended; }
+	bool AreZoneEventsSuspended() const { return bZoneEventsSuspended; }
+
+	//Draw the floating enemies and their gravity zone for a few seconds
+	void DrawFloatingEnemies(float Duration) const;
+
+private:
+	static void FillZoneInfo(APW_RocketCreation* Rocket, FPWGravityZoneInfo& OutZone);
+
+	void OnActorSpawned(AActor* SpawnedActor);
+
+	//Add the rocket state component to a player, only once
+	void AddPlayerRocketState(APWPlayerCharacter* Player);
+
+	//Add the gravity state component to an enemy, only once
+	static void AddEnemyGravityState(APWEnemyCharacter* Enemy);
+
+	UPROPERTY()
+	TArray<FPWGravityZoneInfo> ActiveZones;
+
+	TWeakObjectPtr<APWGravityZoneReplicator> Replicator;
+
+	TArray<TWeakObjectPtr<UPWPlayerRocketStateComponent>> PlayerRocketStates;
+
+	//The floating enemies and their gravity state, at the same index
+	UPROPERTY()
+	TArray<TObjectPtr<APWEnemyCharacter>> FloatingEnemies;
+
+	UPROPERTY()
+	TArray<TObjectPtr<UPWEnemyGravityStateComponent>> FloatingStates;
+
+	FDelegateHandle ActorSpawnedHandle;
+
+	int32 NextZoneId = 0;
+
+	bool bZoneEventsSuspended = false;
+};
@@ -0,0 +1,281 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Characters/Enemies/Navigation/PWPathRequestQueueSubsystem.h"
+#include "Core/PWGameplayStats.h"
+#include "NavigationSystem.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "Characters/Enemies/PWEnemyGravityStateComponent.h"
+#include "Characters/Enemies/PWEnemyPoolSubsystem.h"
+#include "Characters/Enemies/Controllers/BlackboardKeys.h"
+#include "Characters/Enemies/Controllers/PWEnemyController.h"
+#include "GameFramework/PlayerController.h"
+
+void UPWPathRequestQueueSubsystem::Deinitialize()
+{
+	QueuedEnemies.Empty();
+	SharedPaths.Empty();
+	ServedPaths.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UPWPathRequestQueueSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWPathRequestQueueSubsystem, STATGROUP_Tickables);
+}
+
+void UPWPathRequestQueueSubsystem::EnqueueLandingEnemy(APWEnemyCharacter* Enemy)
+{
+	if(Enemy != nullptr)
+	{
+		QueuedEnemies.AddUnique(Enemy);
+	}
+}
+
+bool UPWPathRequestQueueSubsystem::ConsumeLandingPath(APWEnemyCharacter* Enemy, FNavPathSharedPtr& OutPath, AActor*& OutTargetActor)
+{
+	FPWServedLandingPath ServedPath;
+	if(ServedPaths.RemoveAndCopyValue(Enemy, ServedPath) == false || ServedPath.Path.IsValid() == false || ServedPath.TargetActor.IsValid() == false)
+	{
+		return false;
+	}
+
+	OutPath = ServedPath.Path;
+	OutTargetActor = ServedPath.TargetActor.Get();
+	return true;
+}
+
+void UPWPathRequestQueueSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	PW_SCOPE_GAMEPLAY_TIME(PathQueue);
+
+	//Forget the old shared paths, the ones still being searched are kept for their waiting enemies
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+	SharedPaths.RemoveAllSwap([this, CurrentTime](const FPWSharedLandingPath& SharedPath)
+	{
+		return SharedPath.QueryId == 0 && CurrentTime - SharedPath.RequestTime > SharedPathLifetime;
+	});
+
+	//The enemies destroyed, pooled or floating again don't need a ground path anymore
+	const UPWEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UPWEnemyPoolSubsystem>();
+	const auto IsLandingOver = [EnemyPool](const TWeakObjectPtr<APWEnemyCharacter>& Enemy)
+	{
+		return Enemy.IsValid() == false || Enemy->bIsInGravityZone == true || (EnemyPool != nullptr && EnemyPool->IsPooled(Enemy.Get()));
+	};
+	QueuedEnemies.RemoveAll(IsLandingOver);
+
+	//Same for the served paths the behavior tree didn't take
+	for(auto It = ServedPaths.CreateIterator(); It; ++It)
+	{
+		if(IsLandingOver(It.Key()))
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	if(QueuedEnemies.IsEmpty())
+	{
+		return;
+	}
+
+	TArray<FVector> PlayerLocations;
+	for(FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if(const APlayerController* PlayerController = It->Get(); PlayerController != nullptr && PlayerController->GetPawn() != nullptr)
+		{
+			PlayerLocations.Add(PlayerController->GetPawn()->GetActorLocation());
+		}
+	}
+
+	//The closest enemies to a player are the ones the player would see standing still, they are served first
+	if(PlayerLocations.Num() > 0 && QueuedEnemies.Num() > MaxEnemiesPerFrame)
+	{
+		const auto GetClosestPlayerDistanceSquared = [&PlayerLocations](const APWEnemyCharacter* Enemy)
+		{
+			double ClosestDistanceSquared = TNumericLimits<double>::Max();
+			for(const FVector& PlayerLocation : PlayerLocations)
+			{
+				ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared, FVector::DistSquared(Enemy->GetActorLocation(), PlayerLocation));
+			}
+			return ClosestDistanceSquared;
+		};
+
+		QueuedEnemies.Sort([&GetClosestPlayerDistanceSquared](const TWeakObjectPtr<APWEnemyCharacter>& A, const TWeakObjectPtr<APWEnemyCharacter>& B)
+		{
+			return GetClosestPlayerDistanceSquared(A.Get()) < GetClosestPlayerDistanceSquared(B.Get());
+		});
+	}
+
+	const int32 NumToServe = FMath::Min(MaxEnemiesPerFrame, QueuedEnemies.Num());
+	for(int32 i = 0; i < NumToServe; i++)
+	{
+		RequestLandingPath(QueuedEnemies[i].Get());
+	}
+	QueuedEnemies.RemoveAt(0, NumToServe);
+}
+
+void UPWPathRequestQueueSubsystem::RequestLandingPath(APWEnemyCharacter* Enemy)
+{
+	APWEnemyController* AIController = Cast<APWEnemyController>(Enemy->GetController());
+	if(AIController == nullptr)
+	{
+		//Still end the landing, else the enemy stays out of the grounded state
+		ServeEnemy(Enemy, nullptr, nullptr);
+		return;
+	}
+
+	AActor* TargetActor = Cast<AActor>(AIController->GetBlackboard()->GetValueAsObject(BBKeys::TargetActor));
+	if(TargetActor == nullptr)
+	{
+		//Nothing to path to, the behavior tree decides what to do on the ground
+		ServeEnemy(Enemy, nullptr, nullptr);
+		return;
+	}
+
+	//Follow a path already requested by an enemy that landed close to this one
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+	const FVector EnemyLocation = Enemy->GetActorLocation();
+	for(FPWSharedLandingPath& SharedPath : SharedPaths)
+	{
+		if(SharedPath.TargetActor != TargetActor || FVector::DistSquared(SharedPath.StartLocation, EnemyLocation) > FMath::Square(SharedPathRadius))
+		{
+			continue;
+		}
+
+		if(SharedPath.QueryId != 0)
+		{
+			SharedPath.WaitingEnemies.Add(Enemy);
+			return;
+		}
+
+		if(SharedPath.Path.IsValid() && CurrentTime - SharedPath.RequestTime <= SharedPathLifetime)
+		{
+			ServeEnemy(Enemy, SharedPath.Path, TargetActor);
+			return;
+		}
+	}
+
+	//Else request a new path for this enemy and the ones that will land around it
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const ANavigationData* NavData = NavSys ? NavSys->GetNavDataForProps(AIController->GetNavAgentPropertiesRef()) : nullptr;
+	if(NavData == nullptr)
+	{
+		ServeEnemy(Enemy, nullptr, nullptr);
+		return;
+	}
+
+	const FPathFindingQuery Query(AIController, *NavData, EnemyLocation, TargetActor->GetActorLocation());
+	const uint32 QueryId = NavSys->FindPathAsync(AIController->GetNavAgentPropertiesRef(), Query,
+		FNavPathQueryDelegate::CreateUObject(this, &UPWPathRequestQueueSubsystem::OnLandingPathFound));
+
+	if(QueryId == INVALID_NAVQUERYID)
+	{
+		ServeEnemy(Enemy, nullptr, nullptr);
+		return;
+	}
+
+	FPWSharedLandingPath& NewSharedPath = SharedPaths.AddDefaulted_GetRef();
+	NewSharedPath.TargetActor = TargetActor;
+	NewSharedPath.StartLocation = EnemyLocation;
+	NewSharedPath.RequestTime = CurrentTime;
+	NewSharedPath.QueryId = QueryId;
+	NewSharedPath.WaitingEnemies.Add(Enemy);
+}
+
+void UPWPathRequestQueueSubsystem::OnLandingPathFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path)
+{
+	FPWSharedLandingPath* SharedPath = SharedPaths.FindByPredicate([QueryId](const FPWSharedLandingPath& Candidate) { return Candidate.QueryId == QueryId; });
+	if(SharedPath == nullptr)
+	{
+		return;
+	}
+
+	SharedPath->QueryId = 0;
+	SharedPath->Path = Result == ENavigationQueryResult::Success ? Path : nullptr;
+
+	TArray<TWeakObjectPtr<APWEnemyCharacter>> WaitingEnemies = MoveTemp(SharedPath->WaitingEnemies);
+	for(const TWeakObjectPtr<APWEnemyCharacter>& Enemy : WaitingEnemies)
+	{
+		if(Enemy.IsValid() && Enemy->bIsInGravityZone == false)
+		{
+			ServeEnemy(Enemy.Get(), SharedPath->Path, SharedPath->TargetActor.Get());
+		}
+	}
+}
+
+void UPWPathRequestQueueSubsystem::ServeEnemy(APWEnemyCharacter* Enemy, const FNavPathSharedPtr& Path, AActor* TargetActor)
+{
+	//Every way out of the queue goes through here, served or not the landing is over
+	if(UPWEnemyGravityStateComponent* GravityState = UPWEnemyGravityStateComponent::FindGravityState(Enemy))
+	{
+		GravityState->FinishLanding();
+	}
+
+	APWEnemyController* AIController = Cast<APWEnemyController>(Enemy->GetController());
+	if(AIController == nullptr)
+	{
+		return;
+	}
+
+	//Keep the path before the ground branch starts, its follow landing path task takes it instead of searching another one.
+	//Without a path the ground branch searches its own
+	ServedPaths.Remove(Enemy);
+	if(Path.IsValid() && TargetActor != nullptr)
+	{
+		if(FNavPathSharedPtr JoinedPath = JoinSharedPath(Path, Enemy))
+		{
+			ServedPaths.Add(Enemy, {JoinedPath, TargetActor});
+		}
+	}
+
+	//Deactivate the floating state of the AI with the blackboard key
+	AIController->GetBlackboard()->SetValueAsBool(BBKeys::GravityEnabled, false);
+}
+
+FNavPathSharedPtr UPWPathRequestQueueSubsystem::JoinSharedPath(const FNavPathSharedPtr& SharedPath, const APWEnemyCharacter* Enemy) const
+{
+	const TArray<FNavPathPoint>& SharedPoints = SharedPath->GetPathPoints();
+	if(SharedPoints.Num() < 2)
+	{
+		return nullptr;
+	}
+
+	//Join the segment of the shared path closest to the enemy, at its end, so the enemy never walks back to the start
+	const FVector EnemyLocation = Enemy->GetActorLocation();
+	int32 JoinIndex = 1;
+	double ClosestDistanceSquared = TNumericLimits<double>::Max();
+	for(int32 PointIndex = 1; PointIndex < SharedPoints.Num(); PointIndex++)
+	{
+		const FVector ClosestPoint = FMath::ClosestPointOnSegment(EnemyLocation, SharedPoints[PointIndex - 1].Location, SharedPoints[PointIndex].Location);
+		const double DistanceSquared = FVector::DistSquared(ClosestPoint, EnemyLocation);
+		if(DistanceSquared < ClosestDistanceSquared)
+		{
+			ClosestDistanceSquared = DistanceSquared;
+			JoinIndex = PointIndex;
+		}
+	}
+
+	//The shortcut to the join point must stay on the navmesh, else the enemy searches its own path
+	const ANavigationData* NavData = SharedPath->GetNavigationDataUsed();
+	FVector HitLocation;
+	if(NavData == nullptr || NavData->Raycast(EnemyLocation, SharedPoints[JoinIndex].Location, HitLocation, nullptr, Enemy->GetController()))
+	{
+		return nullptr;
+	}
+
+	TArray<FVector> JoinedPoints;
+	JoinedPoints.Reserve(SharedPoints.Num() - JoinIndex + 1);
+	JoinedPoints.Add(EnemyLocation);
+	for(int32 PointIndex = JoinIndex; PointIndex < SharedPoints.Num(); PointIndex++)
+	{
+		JoinedPoints.Add(SharedPoints[PointIndex].Location);
+	}
+
+	FNavPathSharedPtr JoinedPath = MakeShared<FNavigationPath, ESPMode::ThreadSafe>(JoinedPoints);
+	JoinedPath->SetNavigationDataUsed(NavData);
+	JoinedPath->SetQuerier(Enemy->GetController());
+	return JoinedPath;
+}
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavigationData.h"
+#include "NavigationSystemTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PWPathRequestQueueSubsystem.generated.h"
+
+class APWEnemyCharacter;
+
+//Path toward a target shared by the enemies landing close to each other
+USTRUCT()
+struct FPWSharedLandingPath
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TWeakObjectPtr<AActor> TargetActor;
+
+	//Where the path starts, the enemies landing close to it can follow it too
+	UPROPERTY()
+	FVector StartLocation = FVector::ZeroVector;
+
+	UPROPERTY()
+	double RequestTime = 0.0;
+
+	//Async query of the path, 0 once the path is found
+	UPROPERTY()
+	uint32 QueryId = 0;
+
+	//Enemies waiting for the path to be found
+	UPROPERTY()
+	TArray<TWeakObjectPtr<APWEnemyCharacter>> WaitingEnemies;
+
+	FNavPathSharedPtr Path;
+};
+
+//Path given to a landing enemy, until its behavior tree follows it
+struct FPWServedLandingPath
+{
+	FNavPathSharedPtr Path;
+	TWeakObjectPtr<AActor> TargetActor;
+};
+
+/**
+ * Spreads the re-pathing of the enemies that land after their last rocket over several frames.
+ * The closest enemies to a player are served first, and the enemies landing close to each other share one
+ * async path toward the same target, joined from where each enemy stands. The enemies are already walking while
+ * they wait, only the switch of their behavior tree back to the ground behavior is delayed.
+ * The ground branch of the behavior tree follows the served path with UBTTask_FollowLandingPath, and only
+ * requests its own path when that task fails because no path was served.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWPathRequestQueueSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Queue an enemy that stopped floating, its ground path is requested on a later frame
+	void EnqueueLandingEnemy(APWEnemyCharacter* Enemy);
+
+	int32 GetNumQueuedEnemies() const { return QueuedEnemies.Num(); }
+
+	//Take the path served to the enemy, return false if it has none
+	bool ConsumeLandingPath(APWEnemyCharacter* Enemy, FNavPathSharedPtr& OutPath, AActor*& OutTargetActor);
+
+	//Maximum number of queued enemies served each frame
+	UPROPERTY(Config)
+	int32 MaxEnemiesPerFrame = 8;
+
+	//Enemies landing closer than this to the start of a shared path follow the same path
+	UPROPERTY(Config)
+	float SharedPathRadius = 300.0f;
+
+	//Seconds a shared path can be given to new enemies
+	UPROPERTY(Config)
+	float SharedPathLifetime = 1.0f;
+
+private:
+	//Switch the enemy back to its ground behavior and keep the path for its behavior tree
+	void ServeEnemy(APWEnemyCharacter* Enemy, const FNavPathSharedPtr& Path, AActor* TargetActor);
+
+	//Copy of the shared path starting at the enemy and joining the shared path at its closest segment,
+	//nullptr if the enemy can't walk straight to the join point
+	FNavPathSharedPtr JoinSharedPath(const FNavPathSharedPtr& SharedPath, const APWEnemyCharacter* Enemy) const;
+
+	//Give the enemy a shared path, or request a new one
+	void RequestLandingPath(APWEnemyCharacter* Enemy);
+
+	void OnLandingPathFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path);
+
+	UPROPERTY()
+	TArray<TWeakObjectPtr<APWEnemyCharacter>> QueuedEnemies;
+
+	UPROPERTY()
+	TArray<FPWSharedLandingPath> SharedPaths;
+
+	TMap<TWeakObjectPtr<APWEnemyCharacter>, FPWServedLandingPath> ServedPaths;
+};
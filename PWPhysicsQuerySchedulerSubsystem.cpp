@@ -0,0 +1,161 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Core/PWPhysicsQuerySchedulerSubsystem.h"
+#include "Core/PWGameplayStats.h"
+
+static FAutoConsoleCommandWithWorld LogPhysicsQueryStatsCommand(
+	TEXT("pw.PhysicsQueries.Stats"),
+	TEXT("Log the queries run and deferred by the physics query scheduler since the last call."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(UPWPhysicsQuerySchedulerSubsystem* QueryScheduler = World != nullptr ? World->GetSubsystem<UPWPhysicsQuerySchedulerSubsystem>() : nullptr)
+		{
+			QueryScheduler->LogQueryStats();
+		}
+	}));
+
+void UPWPhysicsQuerySchedulerSubsystem::Deinitialize()
+{
+	for(TArray<FQueuedQuery>& Queue : Queues)
+	{
+		Queue.Empty();
+	}
+	RunningQueries.Empty();
+
+	SET_DWORD_STAT(STAT_PWPhysicsQueryQueueDepth, 0);
+
+	Super::Deinitialize();
+}
+
+TStatId UPWPhysicsQuerySchedulerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWPhysicsQuerySchedulerSubsystem, STATGROUP_Tickables);
+}
+
+void UPWPhysicsQuerySchedulerSubsystem::SubmitQuery(EPWPhysicsQueryPriority Priority, FPWPhysicsQueryDelegate Query)
+{
+	check(Priority < EPWPhysicsQueryPriority::Count);
+
+	FQueuedQuery& QueuedQuery = Queues[static_cast<int32>(Priority)].AddDefaulted_GetRef();
+	QueuedQuery.Query = MoveTemp(Query);
+	QueuedQuery.SubmitFrame = GFrameCounter;
+}
+
+void UPWPhysicsQuerySchedulerSubsystem::CancelQueries(const UObject* Owner)
+{
+	for(TArray<FQueuedQuery>& Queue : Queues)
+	{
+		Queue.RemoveAll([Owner](const FQueuedQuery& QueuedQuery) { return QueuedQuery.Query.IsBoundToObject(Owner); });
+	}
+
+	//Called from a running query, e.g. a rocket destroyed by its launch: Tick is iterating this array, only flag them
+	for(FQueuedQuery& QueuedQuery : RunningQueries)
+	{
+		if(QueuedQuery.Query.IsBoundToObject(Owner))
+		{
+			QueuedQuery.bCancelled = true;
+		}
+	}
+}
+
+int32 UPWPhysicsQuerySchedulerSubsystem::GetQueueDepth() const
+{
+	int32 QueueDepth = RunningQueries.Num();
+	for(const TArray<FQueuedQuery>& Queue : Queues)
+	{
+		QueueDepth += Queue.Num();
+	}
+	return QueueDepth;
+}
+
+SIZE_T UPWPhysicsQuerySchedulerSubsystem::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = RunningQueries.GetAllocatedSize();
+	for(const TArray<FQueuedQuery>& Queue : Queues)
+	{
+		AllocatedSize += Queue.GetAllocatedSize();
+	}
+	return AllocatedSize;
+}
+
+void UPWPhysicsQuerySchedulerSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_PWPhysicsQueryScheduler);
+	PW_SCOPE_GAMEPLAY_TIME(PhysicsQueries);
+
+	const int32 QueueDepth = GetQueueDepth();
+	SET_DWORD_STAT(STAT_PWPhysicsQueryQueueDepth, QueueDepth);
+	PeakQueueDepth = FMath::Max(PeakQueueDepth, QueueDepth);
+
+	NumRunLastFrame = 0;
+	NumDeferredLastFrame = 0;
+	if(QueueDepth == 0)
+	{
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double BudgetSeconds = MaxMillisecondsPerFrame / 1000.0;
+
+	for(int32 PriorityIndex = 0; PriorityIndex < UE_ARRAY_COUNT(Queues); PriorityIndex++)
+	{
+		//Run the queue from a local array, the queries run here can submit others, which wait for the next frame,
+		//or cancel others, which are only flagged
+		TArray<FQueuedQuery>& Queue = Queues[PriorityIndex];
+		RunningQueries = MoveTemp(Queue);
+		const int32 NumQueued = RunningQueries.Num();
+
+		int32 NumDone = 0;
+		for(; NumDone < NumQueued; NumDone++)
+		{
+			if(RunningQueries[NumDone].bCancelled)
+			{
+				continue;
+			}
+
+			//The queue is in submit order, once a query is too recent to be forced the next ones are too
+			const bool bIsOverBudget = NumRunLastFrame >= MaxQueriesPerFrame || FPlatformTime::Seconds() - StartTime >= BudgetSeconds;
+			const bool bMustRun = PriorityIndex == static_cast<int32>(EPWPhysicsQueryPriority::Urgent) || GFrameCounter - RunningQueries[NumDone].SubmitFrame >= static_cast<uint64>(MaxDeferredFrames);
+			if(bIsOverBudget && bMustRun == false)
+			{
+				break;
+			}
+
+			if(RunningQueries[NumDone].Query.ExecuteIfBound())
+			{
+				++NumRunLastFrame;
+			}
+		}
+
+		//The deferred queries go back in front of the ones submitted meanwhile
+		RunningQueries.RemoveAt(0, NumDone);
+		RunningQueries.RemoveAll([](const FQueuedQuery& QueuedQuery) { return QueuedQuery.bCancelled; });
+		NumDeferredLastFrame += RunningQueries.Num();
+		RunningQueries.Append(MoveTemp(Queue));
+		Queue = MoveTemp(RunningQueries);
+	}
+
+	if(NumDeferredLastFrame > 0)
+	{
+		++NumFramesOverBudget;
+	}
+
+	TotalRun += NumRunLastFrame;
+	TotalDeferred += NumDeferredLastFrame;
+	INC_DWORD_STAT_BY(STAT_PWPhysicsQueriesRun, NumRunLastFrame);
+	INC_DWORD_STAT_BY(STAT_PWPhysicsQueriesDeferred, NumDeferredLastFrame);
+}
+
+void UPWPhysicsQuerySchedulerSubsystem::LogQueryStats()
+{
+	UE_LOG(LogTemp, Log, TEXT("Physics query scheduler: %lld queries run, %lld deferrals, %d frames over budget, peak queue depth %d, %d queued now (budget %d queries, %.2f ms)"),
+		TotalRun, TotalDeferred, NumFramesOverBudget, PeakQueueDepth, GetQueueDepth(), MaxQueriesPerFrame, MaxMillisecondsPerFrame);
+
+	TotalRun = 0;
+	TotalDeferred = 0;
+	NumFramesOverBudget = 0;
+	PeakQueueDepth = GetQueueDepth();
+}
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PWPhysicsQuerySchedulerSubsystem.generated.h"
+
+//Runs the sweeps, overlaps or navigation tests of a query. Bound to its owner, so it is skipped once the owner is destroyed
+DECLARE_DELEGATE(FPWPhysicsQueryDelegate);
+
+//Order in which the queries are run, and how long they can wait
+UENUM()
+enum class EPWPhysicsQueryPriority : uint8
+{
+	//Run on the next update whatever the budget
+	Urgent,
+	//Gameplay that waits for the result
+	Normal,
+	//Cosmetic work, only runs with the budget left by the others
+	Low,
+
+	Count UMETA(Hidden)
+};
+
+/**
+ * Spreads the physics and navigation queries of the gameplay over the frames.
+ * The queries are queued with a priority and run once per frame within a budget of queries and milliseconds,
+ * the urgent ones first. What doesn't fit is deferred to the next frames, and a query deferred for MaxDeferredFrames
+ * runs whatever the budget so nothing waits forever. The budget can be tuned per platform in the platform Game.ini.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWPhysicsQuerySchedulerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Queue a query, it runs on this frame or a later one depending on its priority and the budget
+	void SubmitQuery(EPWPhysicsQueryPriority Priority, FPWPhysicsQueryDelegate Query);
+
+	template<class UserClass>
+	void SubmitQuery(EPWPhysicsQueryPriority Priority, UserClass* Object, void (UserClass::*Method)())
+	{
+		SubmitQuery(Priority, FPWPhysicsQueryDelegate::CreateUObject(Object, Method));
+	}
+
+	//Forget every queued query of this object, safe to call from a running query
+	void CancelQueries(const UObject* Owner);
+
+	int32 GetQueueDepth() const;
+	int32 GetNumRunLastFrame() const { return NumRunLastFrame; }
+	int32 GetNumDeferredLastFrame() const { return NumDeferredLastFrame; }
+
+	//Bytes allocated by the queues
+	SIZE_T GetAllocatedSize() const;
+
+	//Log the totals since the last call, to tune the budget
+	void LogQueryStats();
+
+	//Maximum number of queries run each frame, the urgent ones included
+	UPROPERTY(Config)
+	int32 MaxQueriesPerFrame = 16;
+
+	//Milliseconds of queries each frame
+	UPROPERTY(Config)
+	float MaxMillisecondsPerFrame = 0.5f;
+
+	//Frames a query can be deferred before it runs whatever the budget
+	UPROPERTY(Config)
+	int32 MaxDeferredFrames = 30;
+
+private:
+	struct FQueuedQuery
+	{
+		FPWPhysicsQueryDelegate Query;
+		uint64 SubmitFrame = 0;
+		//Cancelled while it was in RunningQueries, skipped instead of removed
+		bool bCancelled = false;
+	};
+
+	TArray<FQueuedQuery> Queues[static_cast<int32>(EPWPhysicsQueryPriority::Count)];
+
+	//Queue being run by Tick, moved out of Queues so the running queries can submit or cancel others
+	TArray<FQueuedQuery> RunningQueries;
+
+	int32 NumRunLastFrame = 0;
+	int32 NumDeferredLastFrame = 0;
+
+	//Totals since the last LogQueryStats
+	int64 TotalRun = 0;
+	int64 TotalDeferred = 0;
+	int32 PeakQueueDepth = 0;
+	int32 NumFramesOverBudget = 0;
+};
@@ -0,0 +1,309 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Interactor/PWPickupBurstSubsystem.h"
+#include "NavigationSystem.h"
+#include "Characters/Player/WaterSystem/PWFountain.h"
+#include "Core/PWGameplayStats.h"
+#include "Engine/OverlapResult.h"
+#include "Engine/StaticMeshActor.h"
+#include "Interactor/Interactable.h"
+
+void UPWPickupBurstSubsystem::SpawnPickupBurst(TSubclassOf<AInteractable> PickupClass, int32 NumPickups, const FVector& Center, float MinSpacing, TArray<AInteractable*>& OutPickups)
+{
+	LLM_SCOPE_BYTAG(PWPickups);
+
+	OutPickups.Reset();
+	if(PickupClass == nullptr || NumPickups <= 0)
+	{
+		return;
+	}
+
+	const AInteractable* DefaultPickup = PickupClass->GetDefaultObject<AInteractable>();
+	MinSpacing = FMath::Max(MinSpacing, 1.0f);
+
+	//A few spare candidates replace the ones rejected by the validation, nothing is rolled again
+	const int32 NumCandidates = NumPickups + FMath::Max(2, NumPickups / 2);
+
+	//A Poisson-disk layout takes about 1.4 * MinSpacing^2 per point, the disc grows when the layout still can't hold every candidate
+	FRandomStream RandomStream(FMath::Rand());
+	float Radius = FMath::Max(DefaultPickup->MaxDistanceToTravel, MinSpacing * FMath::Sqrt(NumCandidates * 0.5f));
+	TArray<FVector2D> Offsets;
+	for(int32 Attempt = 0; Attempt < 3 && GeneratePoissonDiskLayout(RandomStream, Radius, MinSpacing, NumCandidates, Offsets) < NumCandidates; Attempt++)
+	{
+		Radius *= 1.25f;
+	}
+
+	TArray<FVector> Destinations;
+	Destinations.Reserve(Offsets.Num());
+	for(const FVector2D& Offset : Offsets)
+	{
+		Destinations.Add(Center + FVector(Offset.X, Offset.Y, 0.0f));
+	}
+
+	TBitArray<> ValidDestinations;
+	ValidateDestinations(Center, Radius, DefaultPickup->GroundLocation, Destinations, ValidDestinations);
+
+	//The candidates are in layout order, the first valid ones are kept
+	TArray<FVector, TInlineAllocator<32>> ChosenDestinations;
+	TArray<FVector> RejectedDestinations;
+	const auto KeepValidDestinations = [&]()
+	{
+		for(int32 i = 0; i < Destinations.Num(); i++)
+		{
+			if(ValidDestinations[i] && ChosenDestinations.Num() < NumPickups)
+			{
+				ChosenDestinations.Add(Destinations[i]);
+			}
+			else if(ValidDestinations[i] == false)
+			{
+				RejectedDestinations.Add(Destinations[i]);
+			}
+		}
+	};
+	KeepValidDestinations();
+
+	//Without enough of them the layout grows in a ring around the disc, the new points keep their spacing with the chosen ones
+	for(int32 Ring = 0; Ring < 2 && ChosenDestinations.Num() < NumPickups; Ring++)
+	{
+		const float InnerRadius = Radius;
+		Radius += FMath::Max(InnerRadius * 0.5f, 2.0f * MinSpacing);
+		const int32 MaxRingPoints = FMath::CeilToInt(UE_PI * FMath::Square(Radius) / (1.4f * FMath::Square(MinSpacing)));
+		GeneratePoissonDiskLayout(RandomStream, Radius, MinSpacing, MaxRingPoints, Offsets);
+
+		Destinations.Reset();
+		for(const FVector2D& Offset : Offsets)
+		{
+			const FVector Destination = Center + FVector(Offset.X, Offset.Y, 0.0f);
+			const bool bIsInRing = Offset.SizeSquared() >= FMath::Square(InnerRadius);
+			if(bIsInRing && ChosenDestinations.ContainsByPredicate([&Destination, MinSpacing](const FVector& Chosen) { return FVector2D::DistSquared(FVector2D(Chosen), FVector2D(Destination)) < FMath::Square(MinSpacing); }) == false)
+			{
+				Destinations.Add(Destination);
+			}
+		}
+
+		ValidateDestinations(Center, Radius, DefaultPickup->GroundLocation, Destinations, ValidDestinations);
+		KeepValidDestinations();
+	}
+
+	//Still not enough, the rejected candidates closest to the drop are used, they are spaced out as well
+	RejectedDestinations.Sort([&Center](const FVector& A, const FVector& B)
+	{
+		return FVector2D::DistSquared(FVector2D(A), FVector2D(Center)) < FVector2D::DistSquared(FVector2D(B), FVector2D(Center));
+	});
+	for(int32 i = 0; i < RejectedDestinations.Num() && ChosenDestinations.Num() < NumPickups; i++)
+	{
+		ChosenDestinations.Add(RejectedDestinations[i]);
+	}
+
+	//Only when no layout could be made at all
+	while(ChosenDestinations.Num() < NumPickups)
+	{
+		ChosenDestinations.Add(FVector(Center.X, Center.Y, DefaultPickup->GroundLocation + 15.0f));
+	}
+
+	const FTransform SpawnTransform(Center);
+	for(const FVector& Destination : ChosenDestinations)
+	{
+		AInteractable* Pickup = GetWorld()->SpawnActorDeferred<AInteractable>(PickupClass, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+		if(Pickup != nullptr)
+		{
+			Pickup->SetPlannedSpawnDestination(Destination);
+			Pickup->FinishSpawning(SpawnTransform);
+			OutPickups.Add(Pickup);
+		}
+	}
+}
+
+int32 UPWPickupBurstSubsystem::GeneratePoissonDiskLayout(FRandomStream& RandomStream, float Radius, float MinSpacing, int32 MaxPoints, TArray<FVector2D>& OutOffsets)
+{
+	OutOffsets.Reset();
+	if(MaxPoints <= 0 || Radius <= 0.0f)
+	{
+		return 0;
+	}
+
+	//With cells of MinSpacing / sqrt(2), a cell holds one point at most and the neighbors are in the 5x5 cells around
+	MinSpacing = FMath::Max(MinSpacing, 1.0f);
+	const float CellSize = MinSpacing / UE_SQRT_2;
+	const int32 GridSize = FMath::Max(1, FMath::CeilToInt(2.0f * Radius / CellSize));
+	TArray<int32> Grid;
+	Grid.Init(INDEX_NONE, GridSize * GridSize);
+
+	const auto GetCell = [Radius, CellSize, GridSize](const FVector2D& Point)
+	{
+		return FIntPoint(FMath::Clamp(FMath::FloorToInt((Point.X + Radius) / CellSize), 0, GridSize - 1),
+			FMath::Clamp(FMath::FloorToInt((Point.Y + Radius) / CellSize), 0, GridSize - 1));
+	};
+
+	const auto IsFarEnough = [&](const FVector2D& Point)
+	{
+		const FIntPoint Cell = GetCell(Point);
+		for(int32 Y = FMath::Max(Cell.Y - 2, 0); Y <= FMath::Min(Cell.Y + 2, GridSize - 1); Y++)
+		{
+			for(int32 X = FMath::Max(Cell.X - 2, 0); X <= FMath::Min(Cell.X + 2, GridSize - 1); X++)
+			{
+				const int32 PointIndex = Grid[Y * GridSize + X];
+				if(PointIndex != INDEX_NONE && FVector2D::DistSquared(OutOffsets[PointIndex], Point) < FMath::Square(MinSpacing))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	};
+
+	TArray<int32, TInlineAllocator<64>> ActivePoints;
+	const auto AddPoint = [&](const FVector2D& Point)
+	{
+		const int32 PointIndex = OutOffsets.Add(Point);
+		const FIntPoint Cell = GetCell(Point);
+		Grid[Cell.Y * GridSize + Cell.X] = PointIndex;
+		ActivePoints.Add(PointIndex);
+	};
+
+	//The first point anywhere in the disc, then new points between 1 and 2 spacings around the active ones
+	const float FirstAngle = RandomStream.FRandRange(0.0f, UE_TWO_PI);
+	const float FirstDistance = Radius * FMath::Sqrt(RandomStream.FRand());
+	AddPoint(FVector2D(FMath::Cos(FirstAngle), FMath::Sin(FirstAngle)) * FirstDistance);
+
+	while(ActivePoints.Num() > 0 && OutOffsets.Num() < MaxPoints)
+	{
+		const int32 ActiveIndex = RandomStream.RandHelper(ActivePoints.Num());
+		const FVector2D Origin = OutOffsets[ActivePoints[ActiveIndex]];
+
+		bool bFoundPoint = false;
+		for(int32 Attempt = 0; Attempt < PoissonDiskAttempts; Attempt++)
+		{
+			const float Angle = RandomStream.FRandRange(0.0f, UE_TWO_PI);
+			const FVector2D Candidate = Origin + FVector2D(FMath::Cos(Angle), FMath::Sin(Angle)) * RandomStream.FRandRange(MinSpacing, 2.0f * MinSpacing);
+			if(Candidate.SizeSquared() <= FMath::Square(Radius) && IsFarEnough(Candidate))
+			{
+				AddPoint(Candidate);
+				bFoundPoint = true;
+				break;
+			}
+		}
+
+		//No room left around this point
+		if(bFoundPoint == false)
+		{
+			ActivePoints.RemoveAtSwap(ActiveIndex);
+		}
+	}
+
+	return OutOffsets.Num();
+}
+
+void UPWPickupBurstSubsystem::ValidateDestinations(const FVector& Center, float Radius, float DefaultGroundZ, TArray<FVector>& InOutDestinations, TBitArray<>& OutValid) const
+{
+	PW_SCOPE_GAMEPLAY_TIME(Pickups);
+
+	OutValid.Init(true, InOutDestinations.Num());
+
+	//One overlap around the whole burst, from the drop height down to the ground traces of AInteractable::GetGroundPosition
+	const float MinZ = FMath::Min(static_cast<float>(Center.Z), -100.0f) - 50.0f;
+	const float MaxZ = FMath::Max(static_cast<float>(Center.Z), 100.0f) + 50.0f;
+	const FVector BoxCenter(Center.X, Center.Y, (MinZ + MaxZ) * 0.5f);
+	const FVector BoxExtent(Radius + 50.0f, Radius + 50.0f, (MaxZ - MinZ) * 0.5f);
+
+	FCollisionObjectQueryParams ObjectQueryParams(FCollisionObjectQueryParams::AllStaticObjects);
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_Destructible);
+
+	TArray<FOverlapResult> Overlaps;
+	GetWorld()->OverlapMultiByObjectType(Overlaps, BoxCenter, FQuat::Identity, ObjectQueryParams, FCollisionShape::MakeBox(BoxExtent));
+
+	TArray<UPrimitiveComponent*, TInlineAllocator<8>> FountainComponents;
+	TArray<UPrimitiveComponent*, TInlineAllocator<16>> StaticMeshComponents;
+	for(const FOverlapResult& Overlap : Overlaps)
+	{
+		UPrimitiveComponent* Component = Overlap.GetComponent();
+		const AActor* Actor = Overlap.GetActor();
+		if(Component == nullptr || Actor == nullptr)
+		{
+			continue;
+		}
+
+		if(Actor->IsA<APWFountain>())
+		{
+			FountainComponents.AddUnique(Component);
+		}
+		else if(Actor->IsA<AStaticMeshActor>())
+		{
+			StaticMeshComponents.AddUnique(Component);
+		}
+	}
+
+	//Then every destination is tested against these components only
+	const FCollisionShape PathSphere = FCollisionShape::MakeSphere(15.0f);
+	for(int32 i = 0; i < InOutDestinations.Num(); i++)
+	{
+		FVector& Destination = InOutDestinations[i];
+
+		//In the fountain, with the same margin as the box sweep of IsEndLocationInFountain
+		for(const UPrimitiveComponent* Fountain : FountainComponents)
+		{
+			const FBox FountainBox = Fountain->Bounds.GetBox();
+			if(Destination.X >= FountainBox.Min.X - 50.0f && Destination.X <= FountainBox.Max.X + 50.0f
+				&& Destination.Y >= FountainBox.Min.Y - 50.0f && Destination.Y <= FountainBox.Max.Y + 50.0f)
+			{
+				OutValid[i] = false;
+				break;
+			}
+		}
+
+		if(OutValid[i] == false)
+		{
+			Destination.Z = DefaultGroundZ + 15.0f;
+			continue;
+		}
+
+		//A prop between the drop and the destination, like IsEndLocationReachable, and the highest ground under the destination
+		float GroundZ = -UE_BIG_NUMBER;
+		for(UPrimitiveComponent* StaticMesh : StaticMeshComponents)
+		{
+			FHitResult Hit;
+			if(StaticMesh->SweepComponent(Hit, Center, FVector(Destination.X, Destination.Y, Center.Z), FQuat::Identity, PathSphere))
+			{
+				OutValid[i] = false;
+				break;
+			}
+
+			if(StaticMesh->LineTraceComponent(Hit, FVector(Destination.X, Destination.Y, 100.0f), FVector(Destination.X, Destination.Y, -100.0f), FCollisionQueryParams::DefaultQueryParam))
+			{
+				GroundZ = FMath::Max(GroundZ, static_cast<float>(Hit.ImpactPoint.Z));
+			}
+		}
+
+		//Same heights as GetGroundPosition
+		Destination.Z = GroundZ > -UE_BIG_NUMBER ? GroundZ + 65.0f : DefaultGroundZ + 15.0f;
+	}
+
+	//The navmesh test of every remaining destination in one batch
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const ANavigationData* NavData = NavSys != nullptr ? NavSys->GetDefaultNavDataInstance() : nullptr;
+	if(NavData == nullptr)
+	{
+		return;
+	}
+
+	TArray<FNavigationProjectionWork> Workload;
+	TArray<int32> WorkloadDestinations;
+	for(int32 i = 0; i < InOutDestinations.Num(); i++)
+	{
+		if(OutValid[i])
+		{
+			Workload.Emplace(InOutDestinations[i]);
+			WorkloadDestinations.Add(i);
+		}
+	}
+
+	NavData->BatchProjectPoints(Workload, FVector(50.0f, 50.0f, 200.0f));
+	for(int32 WorkIndex = 0; WorkIndex < Workload.Num(); WorkIndex++)
+	{
+		if(Workload[WorkIndex].bResult == false)
+		{
+			OutValid[WorkloadDestinations[WorkIndex]] = false;
+		}
+	}
+}
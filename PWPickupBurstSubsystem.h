@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PWPickupBurstSubsystem.generated.h"
+
+class AInteractable;
+
+/**
+ * Spawns the pickups of a big drop together instead of one by one.
+ * The destinations of the whole burst are laid out at once with a Poisson-disk distribution, so the pickups never land
+ * on each other, then validated together: one overlap gathers the fountains and the props around the burst, the points
+ * are tested against them locally, and the navmesh checks are done with one batched projection.
+ */
+UCLASS()
+class PROJECTWATER_API UPWPickupBurstSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//Spawn NumPickups pickups at the center, each one animated toward its own destination at least MinSpacing apart from the others
+	UFUNCTION(BlueprintCallable, Category="Pickups")
+	void SpawnPickupBurst(TSubclassOf<AInteractable> PickupClass, int32 NumPickups, const FVector& Center, float MinSpacing, TArray<AInteractable*>& OutPickups);
+
+	//Offsets in a disc of this radius, at least MinSpacing apart, in the order they were generated. Returns the number of offsets
+	static int32 GeneratePoissonDiskLayout(FRandomStream& RandomStream, float Radius, float MinSpacing, int32 MaxPoints, TArray<FVector2D>& OutOffsets);
+
+	//Candidates tried around each point of the layout before it is given up
+	static constexpr int32 PoissonDiskAttempts = 30;
+
+private:
+	//Put the destinations on the ground and flag the ones in the fountain, behind a prop or outside the navmesh
+	void ValidateDestinations(const FVector& Center, float Radius, float DefaultGroundZ, TArray<FVector>& InOutDestinations, TBitArray<>& OutValid) const;
+};
@@ -0,0 +1,177 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Interactor/PWPickupMagnetSubsystem.h"
+#include "Core/PWGameplayStats.h"
+#include "Interactor/Interactable.h"
+#include "Kismet/GameplayStatics.h"
+
+void UPWPickupMagnetSubsystem::Deinitialize()
+{
+	MagnetPlayers.Empty();
+	RegisteredPickups.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UPWPickupMagnetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWPickupMagnetSubsystem, STATGROUP_Tickables);
+}
+
+void UPWPickupMagnetSubsystem::SetMagnetEnabled(APawn* Player, bool bEnabled)
+{
+	if(Player == nullptr)
+	{
+		return;
+	}
+
+	if(bEnabled)
+	{
+		MagnetPlayers.AddUnique(Player);
+	}
+	else
+	{
+		MagnetPlayers.RemoveSwap(Player);
+	}
+}
+
+bool UPWPickupMagnetSubsystem::IsMagnetEnabled(const APawn* Player) const
+{
+	return MagnetPlayers.Contains(Player);
+}
+
+void UPWPickupMagnetSubsystem::RegisterPickup(AInteractable* Pickup)
+{
+	if(Pickup != nullptr)
+	{
+		RegisteredPickups.AddUnique(Pickup);
+	}
+}
+
+void UPWPickupMagnetSubsystem::UnregisterPickup(AInteractable* Pickup)
+{
+	RegisteredPickups.RemoveSwap(Pickup);
+}
+
+void UPWPickupMagnetSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	//The server moves and collects the pickups, the clients receive the result
+	if(GetWorld()->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	MagnetPlayers.RemoveAllSwap([](const TWeakObjectPtr<APawn>& Player) { return Player.IsValid() == false; });
+	if(MagnetPlayers.IsEmpty() || RegisteredPickups.IsEmpty())
+	{
+		return;
+	}
+
+	PW_SCOPE_GAMEPLAY_TIME(Pickups);
+
+	TArray<FVector, TInlineAllocator<4>> PlayerLocations;
+	for(const TWeakObjectPtr<APawn>& Player : MagnetPlayers)
+	{
+		PlayerLocations.Add(Player->GetActorLocation());
+	}
+
+	TArray<FCollectionBatch, TInlineAllocator<4>> Batches;
+	Batches.SetNum(MagnetPlayers.Num());
+
+	const float MagnetRadiusSquared = FMath::Square(MagnetRadius);
+	const float CollectDistanceSquared = FMath::Square(CollectDistance);
+	const float PullDistance = PullSpeed * DeltaTime;
+
+	//The pickups are collected after the pass, the list changes when they end play
+	TArray<AInteractable*> CollectedPickups;
+	for(const TWeakObjectPtr<AInteractable>& WeakPickup : RegisteredPickups)
+	{
+		AInteractable* Pickup = WeakPickup.Get();
+		if(Pickup == nullptr || Pickup->IsSpawnAnimationPlaying())
+		{
+			continue;
+		}
+
+		//The closest magnet player in range
+		const FVector PickupLocation = Pickup->GetActorLocation();
+		int32 ClosestPlayer = INDEX_NONE;
+		float ClosestDistanceSquared = MagnetRadiusSquared;
+		for(int32 PlayerIndex = 0; PlayerIndex < PlayerLocations.Num(); PlayerIndex++)
+		{
+			const float DistanceSquared = FVector::DistSquared(PickupLocation, PlayerLocations[PlayerIndex]);
+			if(DistanceSquared <= ClosestDistanceSquared)
+			{
+				ClosestPlayer = PlayerIndex;
+				ClosestDistanceSquared = DistanceSquared;
+			}
+		}
+
+		if(ClosestPlayer == INDEX_NONE)
+		{
+			continue;
+		}
+
+		if(ClosestDistanceSquared > CollectDistanceSquared)
+		{
+			//Pulled toward the player, collected on a later frame
+			const FVector ToPlayer = PlayerLocations[ClosestPlayer] - PickupLocation;
+			Pickup->MoveRestingPickup(PickupLocation + ToPlayer.GetClampedToMaxSize(PullDistance));
+			continue;
+		}
+
+		FCollectionBatch& Batch = Batches[ClosestPlayer];
+		Batch.AmountPerId.FindOrAdd(Pickup->GetInteractableId()) += Pickup->GetAmount();
+		if(Batch.TakeSound == nullptr)
+		{
+			Batch.TakeSound = Pickup->TakeSound;
+		}
+		CollectedPickups.Add(Pickup);
+	}
+
+	//Without anything bound to give the batches, the pickups are taken one by one like by the player
+	if(OnPickupsCollected.IsBound() == false)
+	{
+		for(AInteractable* Pickup : CollectedPickups)
+		{
+			//Taken once, even if its Interact keeps it in the world
+			UnregisterPickup(Pickup);
+			Pickup->Interact();
+		}
+		return;
+	}
+
+	for(AInteractable* Pickup : CollectedPickups)
+	{
+		Pickup->Destroy();
+	}
+
+	for(int32 PlayerIndex = 0; PlayerIndex < Batches.Num(); PlayerIndex++)
+	{
+		if(Batches[PlayerIndex].AmountPerId.Num() > 0)
+		{
+			CollectBatch(MagnetPlayers[PlayerIndex].Get(), Batches[PlayerIndex]);
+		}
+	}
+}
+
+void UPWPickupMagnetSubsystem::CollectBatch(APawn* Player, const FCollectionBatch& Batch)
+{
+	TArray<FPWCollectedPickup> CollectedPickups;
+	CollectedPickups.Reserve(Batch.AmountPerId.Num());
+	for(const TPair<int32, int32>& Collected : Batch.AmountPerId)
+	{
+		FPWCollectedPickup& CollectedPickup = CollectedPickups.AddDefaulted_GetRef();
+		CollectedPickup.InteractableId = Collected.Key;
+		CollectedPickup.Amount = Collected.Value;
+	}
+
+	//One sound for the whole batch instead of one per pickup
+	if(Batch.TakeSound != nullptr)
+	{
+		UGameplayStatics::PlaySoundAtLocation(this, Batch.TakeSound, Player->GetActorLocation());
+	}
+
+	OnPickupsCollected.Broadcast(Player, CollectedPickups);
+}
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PWPickupMagnetSubsystem.generated.h"
+
+class AInteractable;
+class USoundBase;
+
+//Total amount of one kind of pickup collected in a batch
+USTRUCT(BlueprintType)
+struct FPWCollectedPickup
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 InteractableId = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Amount = 0;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnPickupsCollected, APawn*, Collector, const TArray<FPWCollectedPickup>&, CollectedPickups);
+
+/**
+ * Auto-collection of the pickups around the players that have the magnet, the drops and the ones placed in the level.
+ * One pass per frame pulls the resting pickups within MagnetRadius toward their closest magnet player, and the ones that
+ * reach the player are collected together. When OnPickupsCollected is bound, the amounts are summed per InteractableId,
+ * given in one call with a single TakeSound for the whole batch, and the pickups are destroyed without Interact.
+ * Else each pickup is collected through Interact like when the player takes it, so nothing is lost.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWPickupMagnetSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Give or remove the magnet of a player
+	UFUNCTION(BlueprintCallable, Category="Pickups")
+	void SetMagnetEnabled(APawn* Player, bool bEnabled);
+
+	UFUNCTION(BlueprintPure, Category="Pickups")
+	bool IsMagnetEnabled(const APawn* Player) const;
+
+	//Called by every pickup when it begins and ends play
+	void RegisterPickup(AInteractable* Pickup);
+	void UnregisterPickup(AInteractable* Pickup);
+
+	//Called once per frame for each player that collected pickups, the pickups go through Interact while nothing is bound
+	UPROPERTY(BlueprintAssignable, Category="Pickups")
+	FOnPickupsCollected OnPickupsCollected;
+
+	//The resting pickups closer than this to a magnet player are pulled
+	UPROPERTY(Config)
+	float MagnetRadius = 600.0f;
+
+	//Speed of the pulled pickups
+	UPROPERTY(Config)
+	float PullSpeed = 1200.0f;
+
+	//The pulled pickups closer than this to their player are collected
+	UPROPERTY(Config)
+	float CollectDistance = 80.0f;
+
+private:
+	//Amounts collected by one player this frame
+	struct FCollectionBatch
+	{
+		TMap<int32, int32> AmountPerId;
+		USoundBase* TakeSound = nullptr;
+	};
+
+	void CollectBatch(APawn* Player, const FCollectionBatch& Batch);
+
+	TArray<TWeakObjectPtr<APawn>> MagnetPlayers;
+
+	UPROPERTY()
+	TArray<TWeakObjectPtr<AInteractable>> RegisteredPickups;
+};
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Interactor/PWPickupMergeSubsystem.h"
+#include "Core/PWGameplayStats.h"
+#include "Interactor/Interactable.h"
+
+void UPWPickupMergeSubsystem::Deinitialize()
+{
+	RegisteredPickups.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UPWPickupMergeSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWPickupMergeSubsystem, STATGROUP_Tickables);
+}
+
+void UPWPickupMergeSubsystem::RegisterPickup(AInteractable* Pickup)
+{
+	if(Pickup != nullptr)
+	{
+		RegisteredPickups.AddUnique(Pickup);
+	}
+}
+
+void UPWPickupMergeSubsystem::UnregisterPickup(AInteractable* Pickup)
+{
+	RegisteredPickups.RemoveSwap(Pickup);
+}
+
+void UPWPickupMergeSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SecondsSinceLastMerge += DeltaTime;
+	if(SecondsSinceLastMerge < MergeInterval || RegisteredPickups.Num() < 2)
+	{
+		return;
+	}
+
+	SecondsSinceLastMerge = 0.0f;
+	MergeRestingPickups();
+}
+
+int32 UPWPickupMergeSubsystem::MergeRestingPickups()
+{
+	//The server destroys and replicates the merged pickups, the clients never merge theirs
+	if(GetWorld()->GetNetMode() == NM_Client)
+	{
+		return 0;
+	}
+
+	PW_SCOPE_GAMEPLAY_TIME(Pickups);
+	LLM_SCOPE_BYTAG(PWPickups);
+
+	RegisteredPickups.RemoveAllSwap([](const TWeakObjectPtr<AInteractable>& Pickup) { return Pickup.IsValid() == false; });
+
+	//The pickups still flying toward their destination are merged once they land
+	struct FMergeCandidate
+	{
+		AInteractable* Pickup;
+		float DestroyTimeRemaining;
+	};
+	TArray<FMergeCandidate> Candidates;
+	Candidates.Reserve(RegisteredPickups.Num());
+	for(const TWeakObjectPtr<AInteractable>& Pickup : RegisteredPickups)
+	{
+		if(Pickup->IsSpawnAnimationPlaying() == false)
+		{
+			const float DestroyTimeRemaining = Pickup->GetDestroyTimeRemaining();
+			Candidates.Add({Pickup.Get(), DestroyTimeRemaining < 0.0f ? TNumericLimits<float>::Max() : DestroyTimeRemaining});
+		}
+	}
+
+	if(Candidates.Num() < 2)
+	{
+		return 0;
+	}
+
+	//The longest countdowns first, every pickup is then merged into a kept one that lasts at least as long
+	Candidates.Sort([](const FMergeCandidate& A, const FMergeCandidate& B) { return A.DestroyTimeRemaining > B.DestroyTimeRemaining; });
+
+	//Kept pickups by cell of MergeRadius, a pickup only looks for them in its cell and the 8 around
+	const float CellSize = FMath::Max(MergeRadius, 1.0f);
+	const float MergeRadiusSquared = FMath::Square(MergeRadius);
+	TMap<FIntPoint, TArray<AInteractable*, TInlineAllocator<4>>> KeptPickupsByCell;
+
+	int32 NumMerged = 0;
+	for(const FMergeCandidate& Candidate : Candidates)
+	{
+		AInteractable* Pickup = Candidate.Pickup;
+		const FVector Location = Pickup->GetActorLocation();
+		const FIntPoint Cell(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+
+		AInteractable* Stack = nullptr;
+		for(int32 Y = Cell.Y - 1; Y <= Cell.Y + 1 && Stack == nullptr; Y++)
+		{
+			for(int32 X = Cell.X - 1; X <= Cell.X + 1 && Stack == nullptr; X++)
+			{
+				const TArray<AInteractable*, TInlineAllocator<4>>* KeptPickups = KeptPickupsByCell.Find(FIntPoint(X, Y));
+				if(KeptPickups == nullptr)
+				{
+					continue;
+				}
+
+				for(AInteractable* KeptPickup : *KeptPickups)
+				{
+					if(KeptPickup->GetClass() == Pickup->GetClass() && KeptPickup->GetInteractableId() == Pickup->GetInteractableId()
+						&& FVector::DistSquared(KeptPickup->GetActorLocation(), Location) <= MergeRadiusSquared)
+					{
+						Stack = KeptPickup;
+						break;
+					}
+				}
+			}
+		}
+
+		if(Stack == nullptr)
+		{
+			KeptPickupsByCell.FindOrAdd(Cell).Add(Pickup);
+			continue;
+		}
+
+		//Taking the stack gives the player the summed amount, with the same interaction and sound as one pickup
+		Stack->AddAmount(Pickup->GetAmount());
+		Pickup->Destroy();
+		++NumMerged;
+	}
+
+	INC_DWORD_STAT_BY(STAT_PWPickupsMerged, NumMerged);
+	return NumMerged;
+}
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PWPickupMergeSubsystem.generated.h"
+
+class AInteractable;
+
+/**
+ * Keeps the number of dropped pickups bounded during the long nights.
+ * A few times per second, the resting drops of the same class and InteractableId closer than MergeRadius are merged
+ * into one of them, which gets the summed amount. The kept pickup is the one with the longest destroy countdown,
+ * so a stack never disappears sooner than the drops it absorbed. The pickups placed in the level are never merged.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWPickupMergeSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Called by the dropped pickups when they begin and end play
+	void RegisterPickup(AInteractable* Pickup);
+	void UnregisterPickup(AInteractable* Pickup);
+
+	int32 GetNumRegisteredPickups() const { return RegisteredPickups.Num(); }
+
+	//Every dropped pickup, destroyed ones included until the next merge pass
+	const TArray<TWeakObjectPtr<AInteractable>>& GetRegisteredPickups() const { return RegisteredPickups; }
+
+	SIZE_T GetAllocatedSize() const { return RegisteredPickups.GetAllocatedSize(); }
+
+	//Merge the resting pickups now, returns the number of pickups destroyed. Does nothing on the clients
+	int32 MergeRestingPickups();
+
+	//Resting pickups of the same kind closer than this are merged
+	UPROPERTY(Config)
+	float MergeRadius = 100.0f;
+
+	//Seconds between two merge passes
+	UPROPERTY(Config)
+	float MergeInterval = 0.5f;
+
+private:
+	UPROPERTY()
+	TArray<TWeakObjectPtr<AInteractable>> RegisteredPickups;
+
+	float SecondsSinceLastMerge = 0.0f;
+};
@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Characters/Player/PWPlayerRocketStateComponent.h"
+#include "Characters/Player/PWPlayerCharacter.h"
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+UPWPlayerRocketStateComponent::UPWPlayerRocketStateComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+UPWPlayerRocketStateComponent* UPWPlayerRocketStateComponent::FindRocketState(const AActor* Player)
+{
+	return Player != nullptr ? Player->FindComponentByClass<UPWPlayerRocketStateComponent>() : nullptr;
+}
+
+void UPWPlayerRocketStateComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>();
+	if(GravityZoneSubsystem == nullptr)
+	{
+		return;
+	}
+
+	//The rockets spawned before the player
+	for(const FPWGravityZoneInfo& Zone : GravityZoneSubsystem->GetActiveZones())
+	{
+		HandleZoneAdded(Zone);
+	}
+
+	ZoneAddedHandle = GravityZoneSubsystem->OnZoneAdded.AddUObject(this, &UPWPlayerRocketStateComponent::HandleZoneAdded);
+	ZoneRemovedHandle = GravityZoneSubsystem->OnZoneRemoved.AddUObject(this, &UPWPlayerRocketStateComponent::HandleZoneRemoved);
+}
+
+void UPWPlayerRocketStateComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		GravityZoneSubsystem->OnZoneAdded.Remove(ZoneAddedHandle);
+		GravityZoneSubsystem->OnZoneRemoved.Remove(ZoneRemovedHandle);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UPWPlayerRocketStateComponent::HandleZoneAdded(const FPWGravityZoneInfo& Zone)
+{
+	++NumActiveRockets;
+
+	//The rockets without moon jump don't change the jump of the player
+	bool bJumpChanged = false;
+	if(Zone.bGivesPlayerMoonJump == true)
+	{
+		MoonJumpZones.Add(Zone.ZoneId, {Zone.PlayerMoonJumpZVelocity, Zone.PlayerMoonJumpGravityScale});
+		bJumpChanged = UpdateMoonJump();
+	}
+
+	OnRocketsChanged(bJumpChanged);
+}
+
+void UPWPlayerRocketStateComponent::HandleZoneRemoved(const FPWGravityZoneInfo& Zone)
+{
+	NumActiveRockets = FMath::Max(0, NumActiveRockets - 1);
+
+	const bool bJumpChanged = MoonJumpZones.Remove(Zone.ZoneId) > 0 && UpdateMoonJump();
+
+	OnRocketsChanged(bJumpChanged);
+}
+
+bool UPWPlayerRocketStateComponent::UpdateMoonJump()
+{
+	const bool bCouldMoonJump = bHasAppliedMoonJump;
+	const float OldZVelocity = MoonJumpZVelocity;
+	const float OldGravityScale = MoonJumpGravityScale;
+
+	//Several rockets can give the moon jump at once, the highest jump wins whatever the order they appeared in
+	MoonJumpZVelocity = 0.0f;
+	MoonJumpGravityScale = 1.0f;
+	for(const TPair<int32, FMoonJumpSettings>& MoonJumpZone : MoonJumpZones)
+	{
+		if(MoonJumpZone.Value.ZVelocity > MoonJumpZVelocity)
+		{
+			MoonJumpZVelocity = MoonJumpZone.Value.ZVelocity;
+			MoonJumpGravityScale = MoonJumpZone.Value.GravityScale;
+		}
+	}
+
+	bHasAppliedMoonJump = CanMoonJump();
+	if(bHasAppliedMoonJump != bCouldMoonJump)
+	{
+		return true;
+	}
+
+	return bHasAppliedMoonJump == true && (OldZVelocity != MoonJumpZVelocity || OldGravityScale != MoonJumpGravityScale);
+}
+
+void UPWPlayerRocketStateComponent::OnRocketsChanged(bool bJumpChanged)
+{
+	APWPlayerCharacter* Player = Cast<APWPlayerCharacter>(GetOwner());
+	if(Player == nullptr)
+	{
+		return;
+	}
+
+	//the old counter is still read by the blueprints of the player
+	Player->setNumberOfRocket(NumActiveRockets);
+
+	if(bJumpChanged == true)
+	{
+		RefreshJump();
+	}
+
+	OnRocketStateChanged.Broadcast(NumActiveRockets);
+}
+
+void UPWPlayerRocketStateComponent::RefreshJump() const
+{
+	//While the player floats, the gravity zone owns his movement, the jump is refreshed when he leaves it
+	const APWPlayerCharacter* Player = Cast<APWPlayerCharacter>(GetOwner());
+	if(Player != nullptr && Player->bIsPlayerFlyingInGravityZone == false)
+	{
+		ApplyJumpSettings();
+	}
+}
+
+void UPWPlayerRocketStateComponent::ApplyJumpSettings() const
+{
+	const ACharacter* Player = Cast<ACharacter>(GetOwner());
+	UCharacterMovementComponent* MovementComponent = Player != nullptr ? Player->GetCharacterMovement() : nullptr;
+	if(MovementComponent == nullptr)
+	{
+		return;
+	}
+
+	if(CanMoonJump() == true)
+	{
+		MovementComponent->JumpZVelocity = MoonJumpZVelocity;
+		MovementComponent->GravityScale = MoonJumpGravityScale;
+	}
+	else
+	{
+		MovementComponent->JumpZVelocity = NormalJumpZVelocity;
+		MovementComponent->GravityScale = NormalGravityScale;
+	}
+}
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PWPlayerRocketStateComponent.generated.h"
+
+struct FPWGravityZoneInfo;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPlayerRocketStateChanged, int32, NumActiveRockets);
+
+/**
+ * Rocket state of one player: the active rockets and if the player can moon jump.
+ * Added once to every player by UPWGravityZoneSubsystem and updated by the zone events, so it works the same
+ * for every local (split-screen) or remote player.
+ */
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+class PROJECTWATER_API UPWPlayerRocketStateComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPWPlayerRocketStateComponent();
+
+	//Rocket state of a player, nullptr if the actor doesn't have one
+	static UPWPlayerRocketStateComponent* FindRocketState(const AActor* Player);
+
+	UFUNCTION(BlueprintPure, Category="Rocket")
+	int32 GetNumActiveRockets() const { return NumActiveRockets; }
+
+	//True as long as one active rocket gives the moon jump
+	UFUNCTION(BlueprintPure, Category="Rocket")
+	bool CanMoonJump() const { return MoonJumpZones.Num() > 0; }
+
+	//Give the player the moon jump if a rocket allows it, the normal jump otherwise
+	UFUNCTION(BlueprintCallable, Category="Rocket")
+	void ApplyJumpSettings() const;
+
+	//Gravity scale the player has out of any gravity zone, with or without the moon jump
+	float GetBaseGravityScale() const { return CanMoonJump() ? MoonJumpGravityScale : NormalGravityScale; }
+
+	//Same as ApplyJumpSettings, but leaves the player alone while he floats in a gravity zone
+	UFUNCTION(BlueprintCallable, Category="Rocket")
+	void RefreshJump() const;
+
+	//Broadcasted when a rocket of the player appears or is launched
+	UPROPERTY(BlueprintAssignable, Category="Rocket")
+	FOnPlayerRocketStateChanged OnRocketStateChanged;
+
+	//Jump of the player without any rocket
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rocket")
+	float NormalJumpZVelocity = 420.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rocket")
+	float NormalGravityScale = 1.0f;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	void HandleZoneAdded(const FPWGravityZoneInfo& Zone);
+	void HandleZoneRemoved(const FPWGravityZoneInfo& Zone);
+
+	//Keep the counter of the player character up to date, and refresh the jump only when it changed
+	void OnRocketsChanged(bool bJumpChanged);
+
+	//Take the highest moon jump of the remaining zones, return true if the jump of the player changes
+	bool UpdateMoonJump();
+
+	UPROPERTY()
+	int32 NumActiveRockets = 0;
+
+	struct FMoonJumpSettings
+	{
+		float ZVelocity = 0.0f;
+		float GravityScale = 1.0f;
+	};
+
+	//Moon jump of each active rocket zone that gives it
+	TMap<int32, FMoonJumpSettings> MoonJumpZones;
+
+	//Moon jump currently given to the player, the highest of MoonJumpZones
+	float MoonJumpZVelocity = 0.0f;
+	float MoonJumpGravityScale = 1.0f;
+
+	//If the settings above were last computed with at least one moon jump zone
+	bool bHasAppliedMoonJump = false;
+
+	FDelegateHandle ZoneAddedHandle;
+	FDelegateHandle ZoneRemovedHandle;
+};
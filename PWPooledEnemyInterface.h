@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "PWPooledEnemyInterface.generated.h"
+
+UINTERFACE(MinimalAPI, Blueprintable)
+class UPWPooledEnemyInterface : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Implemented by the enemies, or their blueprints, that keep state for one life only.
+ * UPWEnemyPoolSubsystem resets the movement, the gravity zone state and the behavior tree itself,
+ * the rest (health, hit reactions, loot flags...) is reset by the enemy in OnAcquiredFromPool.
+ */
+class PROJECTWATER_API IPWPooledEnemyInterface
+{
+	GENERATED_BODY()
+
+public:
+	//Called when the enemy leaves the pool for a new life, before its behavior tree restarts
+	UFUNCTION(BlueprintNativeEvent, Category="Enemy Pool")
+	void OnAcquiredFromPool();
+	virtual void OnAcquiredFromPool_Implementation() {}
+};
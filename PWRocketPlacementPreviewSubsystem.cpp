@@ -0,0 +1,373 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Creator/Items/CreationItems/PWRocketPlacementPreviewSubsystem.h"
+#include "EngineUtils.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "Characters/Enemies/PWEnemyPoolSubsystem.h"
+#include "Characters/Player/PWPlayerCharacter.h"
+#include "Core/PWGameplayStats.h"
+#include "Creator/Items/CreationItems/PW_RocketCreation.h"
+
+void UPWRocketPlacementPreviewSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UPWRocketPlacementPreviewSubsystem::OnActorSpawned));
+}
+
+void UPWRocketPlacementPreviewSubsystem::Deinitialize()
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	IndexedPawns.Empty();
+	Cells.Empty();
+	Candidates.Empty();
+	PreviewPawns.Empty();
+
+	Super::Deinitialize();
+}
+
+void UPWRocketPlacementPreviewSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//The pawns placed in the level
+	for(TActorIterator<APawn> It(&InWorld); It; ++It)
+	{
+		RegisterPawn(*It);
+	}
+}
+
+TStatId UPWRocketPlacementPreviewSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWRocketPlacementPreviewSubsystem, STATGROUP_Tickables);
+}
+
+void UPWRocketPlacementPreviewSubsystem::OnActorSpawned(AActor* SpawnedActor)
+{
+	RegisterPawn(SpawnedActor);
+}
+
+void UPWRocketPlacementPreviewSubsystem::RegisterPawn(AActor* Actor)
+{
+	if(Actor->IsA<APWEnemyCharacter>() == false && Actor->IsA<APWPlayerCharacter>() == false)
+	{
+		return;
+	}
+
+	//The pawns spawned before the world begins play are found twice
+	if(IndexedPawns.ContainsByPredicate([Actor](const FIndexedPawn& IndexedPawn) { return IndexedPawn.Pawn == Actor; }))
+	{
+		return;
+	}
+
+	APawn* Pawn = CastChecked<APawn>(Actor);
+	const FIntPoint Cell = GetCell(Actor->GetActorLocation());
+	Cells.FindOrAdd(Cell).Add(IndexedPawns.Num());
+	IndexedPawns.Add({Pawn, Cell});
+
+	//A pawn spawned in the previewed cells, like an enemy of a wave
+	OnPawnCellChanged(Pawn, FIntPoint(MAX_int32, MAX_int32), Cell);
+}
+
+FIntPoint UPWRocketPlacementPreviewSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+bool UPWRocketPlacementPreviewSubsystem::IsCellGathered(const FIntPoint& Cell) const
+{
+	return Cell.X >= GatheredMinCell.X && Cell.X <= GatheredMaxCell.X && Cell.Y >= GatheredMinCell.Y && Cell.Y <= GatheredMaxCell.Y;
+}
+
+void UPWRocketPlacementPreviewSubsystem::OnPawnCellChanged(APawn* Pawn, const FIntPoint& OldCell, const FIntPoint& NewCell)
+{
+	//Everything is gathered again anyway
+	if(PreviewRocketClass == nullptr || bCandidatesDirty)
+	{
+		return;
+	}
+
+	const bool bWasGathered = IsCellGathered(OldCell);
+	const bool bIsGathered = IsCellGathered(NewCell);
+	if(bIsGathered && bWasGathered == false)
+	{
+		Candidates.Add(Pawn);
+	}
+	else if(bWasGathered && bIsGathered == false)
+	{
+		//Out of the previewed cells, it can't be in the zone anymore
+		Candidates.RemoveSingleSwap(Pawn);
+		SetPawnInPreview(Pawn, false);
+	}
+}
+
+void UPWRocketPlacementPreviewSubsystem::BeginPreview(TSubclassOf<APW_RocketCreation> RocketClass)
+{
+	EndPreview();
+	if(RocketClass == nullptr)
+	{
+		return;
+	}
+
+	PreviewRocketClass = RocketClass;
+
+	//The zone follows the collision sphere, wherever it is attached in the rocket
+	const APW_RocketCreation* DefaultRocket = RocketClass->GetDefaultObject<APW_RocketCreation>();
+	ZoneRelativeTransform = FTransform::Identity;
+	for(const USceneComponent* Component = DefaultRocket->CollisionSphere; Component != nullptr && Component != DefaultRocket->GetRootComponent(); Component = Component->GetAttachParent())
+	{
+		ZoneRelativeTransform = ZoneRelativeTransform * Component->GetRelativeTransform();
+	}
+}
+
+void UPWRocketPlacementPreviewSubsystem::UpdatePreview(const FVector& Location, const FRotator& Rotation)
+{
+	if(PreviewRocketClass == nullptr)
+	{
+		return;
+	}
+
+	//Same shape as APW_RocketCreation::GetZoneShape for a rocket spawned here
+	const APW_RocketCreation* DefaultRocket = PreviewRocketClass->GetDefaultObject<APW_RocketCreation>();
+	const FTransform ZoneTransform = ZoneRelativeTransform * FTransform(Rotation, Location);
+	const FVector Scale = ZoneTransform.GetScale3D().GetAbs();
+
+	PreviewShape.Type = DefaultRocket->ZoneShape;
+	PreviewShape.Center = ZoneTransform.GetLocation();
+	PreviewShape.Rotation = ZoneTransform.GetRotation();
+	PreviewShape.Radius = DefaultRocket->ZoneShape == EPWGravityZoneShapeType::Sphere ? DefaultRocket->CollisionSphere->GetUnscaledSphereRadius() * Scale.GetMin() : DefaultRocket->ZoneShapeRadius * FMath::Min(Scale.X, Scale.Y);
+	PreviewShape.HalfHeight = DefaultRocket->ZoneShapeHalfHeight * Scale.Z;
+	PreviewShape.BoxExtent = DefaultRocket->ZoneBoxExtent * Scale;
+
+	//While the zone stays over the same cells, the candidates are kept and only tested against the new shape
+	const float GatherRadius = PreviewShape.GetBoundingRadius() + IndexSlack;
+	const FIntPoint MinCell = GetCell(PreviewShape.Center - FVector(GatherRadius, GatherRadius, 0.0f));
+	const FIntPoint MaxCell = GetCell(PreviewShape.Center + FVector(GatherRadius, GatherRadius, 0.0f));
+	if(MinCell != GatheredMinCell || MaxCell != GatheredMaxCell)
+	{
+		GatheredMinCell = MinCell;
+		GatheredMaxCell = MaxCell;
+		bCandidatesDirty = true;
+	}
+}
+
+void UPWRocketPlacementPreviewSubsystem::EndPreview()
+{
+	//Let the highlighted pawns be cleared
+	TArray<TWeakObjectPtr<APawn>> PawnsToClear = PreviewPawns.Array();
+	for(const TWeakObjectPtr<APawn>& Pawn : PawnsToClear)
+	{
+		SetPawnInPreview(Pawn.Get(), false);
+	}
+
+	PreviewRocketClass = nullptr;
+	PreviewPawns.Reset();
+	Candidates.Reset();
+	NextCandidateTest = 0;
+	GatheredMinCell = FIntPoint(MAX_int32, MAX_int32);
+	GatheredMaxCell = FIntPoint(MIN_int32, MIN_int32);
+	bCandidatesDirty = false;
+}
+
+void UPWRocketPlacementPreviewSubsystem::GetPreviewEnemies(TArray<APWEnemyCharacter*>& OutEnemies) const
+{
+	OutEnemies.Reset();
+	for(const TWeakObjectPtr<APawn>& Pawn : PreviewPawns)
+	{
+		if(APWEnemyCharacter* Enemy = Cast<APWEnemyCharacter>(Pawn.Get()))
+		{
+			OutEnemies.Add(Enemy);
+		}
+	}
+}
+
+bool UPWRocketPlacementPreviewSubsystem::IsPlayerInPreview() const
+{
+	for(const TWeakObjectPtr<APawn>& Pawn : PreviewPawns)
+	{
+		if(Pawn.IsValid() && Pawn->IsA<APWPlayerCharacter>())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void UPWRocketPlacementPreviewSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if(IndexedPawns.IsEmpty())
+	{
+		return;
+	}
+
+	PW_SCOPE_GAMEPLAY_TIME(PlacementPreview);
+
+	UpdateIndex();
+
+	if(PreviewRocketClass != nullptr)
+	{
+		if(bCandidatesDirty)
+		{
+			GatherCandidates();
+		}
+
+		TestCandidates();
+	}
+}
+
+void UPWRocketPlacementPreviewSubsystem::UpdateIndex()
+{
+	const int32 NumUpdates = FMath::Min(MaxIndexUpdatesPerFrame, IndexedPawns.Num());
+	for(int32 UpdateCount = 0; UpdateCount < NumUpdates && IndexedPawns.Num() > 0; UpdateCount++)
+	{
+		if(NextIndexUpdate >= IndexedPawns.Num())
+		{
+			NextIndexUpdate = 0;
+		}
+
+		FIndexedPawn& IndexedPawn = IndexedPawns[NextIndexUpdate];
+		const APawn* Pawn = IndexedPawn.Pawn.Get();
+		if(Pawn == nullptr)
+		{
+			//The last pawn takes this slot and is refreshed on the next update
+			RemoveIndexedPawn(NextIndexUpdate);
+			continue;
+		}
+
+		const FIntPoint Cell = GetCell(Pawn->GetActorLocation());
+		if(Cell != IndexedPawn.Cell)
+		{
+			if(TArray<int32>* OldCell = Cells.Find(IndexedPawn.Cell))
+			{
+				OldCell->RemoveSwap(NextIndexUpdate);
+			}
+			Cells.FindOrAdd(Cell).Add(NextIndexUpdate);
+
+			const FIntPoint PreviousCell = IndexedPawn.Cell;
+			IndexedPawn.Cell = Cell;
+			OnPawnCellChanged(IndexedPawn.Pawn.Get(), PreviousCell, Cell);
+		}
+
+		++NextIndexUpdate;
+	}
+}
+
+void UPWRocketPlacementPreviewSubsystem::RemoveIndexedPawn(int32 PawnIndex)
+{
+	if(TArray<int32>* Cell = Cells.Find(IndexedPawns[PawnIndex].Cell))
+	{
+		Cell->RemoveSwap(PawnIndex);
+	}
+
+	//The last pawn moves to the removed slot, its cell is told of its new index
+	const int32 LastIndex = IndexedPawns.Num() - 1;
+	if(PawnIndex != LastIndex)
+	{
+		if(TArray<int32>* LastCell = Cells.Find(IndexedPawns[LastIndex].Cell))
+		{
+			const int32 Slot = LastCell->Find(LastIndex);
+			if(Slot != INDEX_NONE)
+			{
+				(*LastCell)[Slot] = PawnIndex;
+			}
+		}
+	}
+
+	IndexedPawns.RemoveAtSwap(PawnIndex);
+}
+
+void UPWRocketPlacementPreviewSubsystem::GatherCandidates()
+{
+	bCandidatesDirty = false;
+	Candidates.Reset();
+	NextCandidateTest = 0;
+
+	for(int32 Y = GatheredMinCell.Y; Y <= GatheredMaxCell.Y; Y++)
+	{
+		for(int32 X = GatheredMinCell.X; X <= GatheredMaxCell.X; X++)
+		{
+			if(const TArray<int32>* Cell = Cells.Find(FIntPoint(X, Y)))
+			{
+				for(const int32 PawnIndex : *Cell)
+				{
+					Candidates.Add(IndexedPawns[PawnIndex].Pawn);
+				}
+			}
+		}
+	}
+
+	//The previewed pawns out of the new cells can't be in the zone anymore
+	TArray<TWeakObjectPtr<APawn>> PawnsToClear;
+	for(const TWeakObjectPtr<APawn>& Pawn : PreviewPawns)
+	{
+		if(Candidates.Contains(Pawn) == false)
+		{
+			PawnsToClear.Add(Pawn);
+		}
+	}
+
+	for(const TWeakObjectPtr<APawn>& Pawn : PawnsToClear)
+	{
+		SetPawnInPreview(Pawn.Get(), false);
+		PreviewPawns.Remove(Pawn);
+	}
+}
+
+void UPWRocketPlacementPreviewSubsystem::TestCandidates()
+{
+	//The candidates are tested in turn, the whole set is refreshed every few frames even when the zone doesn't move
+	const int32 NumTests = FMath::Min(MaxPreviewTestsPerFrame, Candidates.Num());
+	for(int32 TestIndex = 0; TestIndex < NumTests; TestIndex++)
+	{
+		if(NextCandidateTest >= Candidates.Num())
+		{
+			NextCandidateTest = 0;
+		}
+
+		APawn* Pawn = Candidates[NextCandidateTest++].Get();
+		if(Pawn != nullptr)
+		{
+			SetPawnInPreview(Pawn, CanPreviewAffect(Pawn) && PreviewShape.Contains(Pawn->GetActorLocation()));
+		}
+	}
+}
+
+void UPWRocketPlacementPreviewSubsystem::SetPawnInPreview(APawn* Pawn, bool bInsideZone)
+{
+	if(Pawn == nullptr)
+	{
+		return;
+	}
+
+	if(bInsideZone)
+	{
+		bool bAlreadyInside = false;
+		PreviewPawns.Add(Pawn, &bAlreadyInside);
+		if(bAlreadyInside == false)
+		{
+			OnPreviewPawnChanged.Broadcast(Pawn, true);
+		}
+	}
+	else if(PreviewPawns.Remove(Pawn) > 0)
+	{
+		OnPreviewPawnChanged.Broadcast(Pawn, false);
+	}
+}
+
+bool UPWRocketPlacementPreviewSubsystem::CanPreviewAffect(const APawn* Pawn) const
+{
+	//The pooled enemies are still in the world, hidden
+	if(const APWEnemyCharacter* Enemy = Cast<APWEnemyCharacter>(Pawn))
+	{
+		const UPWEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UPWEnemyPoolSubsystem>();
+		if(EnemyPool != nullptr && EnemyPool->IsPooled(Enemy))
+		{
+			return false;
+		}
+	}
+
+	return PreviewRocketClass->GetDefaultObject<APW_RocketCreation>()->CanAffectActor(Pawn);
+}
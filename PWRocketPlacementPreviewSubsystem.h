@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Creator/Items/CreationItems/PWGravityZoneShape.h"
+#include "PWRocketPlacementPreviewSubsystem.generated.h"
+
+class APW_RocketCreation;
+class APWEnemyCharacter;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnRocketPreviewPawnChanged, APawn*, Pawn, bool, bInsideZone);
+
+/**
+ * Shows which pawns a rocket would lift before it is crafted, without any physics query.
+ * The enemies and the players are kept in a grid of their positions, refreshed a few pawns per frame. While a preview
+ * is active, only the pawns of the cells around the candidate zone are tested against its shape and filter, a fixed
+ * number per frame, and the pawns entering or leaving the previewed zone are reported as they are found.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWRocketPlacementPreviewSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Start previewing the zone of this rocket class, its shape and filter are read from its defaults
+	UFUNCTION(BlueprintCallable, Category="Rocket|Preview")
+	void BeginPreview(TSubclassOf<APW_RocketCreation> RocketClass);
+
+	//Move the previewed zone, the pawns are tested over the next frames
+	UFUNCTION(BlueprintCallable, Category="Rocket|Preview")
+	void UpdatePreview(const FVector& Location, const FRotator& Rotation);
+
+	UFUNCTION(BlueprintCallable, Category="Rocket|Preview")
+	void EndPreview();
+
+	UFUNCTION(BlueprintPure, Category="Rocket|Preview")
+	bool IsPreviewing() const { return PreviewRocketClass != nullptr; }
+
+	//The enemies that the previewed zone would lift
+	UFUNCTION(BlueprintCallable, Category="Rocket|Preview")
+	void GetPreviewEnemies(TArray<APWEnemyCharacter*>& OutEnemies) const;
+
+	//True if a player would float in the previewed zone
+	UFUNCTION(BlueprintPure, Category="Rocket|Preview")
+	bool IsPlayerInPreview() const;
+
+	//Called when a pawn enters or leaves the previewed zone, to highlight it
+	UPROPERTY(BlueprintAssignable, Category="Rocket|Preview")
+	FOnRocketPreviewPawnChanged OnPreviewPawnChanged;
+
+	//Size of the cells of the pawn grid
+	UPROPERTY(Config)
+	float CellSize = 500.0f;
+
+	//Pawns moved to their current cell each frame
+	UPROPERTY(Config)
+	int32 MaxIndexUpdatesPerFrame = 64;
+
+	//Pawns tested against the previewed zone each frame
+	UPROPERTY(Config)
+	int32 MaxPreviewTestsPerFrame = 64;
+
+	//Extra distance around the zone when its cells are gathered, for the pawns that moved since their cell was refreshed
+	UPROPERTY(Config)
+	float IndexSlack = 200.0f;
+
+private:
+	struct FIndexedPawn
+	{
+		TWeakObjectPtr<APawn> Pawn;
+		FIntPoint Cell;
+	};
+
+	void OnActorSpawned(AActor* SpawnedActor);
+	void RegisterPawn(AActor* Actor);
+
+	FIntPoint GetCell(const FVector& Location) const;
+
+	//True if the candidates of the preview were gathered from this cell
+	bool IsCellGathered(const FIntPoint& Cell) const;
+
+	//Keep the candidates up to date when a pawn changes of cell, without gathering them all again
+	void OnPawnCellChanged(APawn* Pawn, const FIntPoint& OldCell, const FIntPoint& NewCell);
+
+	//Move a few pawns to their current cell and forget the destroyed ones
+	void UpdateIndex();
+	void RemoveIndexedPawn(int32 PawnIndex);
+
+	//Gather the pawns of the cells around the previewed zone, and drop the previewed pawns that are not there anymore
+	void GatherCandidates();
+
+	//Test a few candidates against the previewed zone
+	void TestCandidates();
+
+	void SetPawnInPreview(APawn* Pawn, bool bInsideZone);
+
+	bool CanPreviewAffect(const APawn* Pawn) const;
+
+	TArray<FIndexedPawn> IndexedPawns;
+	TMap<FIntPoint, TArray<int32>> Cells;
+	int32 NextIndexUpdate = 0;
+
+	UPROPERTY()
+	TSubclassOf<APW_RocketCreation> PreviewRocketClass;
+
+	//Transform of the zone in the rocket, read from the defaults of the class
+	FTransform ZoneRelativeTransform;
+
+	FPWGravityZoneShape PreviewShape;
+
+	//Cells the candidates were gathered from, they are gathered again only when the zone covers other cells
+	FIntPoint GatheredMinCell = FIntPoint(MAX_int32, MAX_int32);
+	FIntPoint GatheredMaxCell = FIntPoint(MIN_int32, MIN_int32);
+	bool bCandidatesDirty = false;
+
+	TArray<TWeakObjectPtr<APawn>> Candidates;
+	int32 NextCandidateTest = 0;
+
+	TSet<TWeakObjectPtr<APawn>> PreviewPawns;
+
+	FDelegateHandle ActorSpawnedHandle;
+};
@@ -0,0 +1,261 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Core/PWTimingWheelSubsystem.h"
+#include "Core/PWGameplayStats.h"
+
+UPWTimingWheelSubsystem::UPWTimingWheelSubsystem()
+{
+	BucketHeads.Init(INDEX_NONE, OverflowBucket + 1);
+}
+
+void UPWTimingWheelSubsystem::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_PWLiveWheelTimers, GetNumLiveTimers());
+
+	Timers.Empty();
+	FreeIndices.Empty();
+	ExpiredTimers.Empty();
+	BucketHeads.Init(INDEX_NONE, OverflowBucket + 1);
+
+	Super::Deinitialize();
+}
+
+TStatId UPWTimingWheelSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWTimingWheelSubsystem, STATGROUP_Tickables);
+}
+
+void UPWTimingWheelSubsystem::SetTimer(FPWWheelTimerHandle& InOutHandle, FPWWheelTimerDelegate Callback, float Delay, bool bLoop)
+{
+	ClearTimer(InOutHandle);
+
+	int32 Index;
+	if(FreeIndices.Num() > 0)
+	{
+		Index = FreeIndices.Pop();
+	}
+	else
+	{
+		Index = Timers.AddDefaulted();
+	}
+
+	//Round up, a timer never expires before its delay
+	const uint32 DelayTicks = FMath::Max(1, FMath::CeilToInt(Delay / TickInterval));
+
+	FWheelTimer& Timer = Timers[Index];
+	Timer.Callback = MoveTemp(Callback);
+	Timer.ExpireTick = CurrentTick + DelayTicks;
+	Timer.IntervalTicks = DelayTicks;
+	Timer.bLooping = bLoop;
+	Timer.State = ETimerState::Scheduled;
+	LinkTimer(Index);
+
+	InOutHandle.Index = Index;
+	InOutHandle.Serial = Timer.Serial;
+
+	INC_DWORD_STAT(STAT_PWLiveWheelTimers);
+}
+
+void UPWTimingWheelSubsystem::ClearTimer(FPWWheelTimerHandle& InOutHandle)
+{
+	if(FindTimer(InOutHandle) != nullptr)
+	{
+		if(Timers[InOutHandle.Index].State == ETimerState::Scheduled)
+		{
+			UnlinkTimer(InOutHandle.Index);
+		}
+		FreeTimer(InOutHandle.Index);
+	}
+
+	InOutHandle.Invalidate();
+}
+
+const UPWTimingWheelSubsystem::FWheelTimer* UPWTimingWheelSubsystem::FindTimer(const FPWWheelTimerHandle& Handle) const
+{
+	if(!Timers.IsValidIndex(Handle.Index))
+	{
+		return nullptr;
+	}
+
+	const FWheelTimer& Timer = Timers[Handle.Index];
+	return Timer.Serial == Handle.Serial && Timer.State != ETimerState::Free ? &Timer : nullptr;
+}
+
+bool UPWTimingWheelSubsystem::IsTimerActive(const FPWWheelTimerHandle& Handle) const
+{
+	return FindTimer(Handle) != nullptr;
+}
+
+float UPWTimingWheelSubsystem::GetTimerRemaining(const FPWWheelTimerHandle& Handle) const
+{
+	const FWheelTimer* Timer = FindTimer(Handle);
+	if(Timer == nullptr)
+	{
+		return -1.0f;
+	}
+
+	const int64 RemainingTicks = static_cast<int64>(Timer->ExpireTick) - static_cast<int64>(CurrentTick);
+	return FMath::Max(0.0f, RemainingTicks * TickInterval - TimeAccumulator);
+}
+
+SIZE_T UPWTimingWheelSubsystem::GetAllocatedSize() const
+{
+	return Timers.GetAllocatedSize() + FreeIndices.GetAllocatedSize() + BucketHeads.GetAllocatedSize() + ExpiredTimers.GetAllocatedSize();
+}
+
+void UPWTimingWheelSubsystem::LinkTimer(int32 Index)
+{
+	FWheelTimer& Timer = Timers[Index];
+	const uint64 Delta = Timer.ExpireTick > CurrentTick ? Timer.ExpireTick - CurrentTick : 0;
+
+	//Each level covers 64 times the range of the previous one, the slot is taken from the bits of the expire tick
+	int32 Bucket = OverflowBucket;
+	for(int32 Level = 0; Level < NumLevels; ++Level)
+	{
+		if(Delta < (1ull << (SlotBits * (Level + 1))))
+		{
+			const int32 Slot = static_cast<int32>((Timer.ExpireTick >> (SlotBits * Level)) & SlotMask);
+			Bucket = Level * SlotsPerLevel + Slot;
+			break;
+		}
+	}
+
+	Timer.Bucket = Bucket;
+	Timer.Prev = INDEX_NONE;
+	Timer.Next = BucketHeads[Bucket];
+	if(Timer.Next != INDEX_NONE)
+	{
+		Timers[Timer.Next].Prev = Index;
+	}
+	BucketHeads[Bucket] = Index;
+}
+
+void UPWTimingWheelSubsystem::UnlinkTimer(int32 Index)
+{
+	FWheelTimer& Timer = Timers[Index];
+	if(Timer.Prev != INDEX_NONE)
+	{
+		Timers[Timer.Prev].Next = Timer.Next;
+	}
+	else
+	{
+		BucketHeads[Timer.Bucket] = Timer.Next;
+	}
+
+	if(Timer.Next != INDEX_NONE)
+	{
+		Timers[Timer.Next].Prev = Timer.Prev;
+	}
+
+	Timer.Bucket = INDEX_NONE;
+	Timer.Prev = INDEX_NONE;
+	Timer.Next = INDEX_NONE;
+}
+
+void UPWTimingWheelSubsystem::FreeTimer(int32 Index)
+{
+	FWheelTimer& Timer = Timers[Index];
+	Timer.Callback.Unbind();
+	Timer.State = ETimerState::Free;
+
+	//The old handles of this slot become invalid
+	++Timer.Serial;
+	FreeIndices.Add(Index);
+
+	DEC_DWORD_STAT(STAT_PWLiveWheelTimers);
+}
+
+void UPWTimingWheelSubsystem::CascadeBucket(int32 Bucket)
+{
+	int32 Index = BucketHeads[Bucket];
+	BucketHeads[Bucket] = INDEX_NONE;
+
+	while(Index != INDEX_NONE)
+	{
+		const int32 NextIndex = Timers[Index].Next;
+		LinkTimer(Index);
+		Index = NextIndex;
+	}
+}
+
+void UPWTimingWheelSubsystem::AdvanceOneTick()
+{
+	++CurrentTick;
+
+	//When a level wraps around, the next slot of the level above is spread over the lower levels
+	for(int32 Level = 1; Level <= NumLevels; ++Level)
+	{
+		if((CurrentTick & ((1ull << (SlotBits * Level)) - 1)) != 0)
+		{
+			break;
+		}
+
+		const int32 Bucket = Level < NumLevels
+			? Level * SlotsPerLevel + static_cast<int32>((CurrentTick >> (SlotBits * Level)) & SlotMask)
+			: OverflowBucket;
+		CascadeBucket(Bucket);
+	}
+
+	//Every timer of the current slot of the first level expires now
+	int32 Index = BucketHeads[static_cast<int32>(CurrentTick & SlotMask)];
+	while(Index != INDEX_NONE)
+	{
+		const int32 NextIndex = Timers[Index].Next;
+		UnlinkTimer(Index);
+
+		FWheelTimer& Timer = Timers[Index];
+		ExpiredTimers.Add({Index, Timer.Serial});
+
+		if(Timer.bLooping)
+		{
+			Timer.ExpireTick = CurrentTick + Timer.IntervalTicks;
+			LinkTimer(Index);
+		}
+		else
+		{
+			Timer.State = ETimerState::PendingDispatch;
+		}
+
+		Index = NextIndex;
+	}
+}
+
+void UPWTimingWheelSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	PW_SCOPE_GAMEPLAY_TIME(Timers);
+
+	TimeAccumulator += DeltaTime;
+	while(TimeAccumulator >= TickInterval)
+	{
+		TimeAccumulator -= TickInterval;
+		AdvanceOneTick();
+	}
+
+	NumExpiredLastFrame = ExpiredTimers.Num();
+	INC_DWORD_STAT_BY(STAT_PWWheelTimerExpirations, NumExpiredLastFrame);
+
+	//Dispatch the whole batch, the callbacks may set or clear other timers
+	TArray<FExpiredTimer> TimersToDispatch = MoveTemp(ExpiredTimers);
+	ExpiredTimers.Reset();
+	for(const FExpiredTimer& Expired : TimersToDispatch)
+	{
+		//Skip the timers cleared by a previous callback of the batch
+		FWheelTimer& Timer = Timers[Expired.Index];
+		if(Timer.Serial != Expired.Serial || Timer.State == ETimerState::Free)
+		{
+			continue;
+		}
+
+		//Copy the callback, it can add timers and move the array
+		const FPWWheelTimerDelegate Callback = Timer.Callback;
+		if(Timer.State == ETimerState::PendingDispatch)
+		{
+			FreeTimer(Expired.Index);
+		}
+
+		Callback.ExecuteIfBound();
+	}
+}
@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PWTimingWheelSubsystem.generated.h"
+
+DECLARE_DELEGATE(FPWWheelTimerDelegate);
+
+//Handle of a timer of the timing wheel, stays valid after the timer expired but IsTimerActive returns false
+USTRUCT(BlueprintType)
+struct FPWWheelTimerHandle
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Index = INDEX_NONE;
+
+	UPROPERTY()
+	uint32 Serial = 0;
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+	void Invalidate() { Index = INDEX_NONE; Serial = 0; }
+};
+
+/**
+ * Hierarchical timing wheel for the bulk, coarse gameplay timers (rocket countdowns, pickup lifetimes, sun updates).
+ * Insert and cancel are O(1), the expired timers of a frame are collected first and dispatched in one batch.
+ * The resolution is TickInterval, a timer never fires before its delay but may fire up to one tick late.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWTimingWheelSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UPWTimingWheelSubsystem();
+
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Start a timer, clears the timer of the handle first if it is still active
+	void SetTimer(FPWWheelTimerHandle& InOutHandle, FPWWheelTimerDelegate Callback, float Delay, bool bLoop = false);
+
+	template<class UserClass>
+	void SetTimer(FPWWheelTimerHandle& InOutHandle, UserClass* Object, void (UserClass::*Method)(), float Delay, bool bLoop = false)
+	{
+		SetTimer(InOutHandle, FPWWheelTimerDelegate::CreateUObject(Object, Method), Delay, bLoop);
+	}
+
+	//Stop a timer and invalidate its handle
+	void ClearTimer(FPWWheelTimerHandle& InOutHandle);
+
+	bool IsTimerActive(const FPWWheelTimerHandle& Handle) const;
+
+	//Seconds before the timer expires, -1 if the timer is not active
+	float GetTimerRemaining(const FPWWheelTimerHandle& Handle) const;
+
+	int32 GetNumLiveTimers() const { return Timers.Num() - FreeIndices.Num(); }
+	int32 GetNumExpiredLastFrame() const { return NumExpiredLastFrame; }
+
+	//Bytes allocated by the timers and the buckets
+	SIZE_T GetAllocatedSize() const;
+
+	//Seconds between two ticks of the wheel
+	UPROPERTY(Config)
+	float TickInterval = 0.05f;
+
+private:
+	static constexpr int32 SlotBits = 6;
+	static constexpr int32 SlotsPerLevel = 1 << SlotBits;
+	static constexpr int32 SlotMask = SlotsPerLevel - 1;
+	static constexpr int32 NumLevels = 3;
+
+	//The timers farther than the last level wait in an extra bucket
+	static constexpr int32 OverflowBucket = SlotsPerLevel * NumLevels;
+
+	enum class ETimerState : uint8
+	{
+		Free,
+		Scheduled,
+		PendingDispatch
+	};
+
+	struct FWheelTimer
+	{
+		FPWWheelTimerDelegate Callback;
+		uint64 ExpireTick = 0;
+		uint32 IntervalTicks = 0;
+		uint32 Serial = 0;
+		bool bLooping = false;
+		ETimerState State = ETimerState::Free;
+
+		//Links of the bucket list the timer is in
+		int32 Bucket = INDEX_NONE;
+		int32 Prev = INDEX_NONE;
+		int32 Next = INDEX_NONE;
+	};
+
+	struct FExpiredTimer
+	{
+		int32 Index;
+		uint32 Serial;
+	};
+
+	//Put a scheduled timer in the bucket matching its expire tick
+	void LinkTimer(int32 Index);
+	void UnlinkTimer(int32 Index);
+	void FreeTimer(int32 Index);
+
+	//Move the timers of a bucket to the lower levels
+	void CascadeBucket(int32 Bucket);
+
+	//Advance the wheel by one tick and collect the expired timers
+	void AdvanceOneTick();
+
+	const FWheelTimer* FindTimer(const FPWWheelTimerHandle& Handle) const;
+
+	TArray<FWheelTimer> Timers;
+	TArray<int32> FreeIndices;
+
+	//First timer of each bucket
+	TArray<int32> BucketHeads;
+
+	TArray<FExpiredTimer> ExpiredTimers;
+
+	uint64 CurrentTick = 0;
+	float TimeAccumulator = 0.0f;
+	int32 NumExpiredLastFrame = 0;
+};
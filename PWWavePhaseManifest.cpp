@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DayNight/PWWavePhaseManifest.h"
+
+void UPWWavePhaseManifest::GetAssetPathsForWave(int32 WaveIndex, TArray<FSoftObjectPath>& OutAssetPaths) const
+{
+	if(!AssetsPerWave.IsValidIndex(WaveIndex))
+	{
+		return;
+	}
+
+	const FPWWavePhaseAssets& WaveAssets = AssetsPerWave[WaveIndex];
+	for(const TSoftObjectPtr<UObject>& Asset : WaveAssets.Assets)
+	{
+		if(!Asset.IsNull())
+		{
+			OutAssetPaths.AddUnique(Asset.ToSoftObjectPath());
+		}
+	}
+
+	for(const TSoftClassPtr<UObject>& Class : WaveAssets.Classes)
+	{
+		if(!Class.IsNull())
+		{
+			OutAssetPaths.AddUnique(Class.ToSoftObjectPath());
+		}
+	}
+}
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "PWWavePhaseManifest.generated.h"
+
+//Assets used during one wave (enemy meshes, sounds, lanterns...)
+USTRUCT(BlueprintType)
+struct FPWWavePhaseAssets
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TArray<TSoftObjectPtr<UObject>> Assets;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	TArray<TSoftClassPtr<UObject>> Classes;
+};
+
+/**
+ * Lists the assets of each wave, in the order of the waves enum, so ADayNightActor can stream them one wave ahead.
+ */
+UCLASS(BlueprintType)
+class PROJECTWATER_API UPWWavePhaseManifest : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Waves")
+	TArray<FPWWavePhaseAssets> AssetsPerWave;
+
+	//Every asset path of a wave, empty if the wave is not in the manifest
+	void GetAssetPathsForWave(int32 WaveIndex, TArray<FSoftObjectPath>& OutAssetPaths) const;
+};
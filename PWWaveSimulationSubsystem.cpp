@@ -0,0 +1,385 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Core/PWWaveSimulationSubsystem.h"
+#include "EngineUtils.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "Characters/Enemies/PWEnemyPoolSubsystem.h"
+#include "Core/PWGameplayStats.h"
+#include "Core/PWWorldSnapshotSubsystem.h"
+#include "Creator/Items/CreationItems/PW_RocketCreation.h"
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+#include "DayNight/DayNightActor.h"
+#include "Engine/GameViewportClient.h"
+#include "Interactor/Interactable.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+static FAutoConsoleCommandWithWorldAndArgs StartWaveSimulationCommand(
+	TEXT("pw.WaveSim.Start"),
+	TEXT("Simulate the waves headless with a fixed time step. Optional number of runs and number of nights per run, 1 and 1 by default."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if(UPWWaveSimulationSubsystem* WaveSimulation = World != nullptr ? World->GetSubsystem<UPWWaveSimulationSubsystem>() : nullptr)
+		{
+			WaveSimulation->StartSimulation(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 1, false);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs StopWaveSimulationCommand(
+	TEXT("pw.WaveSim.Stop"),
+	TEXT("Stop the wave simulation after writing the report of the current run."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if(UPWWaveSimulationSubsystem* WaveSimulation = World != nullptr ? World->GetSubsystem<UPWWaveSimulationSubsystem>() : nullptr)
+		{
+			WaveSimulation->StopSimulation();
+		}
+	}));
+
+void UPWWaveSimulationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Collection.InitializeDependency<UPWGravityZoneSubsystem>();
+	Collection.InitializeDependency<UPWWorldSnapshotSubsystem>();
+	Super::Initialize(Collection);
+}
+
+void UPWWaveSimulationSubsystem::Deinitialize()
+{
+	if(bIsSimulating)
+	{
+		bIsSimulating = false;
+		GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		RestoreEngineSettings();
+	}
+
+	Super::Deinitialize();
+}
+
+void UPWWaveSimulationSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	//-PWWaveSim=<Runs> simulates from the start of the map and exits when done
+	int32 NumRuns = 0;
+	if(FParse::Value(FCommandLine::Get(), TEXT("PWWaveSim="), NumRuns) == false && FParse::Param(FCommandLine::Get(), TEXT("PWWaveSim")))
+	{
+		NumRuns = 1;
+	}
+
+	if(NumRuns > 0 && InWorld.IsGameWorld())
+	{
+		StartSimulation(NumRuns, NightsPerRun, true);
+	}
+}
+
+TStatId UPWWaveSimulationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPWWaveSimulationSubsystem, STATGROUP_Tickables);
+}
+
+void UPWWaveSimulationSubsystem::StartSimulation(int32 NumRuns, int32 NumNightsPerRun, bool bExitWhenDone)
+{
+	if(bIsSimulating)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Wave simulation: already running"));
+		return;
+	}
+
+	TActorIterator<ADayNightActor> It(GetWorld());
+	if(!It)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Wave simulation: no day night actor in the world"));
+		return;
+	}
+
+	DayNightActor = *It;
+	RunsRemaining = FMath::Max(NumRuns, 1);
+	NightsPerRun = FMath::Max(NumNightsPerRun, 1);
+	bExitOnFinish = bExitWhenDone;
+	CurrentReport.RunIndex = INDEX_NONE;
+
+	//With a fixed time step the engine doesn't wait for the frame rate, each frame simulates exactly one step
+	bPreviousUseFixedTimeStep = FApp::UseFixedTimeStep();
+	PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(SimulationTimeStep);
+
+	if(UGameViewportClient* GameViewport = GetWorld()->GetGameViewport())
+	{
+		GameViewport->bDisableWorldRendering = true;
+	}
+	DayNightActor->SetSkyUpdatesEnabled(false);
+
+	//Every run starts from the world as it is now
+	if(const UPWWorldSnapshotSubsystem* SnapshotSubsystem = GetWorld()->GetSubsystem<UPWWorldSnapshotSubsystem>())
+	{
+		SnapshotSubsystem->CaptureSnapshot(StartSnapshot);
+	}
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UPWWaveSimulationSubsystem::OnActorSpawned));
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		ZoneRemovedHandle = GravityZoneSubsystem->OnZoneRemoved.AddUObject(this, &UPWWaveSimulationSubsystem::OnZoneRemoved);
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Wave simulation: %d runs of %d nights, %.1f s per wave, step of %.4f s"), RunsRemaining, NightsPerRun, SecondsPerWave, SimulationTimeStep);
+
+	bIsSimulating = true;
+	StartRun();
+}
+
+void UPWWaveSimulationSubsystem::StopSimulation()
+{
+	if(bIsSimulating)
+	{
+		RunsRemaining = 1;
+		FinishRun();
+	}
+}
+
+void UPWWaveSimulationSubsystem::StartRun()
+{
+	const int32 RunIndex = CurrentReport.RunIndex + 1;
+	CurrentWave = INDEX_NONE;
+
+	//The runs after the first one start from the saved world
+	if(RunIndex > 0 && StartSnapshot.Num() > 0)
+	{
+		GetWorld()->GetSubsystem<UPWWorldSnapshotSubsystem>()->RestoreSnapshot(StartSnapshot);
+	}
+
+	CurrentReport = FPWSimulatedRunReport();
+	CurrentReport.RunIndex = RunIndex;
+	CurrentReport.Seed = BaseSeed + RunIndex;
+	CurrentReport.Waves.SetNum(Nightmare + 1);
+	RandomStream.Initialize(CurrentReport.Seed);
+	RunStartTime = FPlatformTime::Seconds();
+
+	WaveEnemies.Reset();
+	DayNightActor->WaveEnumCounter = FirstWave;
+	StartNextWave();
+}
+
+void UPWWaveSimulationSubsystem::FinishRun()
+{
+	CurrentReport.WallSeconds = FPlatformTime::Seconds() - RunStartTime;
+	CurrentWave = INDEX_NONE;
+	WriteRunReport(CurrentReport);
+
+	UE_LOG(LogTemp, Log, TEXT("Wave simulation: run %d, %d nights, %.0f simulated seconds in %.2f s (x%.0f)"), CurrentReport.RunIndex, CurrentReport.NightsSimulated,
+		CurrentReport.SimulatedSeconds, CurrentReport.WallSeconds, CurrentReport.SimulatedSeconds / FMath::Max(CurrentReport.WallSeconds, UE_DOUBLE_SMALL_NUMBER));
+
+	if(--RunsRemaining > 0)
+	{
+		StartRun();
+		return;
+	}
+
+	bIsSimulating = false;
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		GravityZoneSubsystem->OnZoneRemoved.Remove(ZoneRemovedHandle);
+	}
+	RestoreEngineSettings();
+
+	if(bExitOnFinish)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UPWWaveSimulationSubsystem::RestoreEngineSettings()
+{
+	FApp::SetUseFixedTimeStep(bPreviousUseFixedTimeStep);
+	FApp::SetFixedDeltaTime(PreviousFixedDeltaTime);
+
+	if(UGameViewportClient* GameViewport = GetWorld()->GetGameViewport())
+	{
+		GameViewport->bDisableWorldRendering = false;
+	}
+
+	if(DayNightActor)
+	{
+		DayNightActor->SetSkyUpdatesEnabled(true);
+	}
+}
+
+void UPWWaveSimulationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if(bIsSimulating == false || DayNightActor == nullptr)
+	{
+		return;
+	}
+
+	CurrentReport.SimulatedSeconds += DeltaTime;
+	++CurrentReport.NumSteps;
+	WaveElapsedSeconds += DeltaTime;
+
+	if(FPWSimulatedWaveReport* WaveReport = GetCurrentWaveReport())
+	{
+		const UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>();
+		const int32 NumFloatingEnemies = GravityZoneSubsystem != nullptr ? GravityZoneSubsystem->GetNumFloatingEnemies() : 0;
+		WaveReport->PeakFloatingEnemies = FMath::Max(WaveReport->PeakFloatingEnemies, NumFloatingEnemies);
+		WaveReport->FloatingEnemySeconds += NumFloatingEnemies * DeltaTime;
+	}
+
+	//The rockets are spread evenly over the wave
+	const float SecondsBetweenRockets = SecondsPerWave / (RocketsPerWave + 1);
+	if(RocketsPlacedThisWave < RocketsPerWave && WaveElapsedSeconds >= (RocketsPlacedThisWave + 1) * SecondsBetweenRockets)
+	{
+		PlaceRocket();
+	}
+
+	if(WaveElapsedSeconds >= SecondsPerWave)
+	{
+		StartNextWave();
+	}
+}
+
+void UPWWaveSimulationSubsystem::StartNextWave()
+{
+	//The enemies left at the end of the wave go back to the pool
+	if(FPWSimulatedWaveReport* WaveReport = GetCurrentWaveReport())
+	{
+		UPWEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UPWEnemyPoolSubsystem>();
+		for(APWEnemyCharacter* Enemy : WaveEnemies)
+		{
+			if(IsValid(Enemy) && (EnemyPool == nullptr || EnemyPool->IsPooled(Enemy) == false))
+			{
+				++WaveReport->EnemiesRemaining;
+				if(EnemyPool != nullptr)
+				{
+					EnemyPool->ReleaseEnemy(Enemy);
+				}
+			}
+		}
+	}
+	WaveEnemies.Reset();
+
+	if(CurrentWave == Nightmare && ++CurrentReport.NightsSimulated >= NightsPerRun)
+	{
+		FinishRun();
+		return;
+	}
+
+	//The counter points to the wave about to start, it goes back to the first wave after the nightmare
+	const int32 WaveIndex = DayNightActor->WaveEnumCounter > Nightmare ? FirstWave : DayNightActor->WaveEnumCounter;
+	DayNightActor->NewWaveWeather();
+
+	CurrentWave = WaveIndex;
+	WaveElapsedSeconds = 0.0f;
+	RocketsPlacedThisWave = 0;
+	SpawnWaveEnemies(WaveIndex);
+}
+
+void UPWWaveSimulationSubsystem::SpawnWaveEnemies(int32 WaveIndex)
+{
+	UPWEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UPWEnemyPoolSubsystem>();
+	if(EnemyPool == nullptr || DayNightActor->EnemiesPerWave.IsValidIndex(WaveIndex) == false)
+	{
+		return;
+	}
+
+	const FVector Center = DayNightActor->GetActorLocation();
+	for(const FPWWaveEnemyCount& WaveEnemy : DayNightActor->EnemiesPerWave[WaveIndex].Enemies)
+	{
+		for(int32 i = 0; i < WaveEnemy.NumEnemies; i++)
+		{
+			//Uniform in the disc around the day night actor
+			const float Angle = RandomStream.FRandRange(0.0f, UE_TWO_PI);
+			const float Distance = EnemySpawnRadius * FMath::Sqrt(RandomStream.FRand());
+			const FVector Location = Center + FVector(FMath::Cos(Angle) * Distance, FMath::Sin(Angle) * Distance, 0.0f);
+
+			if(APWEnemyCharacter* Enemy = EnemyPool->AcquireEnemy(WaveEnemy.EnemyClass, FTransform(FRotator(0.0f, FMath::RadiansToDegrees(Angle), 0.0f), Location)))
+			{
+				WaveEnemies.Add(Enemy);
+				++CurrentReport.Waves[WaveIndex].EnemiesSpawned;
+			}
+		}
+	}
+}
+
+void UPWWaveSimulationSubsystem::PlaceRocket()
+{
+	LLM_SCOPE_BYTAG(PWRockets);
+
+	++RocketsPlacedThisWave;
+
+	UClass* LoadedRocketClass = RocketClass.LoadSynchronous();
+	if(LoadedRocketClass == nullptr)
+	{
+		return;
+	}
+
+	//On a random enemy of the wave, like a player aiming at a group
+	FVector Location = DayNightActor->GetActorLocation();
+	WaveEnemies.RemoveAllSwap([](const APWEnemyCharacter* Enemy) { return IsValid(Enemy) == false; });
+	if(WaveEnemies.Num() > 0)
+	{
+		Location = WaveEnemies[RandomStream.RandHelper(WaveEnemies.Num())]->GetActorLocation();
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	if(GetWorld()->SpawnActor<APW_RocketCreation>(LoadedRocketClass, FTransform(Location), SpawnParameters) != nullptr)
+	{
+		++CurrentReport.Waves[CurrentWave].RocketsPlaced;
+	}
+}
+
+void UPWWaveSimulationSubsystem::OnActorSpawned(AActor* SpawnedActor)
+{
+	FPWSimulatedWaveReport* WaveReport = GetCurrentWaveReport();
+	if(AInteractable* Pickup = Cast<AInteractable>(SpawnedActor); Pickup != nullptr && WaveReport != nullptr)
+	{
+		++WaveReport->PickupsDropped;
+		WaveReport->PickupAmountDropped += Pickup->GetAmount();
+	}
+}
+
+void UPWWaveSimulationSubsystem::OnZoneRemoved(const FPWGravityZoneInfo& Zone)
+{
+	if(FPWSimulatedWaveReport* WaveReport = GetCurrentWaveReport())
+	{
+		++WaveReport->RocketsLaunched;
+	}
+}
+
+FPWSimulatedWaveReport* UPWWaveSimulationSubsystem::GetCurrentWaveReport()
+{
+	return CurrentReport.Waves.IsValidIndex(CurrentWave) ? &CurrentReport.Waves[CurrentWave] : nullptr;
+}
+
+void UPWWaveSimulationSubsystem::WriteRunReport(const FPWSimulatedRunReport& Report) const
+{
+	const FString ReportPath = FPaths::ProjectSavedDir() / TEXT("WaveSimulation") / TEXT("WaveSimulationReport.csv");
+
+	//One line per run, the header is written with the first one
+	FString Line;
+	if(IFileManager::Get().FileExists(*ReportPath) == false)
+	{
+		Line += TEXT("Run,Seed,Nights,SimulatedSeconds,WallSeconds,Steps");
+		for(int32 WaveIndex = 0; WaveIndex < Report.Waves.Num(); WaveIndex++)
+		{
+			const FString WaveName = StaticEnum<WavesBetweenNightmares>()->GetNameStringByValue(WaveIndex);
+			Line += FString::Printf(TEXT(",%s_Enemies,%s_Remaining,%s_Rockets,%s_Launched,%s_PeakFloating,%s_FloatingSeconds,%s_Pickups,%s_PickupAmount"),
+				*WaveName, *WaveName, *WaveName, *WaveName, *WaveName, *WaveName, *WaveName, *WaveName);
+		}
+		Line += LINE_TERMINATOR;
+	}
+
+	Line += FString::Printf(TEXT("%d,%d,%d,%.2f,%.3f,%d"), Report.RunIndex, Report.Seed, Report.NightsSimulated, Report.SimulatedSeconds, Report.WallSeconds, Report.NumSteps);
+	for(const FPWSimulatedWaveReport& Wave : Report.Waves)
+	{
+		Line += FString::Printf(TEXT(",%d,%d,%d,%d,%d,%.1f,%d,%d"), Wave.EnemiesSpawned, Wave.EnemiesRemaining, Wave.RocketsPlaced, Wave.RocketsLaunched,
+			Wave.PeakFloatingEnemies, Wave.FloatingEnemySeconds, Wave.PickupsDropped, Wave.PickupAmountDropped);
+	}
+	Line += LINE_TERMINATOR;
+
+	FFileHelper::SaveStringToFile(Line, *ReportPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append);
+}
@@ -0,0 +1,180 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PWWaveSimulationSubsystem.generated.h"
+
+class ADayNightActor;
+class APWEnemyCharacter;
+class APW_RocketCreation;
+struct FPWGravityZoneInfo;
+
+//What happened during one wave of a simulated night
+USTRUCT()
+struct FPWSimulatedWaveReport
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 EnemiesSpawned = 0;
+
+	//Enemies still in the world when the wave ended, they go back to the pool
+	UPROPERTY()
+	int32 EnemiesRemaining = 0;
+
+	UPROPERTY()
+	int32 RocketsPlaced = 0;
+
+	UPROPERTY()
+	int32 RocketsLaunched = 0;
+
+	UPROPERTY()
+	int32 PeakFloatingEnemies = 0;
+
+	//Sum of the floating enemies over the simulated seconds of the wave
+	UPROPERTY()
+	float FloatingEnemySeconds = 0.0f;
+
+	UPROPERTY()
+	int32 PickupsDropped = 0;
+
+	UPROPERTY()
+	int32 PickupAmountDropped = 0;
+};
+
+//Summary of one run, written as one line of the report
+USTRUCT()
+struct FPWSimulatedRunReport
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 RunIndex = 0;
+
+	UPROPERTY()
+	int32 Seed = 0;
+
+	UPROPERTY()
+	int32 NightsSimulated = 0;
+
+	UPROPERTY()
+	float SimulatedSeconds = 0.0f;
+
+	UPROPERTY()
+	double WallSeconds = 0.0;
+
+	UPROPERTY()
+	int32 NumSteps = 0;
+
+	//Totals of every night, one entry per wave of the waves enum
+	UPROPERTY()
+	TArray<FPWSimulatedWaveReport> Waves;
+};
+
+/**
+ * Headless simulation of the wave cycle for the balancing, without any player.
+ * The engine runs with a fixed time step and without any frame rate limit, so the waves, the rockets, the enemy floating
+ * and the pickups are simulated as fast as the CPU allows while the sky and the world rendering are stubbed out.
+ * The simulation owns the wave cycle: it starts the waves, takes their enemies from the pool and places the rockets.
+ * Every run starts from the same world snapshot and appends one line to Saved/WaveSimulation/WaveSimulationReport.csv.
+ * Start it with -PWWaveSim=<Runs> -nullrhi -unattended on a build box, or with pw.WaveSim.Start in game.
+ */
+UCLASS(Config=Game)
+class PROJECTWATER_API UPWWaveSimulationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Simulate this many runs of NightsPerRun nights, the game exits after the last one when bExitWhenDone is true
+	void StartSimulation(int32 NumRuns, int32 NumNightsPerRun, bool bExitWhenDone);
+
+	//Stop after writing the report of the current run
+	void StopSimulation();
+
+	bool IsSimulating() const { return bIsSimulating; }
+
+	//Simulated seconds of each engine frame
+	UPROPERTY(Config)
+	float SimulationTimeStep = 1.0f / 30.0f;
+
+	//Simulated seconds of each wave, the nightmare included
+	UPROPERTY(Config)
+	float SecondsPerWave = 90.0f;
+
+	UPROPERTY(Config)
+	int32 NightsPerRun = 1;
+
+	//Rockets placed during each wave, spread over the wave on random enemies of the wave
+	UPROPERTY(Config)
+	int32 RocketsPerWave = 3;
+
+	UPROPERTY(Config)
+	TSoftClassPtr<APW_RocketCreation> RocketClass;
+
+	//The enemies of a wave are placed around the day night actor within this radius
+	UPROPERTY(Config)
+	float EnemySpawnRadius = 3000.0f;
+
+	//Seed of the first run, each run adds its index
+	UPROPERTY(Config)
+	int32 BaseSeed = 1;
+
+private:
+	void StartRun();
+	void FinishRun();
+
+	//Release the enemies of the wave that ends and start the next wave
+	void StartNextWave();
+
+	void SpawnWaveEnemies(int32 WaveIndex);
+	void PlaceRocket();
+
+	void OnActorSpawned(AActor* SpawnedActor);
+	void OnZoneRemoved(const FPWGravityZoneInfo& Zone);
+
+	void WriteRunReport(const FPWSimulatedRunReport& Report) const;
+
+	//Put back the engine time step and the rendering of the world
+	void RestoreEngineSettings();
+
+	FPWSimulatedWaveReport* GetCurrentWaveReport();
+
+	UPROPERTY()
+	TObjectPtr<ADayNightActor> DayNightActor;
+
+	//Enemies of the current wave
+	UPROPERTY()
+	TArray<TObjectPtr<APWEnemyCharacter>> WaveEnemies;
+
+	UPROPERTY()
+	FPWSimulatedRunReport CurrentReport;
+
+	//World state at the start of the simulation, every run starts from it
+	TArray<uint8> StartSnapshot;
+
+	FRandomStream RandomStream;
+
+	int32 RunsRemaining = 0;
+	int32 CurrentWave = INDEX_NONE;
+	int32 RocketsPlacedThisWave = 0;
+	float WaveElapsedSeconds = 0.0f;
+	double RunStartTime = 0.0;
+
+	bool bIsSimulating = false;
+	bool bExitOnFinish = false;
+
+	//Engine settings before the simulation
+	bool bPreviousUseFixedTimeStep = false;
+	double PreviousFixedDeltaTime = 0.0;
+
+	FDelegateHandle ActorSpawnedHandle;
+	FDelegateHandle ZoneRemovedHandle;
+};
@@ -0,0 +1,657 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Core/PWWorldSnapshotSubsystem.h"
+#include "EngineUtils.h"
+#include "Characters/Enemies/PWEnemyCharacter.h"
+#include "Characters/Enemies/PWEnemyPoolSubsystem.h"
+#include "Characters/Player/PWPlayerCharacter.h"
+#include "Characters/Player/PWPlayerRocketStateComponent.h"
+#include "Core/PWGameplayStats.h"
+#include "Creator/Items/CreationItems/PW_RocketCreation.h"
+#include "Creator/Items/CreationItems/PWGravityFieldSubsystem.h"
+#include "Creator/Items/CreationItems/PWGravityZoneReplication.h"
+#include "Creator/Items/CreationItems/PWGravityZoneShapeSubsystem.h"
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+#include "DayNight/DayNightActor.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerState.h"
+#include "Interactor/Interactable.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace PWWorldSnapshot
+{
+	constexpr uint32 Magic = 0x50575353;	//"PWSS"
+	constexpr int32 Version = 2;
+
+	//The bools are saved in a single byte
+	void SerializeBool(FArchive& Ar, bool& bValue)
+	{
+		uint8 Byte = bValue ? 1 : 0;
+		Ar << Byte;
+		bValue = Byte != 0;
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SaveSnapshotCommand(
+	TEXT("pw.Snapshot.Save"),
+	TEXT("Save a snapshot of the gameplay state. Optional file name, else the snapshot is kept in memory as the checkpoint."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if(UPWWorldSnapshotSubsystem* SnapshotSubsystem = World != nullptr ? World->GetSubsystem<UPWWorldSnapshotSubsystem>() : nullptr)
+		{
+			if(Args.Num() > 0)
+			{
+				SnapshotSubsystem->SaveSnapshotToFile(Args[0]);
+			}
+			else
+			{
+				SnapshotSubsystem->SaveCheckpoint();
+			}
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs LoadSnapshotCommand(
+	TEXT("pw.Snapshot.Load"),
+	TEXT("Restore a snapshot of the gameplay state. Optional file name, else the checkpoint kept in memory is restored."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if(UPWWorldSnapshotSubsystem* SnapshotSubsystem = World != nullptr ? World->GetSubsystem<UPWWorldSnapshotSubsystem>() : nullptr)
+		{
+			if(Args.Num() > 0)
+			{
+				SnapshotSubsystem->LoadSnapshotFromFile(Args[0]);
+			}
+			else
+			{
+				SnapshotSubsystem->RestoreCheckpoint();
+			}
+		}
+	}));
+
+FArchive& operator<<(FArchive& Ar, FPWRocketSnapshot& Rocket)
+{
+	Ar << Rocket.ClassIndex << Rocket.Location << Rocket.Rotation << Rocket.Scale << Rocket.RemainingSeconds;
+	PWWorldSnapshot::SerializeBool(Ar, Rocket.bAffectsEnemies);
+	PWWorldSnapshot::SerializeBool(Ar, Rocket.bAffectsPlayer);
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FPWPawnSnapshot& Pawn)
+{
+	Ar << Pawn.ClassIndex << Pawn.Location << Pawn.Yaw << Pawn.OverlappingZoneCount << Pawn.Flags;
+	if(EnumHasAnyFlags(static_cast<EPWPawnGravityFlags>(Pawn.Flags), EPWPawnGravityFlags::Player))
+	{
+		Ar << Pawn.PlayerId;
+	}
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FPWInteractableSnapshot& Interactable)
+{
+	Ar << Interactable.ClassIndex << Interactable.InteractableId << Interactable.Amount << Interactable.Location << Interactable.DestroyTimeRemaining;
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FPWDayNightSnapshot& DayNight)
+{
+	PWWorldSnapshot::SerializeBool(Ar, DayNight.bIsValid);
+	Ar << DayNight.WaveEnumCounter << DayNight.SunAngle << DayNight.PreviousSunAngle << DayNight.SunRotationIncrement << DayNight.ElapsedTime;
+	PWWorldSnapshot::SerializeBool(Ar, DayNight.bSunMoving);
+	Ar << DayNight.LightRotation;
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FPWWorldSnapshot& Snapshot)
+{
+	uint32 Magic = PWWorldSnapshot::Magic;
+	int32 Version = PWWorldSnapshot::Version;
+	Ar << Magic << Version;
+	if(Ar.IsLoading() && (Magic != PWWorldSnapshot::Magic || Version != PWWorldSnapshot::Version))
+	{
+		Ar.SetError();
+		return Ar;
+	}
+
+	Ar << Snapshot.ClassPaths << Snapshot.DayNight << Snapshot.Rockets << Snapshot.Enemies << Snapshot.Players << Snapshot.Interactables;
+	return Ar;
+}
+
+void UPWWorldSnapshotSubsystem::CaptureSnapshot(TArray<uint8>& OutBytes, TArray<APWEnemyCharacter*>* OutEnemies) const
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	FPWWorldSnapshot Snapshot;
+	CaptureDayNight(Snapshot.DayNight);
+	CaptureRockets(Snapshot);
+	CapturePawns(Snapshot, OutEnemies);
+	CaptureInteractables(Snapshot);
+
+	OutBytes.Reset();
+	FMemoryWriter Writer(OutBytes);
+	Writer << Snapshot;
+
+	UE_LOG(LogTemp, Verbose, TEXT("World snapshot captured in %.2f ms, %d bytes: %d rockets, %d enemies, %d players, %d pickups"),
+		(FPlatformTime::Seconds() - StartTime) * 1000.0, OutBytes.Num(), Snapshot.Rockets.Num(), Snapshot.Enemies.Num(), Snapshot.Players.Num(), Snapshot.Interactables.Num());
+}
+
+bool UPWWorldSnapshotSubsystem::RestoreSnapshot(const TArray<uint8>& Bytes, TArray<APWEnemyCharacter*>* OutEnemies)
+{
+	//The clients receive the restored state through the replication
+	if(GetWorld()->GetNetMode() == NM_Client)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("World snapshot: only the server can restore a snapshot"));
+		return false;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	FPWWorldSnapshot Snapshot;
+	FMemoryReader Reader(Bytes);
+	Reader << Snapshot;
+	if(Reader.IsError())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("World snapshot: the data isn't a snapshot of this version"));
+		return false;
+	}
+
+	//Resolve the class table once
+	TArray<UClass*> Classes;
+	for(const FString& ClassPath : Snapshot.ClassPaths)
+	{
+		Classes.Add(FSoftClassPath(ClassPath).TryLoadClass<AActor>());
+	}
+
+	//The rockets ignore the overlaps caused by the moves, the zone state of the pawns is restored after
+	UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>();
+	if(GravityZoneSubsystem != nullptr)
+	{
+		GravityZoneSubsystem->SetZoneEventsSuspended(true);
+	}
+
+	TArray<APW_RocketCreation*> Rockets;
+	TArray<APawn*> Pawns;
+	TArray<const FPWPawnSnapshot*> PawnSnapshots;
+	RestoreRockets(Snapshot, Classes, Rockets);
+	RestorePawns(Snapshot, Classes, Pawns, PawnSnapshots, OutEnemies);
+	RestoreInteractables(Snapshot, Classes);
+
+	if(GravityZoneSubsystem != nullptr)
+	{
+		GravityZoneSubsystem->SetZoneEventsSuspended(false);
+	}
+
+	RestoreZoneMemberships(Rockets, Pawns, PawnSnapshots);
+	RestoreDayNight(Snapshot.DayNight);
+
+	UE_LOG(LogTemp, Verbose, TEXT("World snapshot restored in %.2f ms: %d rockets, %d enemies, %d players, %d pickups"),
+		(FPlatformTime::Seconds() - StartTime) * 1000.0, Snapshot.Rockets.Num(), Snapshot.Enemies.Num(), Snapshot.Players.Num(), Snapshot.Interactables.Num());
+	return true;
+}
+
+void UPWWorldSnapshotSubsystem::SaveCheckpoint()
+{
+	CaptureSnapshot(CheckpointBytes);
+}
+
+bool UPWWorldSnapshotSubsystem::RestoreCheckpoint()
+{
+	if(CheckpointBytes.IsEmpty())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("World snapshot: no checkpoint saved"));
+		return false;
+	}
+
+	return RestoreSnapshot(CheckpointBytes);
+}
+
+bool UPWWorldSnapshotSubsystem::SaveSnapshotToFile(const FString& SnapshotName) const
+{
+	TArray<uint8> Bytes;
+	CaptureSnapshot(Bytes);
+	return FFileHelper::SaveArrayToFile(Bytes, *GetSnapshotFilePath(SnapshotName));
+}
+
+bool UPWWorldSnapshotSubsystem::LoadSnapshotFromFile(const FString& SnapshotName)
+{
+	TArray<uint8> Bytes;
+	if(FFileHelper::LoadFileToArray(Bytes, *GetSnapshotFilePath(SnapshotName)) == false)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("World snapshot: can't read %s"), *GetSnapshotFilePath(SnapshotName));
+		return false;
+	}
+
+	return RestoreSnapshot(Bytes);
+}
+
+FString UPWWorldSnapshotSubsystem::GetSnapshotFilePath(const FString& SnapshotName)
+{
+	return FPaths::ProjectSavedDir() / TEXT("Snapshots") / (SnapshotName + TEXT(".pwsnap"));
+}
+
+int32 UPWWorldSnapshotSubsystem::FindOrAddClass(FPWWorldSnapshot& Snapshot, const UClass* Class)
+{
+	return Snapshot.ClassPaths.AddUnique(FSoftClassPath(Class).ToString());
+}
+
+void UPWWorldSnapshotSubsystem::CaptureDayNight(FPWDayNightSnapshot& OutDayNight) const
+{
+	TActorIterator<ADayNightActor> It(GetWorld());
+	if(!It)
+	{
+		return;
+	}
+
+	const ADayNightActor* DayNightActor = *It;
+	OutDayNight.bIsValid = true;
+	OutDayNight.WaveEnumCounter = DayNightActor->WaveEnumCounter;
+	OutDayNight.SunAngle = DayNightActor->SunAngle;
+	OutDayNight.PreviousSunAngle = DayNightActor->PreviousSunAngle;
+	OutDayNight.SunRotationIncrement = DayNightActor->SunRotationIncrement;
+	OutDayNight.ElapsedTime = DayNightActor->ElapsedTime;
+	OutDayNight.bSunMoving = DayNightActor->IsSunMoving();
+
+	//The sun is rotated by increments, the rotation is saved as it is
+	if(DayNightActor->DirectionalLight)
+	{
+		OutDayNight.LightRotation = FRotator3f(DayNightActor->DirectionalLight->GetActorRotation());
+	}
+}
+
+void UPWWorldSnapshotSubsystem::CaptureRockets(FPWWorldSnapshot& Snapshot) const
+{
+	for(TActorIterator<APW_RocketCreation> It(GetWorld()); It; ++It)
+	{
+		//The warm instances of the creation item registry never finish spawning
+		const APW_RocketCreation* Rocket = *It;
+		if(Rocket->IsPendingKillPending() || Rocket->IsActorInitialized() == false)
+		{
+			continue;
+		}
+
+		FPWRocketSnapshot& SavedRocket = Snapshot.Rockets.AddDefaulted_GetRef();
+		SavedRocket.ClassIndex = FindOrAddClass(Snapshot, Rocket->GetClass());
+		SavedRocket.Location = FVector3f(Rocket->GetActorLocation());
+		SavedRocket.Rotation = FQuat4f(Rocket->GetActorQuat());
+		SavedRocket.Scale = FVector3f(Rocket->GetActorScale3D());
+		SavedRocket.RemainingSeconds = Rocket->GetRemainingTime();
+		SavedRocket.bAffectsEnemies = Rocket->bCanEnemiesFloatInRocketZone;
+		SavedRocket.bAffectsPlayer = Rocket->bCanPlayerFloatInRocketZone;
+	}
+}
+
+void UPWWorldSnapshotSubsystem::CapturePawns(FPWWorldSnapshot& Snapshot, TArray<APWEnemyCharacter*>* OutEnemies) const
+{
+	const UPWEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UPWEnemyPoolSubsystem>();
+	for(TActorIterator<APWEnemyCharacter> It(GetWorld()); It; ++It)
+	{
+		APWEnemyCharacter* Enemy = *It;
+		if(Enemy->IsPendingKillPending() || (EnemyPool != nullptr && EnemyPool->IsPooled(Enemy)))
+		{
+			continue;
+		}
+
+		EPWPawnGravityFlags Flags = EPWPawnGravityFlags::None;
+		if(Enemy->bIsInGravityZone)
+		{
+			Flags |= EPWPawnGravityFlags::Floating;
+		}
+		if(Enemy->bEnemyAlreadyInsideOnCraft)
+		{
+			Flags |= EPWPawnGravityFlags::AlreadyInsideOnCraft;
+		}
+
+		FPWPawnSnapshot& SavedEnemy = Snapshot.Enemies.AddDefaulted_GetRef();
+		SavedEnemy.ClassIndex = FindOrAddClass(Snapshot, Enemy->GetClass());
+		SavedEnemy.Location = FVector3f(Enemy->GetActorLocation());
+		SavedEnemy.Yaw = static_cast<float>(Enemy->GetActorRotation().Yaw);
+		SavedEnemy.OverlappingZoneCount = static_cast<uint8>(FMath::Clamp(Enemy->NbRocketOverlappingCounter, 0, 255));
+		SavedEnemy.Flags = static_cast<uint8>(Flags);
+
+		if(OutEnemies != nullptr)
+		{
+			OutEnemies->Add(Enemy);
+		}
+	}
+
+	//The players are matched by their player state on restore, their class is kept
+	for(TActorIterator<APWPlayerCharacter> It(GetWorld()); It; ++It)
+	{
+		const APWPlayerCharacter* Player = *It;
+		const APlayerState* PlayerState = Player->GetPlayerState();
+
+		EPWPawnGravityFlags Flags = EPWPawnGravityFlags::Player;
+		if(Player->bIsPlayerFlyingInGravityZone)
+		{
+			Flags |= EPWPawnGravityFlags::Floating;
+		}
+
+		FPWPawnSnapshot& SavedPlayer = Snapshot.Players.AddDefaulted_GetRef();
+		SavedPlayer.Location = FVector3f(Player->GetActorLocation());
+		SavedPlayer.Yaw = static_cast<float>(Player->GetActorRotation().Yaw);
+		SavedPlayer.OverlappingZoneCount = static_cast<uint8>(FMath::Clamp(Player->NbRocketOverlappingCounter, 0, 255));
+		SavedPlayer.Flags = static_cast<uint8>(Flags);
+		SavedPlayer.PlayerId = PlayerState != nullptr ? PlayerState->GetPlayerId() : INDEX_NONE;
+	}
+}
+
+void UPWWorldSnapshotSubsystem::CaptureInteractables(FPWWorldSnapshot& Snapshot) const
+{
+	for(TActorIterator<AInteractable> It(GetWorld()); It; ++It)
+	{
+		AInteractable* Interactable = *It;
+		if(Interactable->IsPendingKillPending())
+		{
+			continue;
+		}
+
+		FPWInteractableSnapshot& SavedInteractable = Snapshot.Interactables.AddDefaulted_GetRef();
+		SavedInteractable.ClassIndex = FindOrAddClass(Snapshot, Interactable->GetClass());
+		SavedInteractable.InteractableId = Interactable->GetInteractableId();
+		SavedInteractable.Amount = Interactable->GetAmount();
+		SavedInteractable.Location = FVector3f(Interactable->GetActorLocation());
+		SavedInteractable.DestroyTimeRemaining = Interactable->GetDestroyTimeRemaining();
+	}
+}
+
+void UPWWorldSnapshotSubsystem::RestoreDayNight(const FPWDayNightSnapshot& DayNight) const
+{
+	TActorIterator<ADayNightActor> It(GetWorld());
+	if(DayNight.bIsValid == false || !It)
+	{
+		return;
+	}
+
+	ADayNightActor* DayNightActor = *It;
+	DayNightActor->WaveEnumCounter = DayNight.WaveEnumCounter;
+	DayNightActor->SunAngle = DayNight.SunAngle;
+	DayNightActor->PreviousSunAngle = DayNight.PreviousSunAngle;
+	DayNightActor->SunRotationIncrement = DayNight.SunRotationIncrement;
+	DayNightActor->ElapsedTime = DayNight.ElapsedTime;
+
+	if(DayNightActor->DirectionalLight)
+	{
+		DayNightActor->DirectionalLight->SetActorRotation(FRotator(DayNight.LightRotation));
+	}
+
+	DayNightActor->ResumeFromSnapshot(DayNight.bSunMoving);
+}
+
+void UPWWorldSnapshotSubsystem::RestoreRockets(const FPWWorldSnapshot& Snapshot, const TArray<UClass*>& Classes, TArray<APW_RocketCreation*>& OutRockets) const
+{
+	LLM_SCOPE_BYTAG(PWRockets);
+
+	TArray<APW_RocketCreation*> LiveRockets;
+	for(TActorIterator<APW_RocketCreation> It(GetWorld()); It; ++It)
+	{
+		//The warm instances of the creation item registry aren't rockets of the game, they are never destroyed
+		if(It->IsPendingKillPending() == false && It->IsActorInitialized())
+		{
+			LiveRockets.Add(*It);
+		}
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	for(const FPWRocketSnapshot& SavedRocket : Snapshot.Rockets)
+	{
+		UClass* RocketClass = Classes.IsValidIndex(SavedRocket.ClassIndex) ? Classes[SavedRocket.ClassIndex] : nullptr;
+		if(RocketClass == nullptr || RocketClass->IsChildOf(APW_RocketCreation::StaticClass()) == false)
+		{
+			continue;
+		}
+
+		//Keep the rockets that are still at their saved location, only their countdown changes
+		APW_RocketCreation* Rocket = nullptr;
+		const int32 LiveIndex = LiveRockets.IndexOfByPredicate([RocketClass, &SavedRocket](const APW_RocketCreation* LiveRocket)
+		{
+			return LiveRocket->GetClass() == RocketClass && FVector3f(LiveRocket->GetActorLocation()).Equals(SavedRocket.Location, 1.0f);
+		});
+
+		if(LiveIndex != INDEX_NONE)
+		{
+			Rocket = LiveRockets[LiveIndex];
+			LiveRockets.RemoveAtSwap(LiveIndex);
+		}
+		else
+		{
+			const FTransform SpawnTransform(FQuat(SavedRocket.Rotation), FVector(SavedRocket.Location), FVector(SavedRocket.Scale));
+			Rocket = GetWorld()->SpawnActor<APW_RocketCreation>(RocketClass, SpawnTransform, SpawnParameters);
+		}
+
+		if(Rocket != nullptr)
+		{
+			Rocket->RestoreFromSnapshot(SavedRocket.RemainingSeconds, SavedRocket.bAffectsEnemies, SavedRocket.bAffectsPlayer);
+			OutRockets.Add(Rocket);
+		}
+	}
+
+	//The rockets that didn't exist when the snapshot was saved
+	for(APW_RocketCreation* LiveRocket : LiveRockets)
+	{
+		LiveRocket->Destroy();
+	}
+}
+
+void UPWWorldSnapshotSubsystem::RestorePawns(const FPWWorldSnapshot& Snapshot, const TArray<UClass*>& Classes, TArray<APawn*>& OutPawns, TArray<const FPWPawnSnapshot*>& OutPawnSnapshots, TArray<APWEnemyCharacter*>* OutEnemies) const
+{
+	if(OutEnemies != nullptr)
+	{
+		OutEnemies->Init(nullptr, Snapshot.Enemies.Num());
+	}
+
+	//Every live enemy goes back to the pool, then the saved enemies are taken from it, mostly the same actors
+	if(UPWEnemyPoolSubsystem* EnemyPool = GetWorld()->GetSubsystem<UPWEnemyPoolSubsystem>())
+	{
+		TArray<APWEnemyCharacter*> LiveEnemies;
+		for(TActorIterator<APWEnemyCharacter> It(GetWorld()); It; ++It)
+		{
+			if(It->IsPendingKillPending() == false && EnemyPool->IsPooled(*It) == false)
+			{
+				LiveEnemies.Add(*It);
+			}
+		}
+
+		for(APWEnemyCharacter* Enemy : LiveEnemies)
+		{
+			EnemyPool->ReleaseEnemy(Enemy);
+		}
+
+		for(int32 EnemyIndex = 0; EnemyIndex < Snapshot.Enemies.Num(); EnemyIndex++)
+		{
+			const FPWPawnSnapshot& SavedEnemy = Snapshot.Enemies[EnemyIndex];
+			UClass* EnemyClass = Classes.IsValidIndex(SavedEnemy.ClassIndex) ? Classes[SavedEnemy.ClassIndex] : nullptr;
+			if(EnemyClass == nullptr || EnemyClass->IsChildOf(APWEnemyCharacter::StaticClass()) == false)
+			{
+				continue;
+			}
+
+			const FTransform SpawnTransform(FRotator(0.0f, SavedEnemy.Yaw, 0.0f), FVector(SavedEnemy.Location));
+			if(APWEnemyCharacter* Enemy = EnemyPool->AcquireEnemy(EnemyClass, SpawnTransform))
+			{
+				OutPawns.Add(Enemy);
+				OutPawnSnapshots.Add(&SavedEnemy);
+				if(OutEnemies != nullptr)
+				{
+					(*OutEnemies)[EnemyIndex] = Enemy;
+				}
+			}
+		}
+	}
+
+	//Each player gets the saved state of its player state, the players of a snapshot from another session take the remaining ones in order
+	TArray<const FPWPawnSnapshot*> UnmatchedSavedPlayers;
+	for(const FPWPawnSnapshot& SavedPlayer : Snapshot.Players)
+	{
+		UnmatchedSavedPlayers.Add(&SavedPlayer);
+	}
+
+	TArray<APWPlayerCharacter*> UnmatchedPlayers;
+	for(TActorIterator<APWPlayerCharacter> It(GetWorld()); It; ++It)
+	{
+		APWPlayerCharacter* Player = *It;
+		const APlayerState* PlayerState = Player->GetPlayerState();
+		const int32 SavedIndex = PlayerState == nullptr ? INDEX_NONE : UnmatchedSavedPlayers.IndexOfByPredicate([PlayerState](const FPWPawnSnapshot* SavedPlayer)
+		{
+			return SavedPlayer->PlayerId == PlayerState->GetPlayerId();
+		});
+
+		if(SavedIndex == INDEX_NONE)
+		{
+			UnmatchedPlayers.Add(Player);
+			continue;
+		}
+
+		RestorePlayer(Player, *UnmatchedSavedPlayers[SavedIndex]);
+		OutPawns.Add(Player);
+		OutPawnSnapshots.Add(UnmatchedSavedPlayers[SavedIndex]);
+		UnmatchedSavedPlayers.RemoveAt(SavedIndex);
+	}
+
+	for(int32 i = 0; i < UnmatchedPlayers.Num() && i < UnmatchedSavedPlayers.Num(); i++)
+	{
+		RestorePlayer(UnmatchedPlayers[i], *UnmatchedSavedPlayers[i]);
+		OutPawns.Add(UnmatchedPlayers[i]);
+		OutPawnSnapshots.Add(UnmatchedSavedPlayers[i]);
+	}
+}
+
+void UPWWorldSnapshotSubsystem::RestorePlayer(APWPlayerCharacter* Player, const FPWPawnSnapshot& SavedPlayer) const
+{
+	//Back on foot, the zone state is restored with the memberships
+	UCharacterMovementComponent* MovementComponent = Player->GetCharacterMovement();
+	MovementComponent->Velocity = FVector::ZeroVector;
+	MovementComponent->AirControl = 0.2f;
+	MovementComponent->SetMovementMode(EMovementMode::MOVE_Walking);
+	MovementComponent->BrakingDecelerationFalling = 0.0f;
+	Player->setNumberOfOverlappingRocketForPlayer(0);
+	Player->bIsPlayerFlyingInGravityZone = false;
+
+	if(const UPWPlayerRocketStateComponent* RocketState = UPWPlayerRocketStateComponent::FindRocketState(Player))
+	{
+		RocketState->ApplyJumpSettings();
+	}
+
+	Player->SetActorLocation(FVector(SavedPlayer.Location), false, nullptr, ETeleportType::TeleportPhysics);
+	if(AController* Controller = Player->GetController())
+	{
+		Controller->SetControlRotation(FRotator(0.0f, SavedPlayer.Yaw, 0.0f));
+	}
+}
+
+void UPWWorldSnapshotSubsystem::RestoreInteractables(const FPWWorldSnapshot& Snapshot, const TArray<UClass*>& Classes) const
+{
+	LLM_SCOPE_BYTAG(PWPickups);
+
+	//The pickups already in the world are moved to the saved ones of the same class
+	TMap<UClass*, TArray<AInteractable*>> LiveInteractables;
+	for(TActorIterator<AInteractable> It(GetWorld()); It; ++It)
+	{
+		if(It->IsPendingKillPending() == false)
+		{
+			LiveInteractables.FindOrAdd(It->GetClass()).Add(*It);
+		}
+	}
+
+	for(const FPWInteractableSnapshot& SavedInteractable : Snapshot.Interactables)
+	{
+		UClass* InteractableClass = Classes.IsValidIndex(SavedInteractable.ClassIndex) ? Classes[SavedInteractable.ClassIndex] : nullptr;
+		if(InteractableClass == nullptr || InteractableClass->IsChildOf(AInteractable::StaticClass()) == false)
+		{
+			continue;
+		}
+
+		const FTransform SpawnTransform(FVector(SavedInteractable.Location));
+		AInteractable* Interactable = nullptr;
+		TArray<AInteractable*>* LiveOfClass = LiveInteractables.Find(InteractableClass);
+		if(LiveOfClass != nullptr && LiveOfClass->Num() > 0)
+		{
+			Interactable = LiveOfClass->Pop();
+			Interactable->SetActorLocation(SpawnTransform.GetLocation(), false, nullptr, ETeleportType::TeleportPhysics);
+		}
+		else
+		{
+			//Already at its final location, no spawn animation
+			Interactable = GetWorld()->SpawnActorDeferred<AInteractable>(InteractableClass, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+			if(Interactable != nullptr)
+			{
+				Interactable->bHasSpawnAnimation = false;
+				Interactable->FinishSpawning(SpawnTransform);
+			}
+		}
+
+		if(Interactable != nullptr)
+		{
+			Interactable->RestoreFromSnapshot(SavedInteractable.InteractableId, SavedInteractable.Amount, SavedInteractable.DestroyTimeRemaining);
+		}
+	}
+
+	//The pickups that didn't exist when the snapshot was saved
+	for(const TPair<UClass*, TArray<AInteractable*>>& LiveOfClass : LiveInteractables)
+	{
+		for(AInteractable* Interactable : LiveOfClass.Value)
+		{
+			Interactable->Destroy();
+		}
+	}
+}
+
+void UPWWorldSnapshotSubsystem::RestoreZoneMemberships(const TArray<APW_RocketCreation*>& Rockets, const TArray<APawn*>& Pawns, const TArray<const FPWPawnSnapshot*>& PawnSnapshots) const
+{
+	//The shaped zones learn their pawns without enter events
+	if(UPWGravityZoneShapeSubsystem* ShapeSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneShapeSubsystem>())
+	{
+		for(APW_RocketCreation* Rocket : Rockets)
+		{
+			ShapeSubsystem->SyncZoneMembers(Rocket);
+		}
+	}
+
+	//The gravity field makes the pawns float again by itself on the next frame
+	if(UPWGravityFieldSubsystem::IsFieldModeEnabled() == true)
+	{
+		if(UPWGravityFieldSubsystem* GravityFieldSubsystem = GetWorld()->GetSubsystem<UPWGravityFieldSubsystem>())
+		{
+			GravityFieldSubsystem->ResetPawnStates();
+		}
+		return;
+	}
+
+	const UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>();
+	if(GravityZoneSubsystem == nullptr)
+	{
+		return;
+	}
+
+	for(int32 i = 0; i < Pawns.Num(); i++)
+	{
+		APawn* Pawn = Pawns[i];
+		const EPWPawnGravityFlags Flags = static_cast<EPWPawnGravityFlags>(PawnSnapshots[i]->Flags);
+		if(EnumHasAnyFlags(Flags, EPWPawnGravityFlags::Floating) == false)
+		{
+			continue;
+		}
+
+		//Float with the settings of one of the zones containing the pawn, and count every zone it was in
+		const bool bIsPlayer = EnumHasAnyFlags(Flags, EPWPawnGravityFlags::Player);
+		for(const FPWGravityZoneInfo& Zone : GravityZoneSubsystem->GetActiveZones())
+		{
+			APW_RocketCreation* Rocket = Zone.Rocket.Get();
+			const bool bCanAffect = bIsPlayer ? Zone.CanAffectPlayerClass(Pawn->GetClass()) : Zone.CanAffectEnemyClass(Pawn->GetClass());
+			if(Rocket != nullptr && bCanAffect && Zone.Contains(Pawn->GetActorLocation()))
+			{
+				Rocket->RestorePawnInZone(Pawn, FMath::Max<int32>(PawnSnapshots[i]->OverlappingZoneCount, 1));
+				break;
+			}
+		}
+
+		if(APWEnemyCharacter* Enemy = Cast<APWEnemyCharacter>(Pawn); Enemy != nullptr && EnumHasAnyFlags(Flags, EPWPawnGravityFlags::AlreadyInsideOnCraft))
+		{
+			Enemy->SetIfEnemyAlreadyInsideRocketZone(true);
+		}
+	}
+}
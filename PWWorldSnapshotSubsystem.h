@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PWWorldSnapshotSubsystem.generated.h"
+
+class APW_RocketCreation;
+class APWEnemyCharacter;
+class APWPlayerCharacter;
+class AInteractable;
+
+//Saved state of a rocket
+struct FPWRocketSnapshot
+{
+	int32 ClassIndex = INDEX_NONE;
+	FVector3f Location = FVector3f::ZeroVector;
+	FQuat4f Rotation = FQuat4f::Identity;
+	FVector3f Scale = FVector3f::OneVector;
+	float RemainingSeconds = 0.0f;
+	bool bAffectsEnemies = true;
+	bool bAffectsPlayer = true;
+
+	friend FArchive& operator<<(FArchive& Ar, FPWRocketSnapshot& Rocket);
+};
+
+//Saved state of an enemy or a player, with its gravity zone membership
+struct FPWPawnSnapshot
+{
+	int32 ClassIndex = INDEX_NONE;
+	FVector3f Location = FVector3f::ZeroVector;
+	float Yaw = 0.0f;
+
+	//Number of zones the pawn is counted in and EPWPawnGravityFlags
+	uint8 OverlappingZoneCount = 0;
+	uint8 Flags = 0;
+
+	//Id of the player state, only saved for the players
+	int32 PlayerId = INDEX_NONE;
+
+	friend FArchive& operator<<(FArchive& Ar, FPWPawnSnapshot& Pawn);
+};
+
+//Saved state of a pickup
+struct FPWInteractableSnapshot
+{
+	int32 ClassIndex = INDEX_NONE;
+	int32 InteractableId = 0;
+	int32 Amount = 0;
+	FVector3f Location = FVector3f::ZeroVector;
+
+	//-1 when the destroy countdown isn't started
+	float DestroyTimeRemaining = -1.0f;
+
+	friend FArchive& operator<<(FArchive& Ar, FPWInteractableSnapshot& Interactable);
+};
+
+//Saved state of the waves and of the sun
+struct FPWDayNightSnapshot
+{
+	bool bIsValid = false;
+	int32 WaveEnumCounter = 0;
+	int32 SunAngle = 0;
+	int32 PreviousSunAngle = 0;
+	float SunRotationIncrement = 0.0f;
+	float ElapsedTime = 0.0f;
+	bool bSunMoving = false;
+	FRotator3f LightRotation = FRotator3f::ZeroRotator;
+
+	friend FArchive& operator<<(FArchive& Ar, FPWDayNightSnapshot& DayNight);
+};
+
+//Gameplay state of a world, saved in a compact binary form. The class paths are saved once in a table
+struct FPWWorldSnapshot
+{
+	TArray<FString> ClassPaths;
+	FPWDayNightSnapshot DayNight;
+	TArray<FPWRocketSnapshot> Rockets;
+	TArray<FPWPawnSnapshot> Enemies;
+	TArray<FPWPawnSnapshot> Players;
+	TArray<FPWInteractableSnapshot> Interactables;
+
+	friend FArchive& operator<<(FArchive& Ar, FPWWorldSnapshot& Snapshot);
+};
+
+/**
+ * Saves and restores the gameplay state of the world in place, for the match restarts and the checkpoints:
+ * the rockets with their countdown, the gravity zone state of every pawn, the waves and the sun, and the pickups.
+ * The restore moves the actors already in the world and takes the enemies from the pool before spawning anything.
+ * Only the server and the standalone games can restore a snapshot.
+ */
+UCLASS()
+class PROJECTWATER_API UPWWorldSnapshotSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//Write the current state of the world. OutEnemies gets the saved enemies in the order of the snapshot
+	void CaptureSnapshot(TArray<uint8>& OutBytes, TArray<APWEnemyCharacter*>* OutEnemies = nullptr) const;
+
+	//Put the world back in the saved state. Return false if the data isn't a valid snapshot.
+	//OutEnemies gets the restored enemies in the order of the snapshot, nullptr for the ones that couldn't be restored
+	bool RestoreSnapshot(const TArray<uint8>& Bytes, TArray<APWEnemyCharacter*>* OutEnemies = nullptr);
+
+	//Keep a snapshot in memory
+	UFUNCTION(BlueprintCallable, Category="Snapshot")
+	void SaveCheckpoint();
+
+	//Restore the snapshot kept in memory. Return false if there is none
+	UFUNCTION(BlueprintCallable, Category="Snapshot")
+	bool RestoreCheckpoint();
+
+	//Save and load a snapshot in the Saved/Snapshots folder of the project
+	UFUNCTION(BlueprintCallable, Category="Snapshot")
+	bool SaveSnapshotToFile(const FString& SnapshotName) const;
+
+	UFUNCTION(BlueprintCallable, Category="Snapshot")
+	bool LoadSnapshotFromFile(const FString& SnapshotName);
+
+private:
+	static FString GetSnapshotFilePath(const FString& SnapshotName);
+
+	static int32 FindOrAddClass(FPWWorldSnapshot& Snapshot, const UClass* Class);
+
+	void CaptureDayNight(FPWDayNightSnapshot& OutDayNight) const;
+	void CaptureRockets(FPWWorldSnapshot& Snapshot) const;
+	void CapturePawns(FPWWorldSnapshot& Snapshot, TArray<APWEnemyCharacter*>* OutEnemies) const;
+	void CaptureInteractables(FPWWorldSnapshot& Snapshot) const;
+
+	void RestoreDayNight(const FPWDayNightSnapshot& DayNight) const;
+	void RestoreRockets(const FPWWorldSnapshot& Snapshot, const TArray<UClass*>& Classes, TArray<APW_RocketCreation*>& OutRockets) const;
+	void RestorePawns(const FPWWorldSnapshot& Snapshot, const TArray<UClass*>& Classes, TArray<APawn*>& OutPawns, TArray<const FPWPawnSnapshot*>& OutPawnSnapshots, TArray<APWEnemyCharacter*>* OutEnemies) const;
+	void RestorePlayer(APWPlayerCharacter* Player, const FPWPawnSnapshot& SavedPlayer) const;
+	void RestoreInteractables(const FPWWorldSnapshot& Snapshot, const TArray<UClass*>& Classes) const;
+
+	//Make the pawns that were floating float again in a restored rocket that contains them
+	void RestoreZoneMemberships(const TArray<APW_RocketCreation*>& Rockets, const TArray<APawn*>& Pawns, const TArray<const FPWPawnSnapshot*>& PawnSnapshots) const;
+
+	TArray<uint8> CheckpointBytes;
+};
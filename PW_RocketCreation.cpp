@@ -2,12 +2,24 @@
 
 
 #include "Creator/Items/CreationItems/PW_RocketCreation.h"
+#include "Core/PWGameplayStats.h"
+#include "Creator/Items/CreationItems/PWGravityZoneCollision.h"
+#include "Creator/Items/CreationItems/PWGravityZoneSubsystem.h"
+#include "Creator/Items/CreationItems/PWGravityFieldSubsystem.h"
+#include "Creator/Items/CreationItems/PWGravityZoneShapeSubsystem.h"
+#include "Characters/Enemies/Navigation/PWPathRequestQueueSubsystem.h"
+#include "Creator/Items/CreationItems/PWGravityZoneReplication.h"
+#include "Characters/Player/PWPlayerRocketStateComponent.h"
+#include "Characters/Enemies/PWEnemyGravityStateComponent.h"
+#include "Core/PWPhysicsQuerySchedulerSubsystem.h"
+#include "Core/PWTimingWheelSubsystem.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "BehaviorTree/BlackboardComponent.h"
 #include "Characters/Enemies/PWEnemyMovementComponent.h"
 #include "Characters/Enemies/Controllers/BlackboardKeys.h"
 #include "Characters/Enemies/Controllers/PWEnemyController.h"
 #include "Kismet/GameplayStatics.h"
+#include "Misc/ScopeExit.h"
 
 APW_RocketCreation::APW_RocketCreation()
 {
@@ -16,44 +28,118 @@ APW_RocketCreation::APW_RocketCreation()
 
 	CollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("Collision Box verification"));
 	CollisionBox->SetupAttachment(CollisionSphere);
+
+	//Only the pawns generate overlaps with the gravity zone, the pickups and props are filtered out by the broadphase
+	PWGravityZoneCollision::ApplyGravityZoneCollision(CollisionSphere);
+	PWGravityZoneCollision::ApplyGravityZoneCollision(CollisionBox);
 }
 
 void APW_RocketCreation::BeginPlay()
 {
+	LLM_SCOPE_BYTAG(PWRockets);
+
 	Super::BeginPlay();
 
-	//Set a countdown timer with the specified time, will destroy the rocket at the end and remove the current behaviors 
-	GetWorld()->GetTimerManager().SetTimer(RocketTimer, this, &APW_RocketCreation::LaunchRocket, SecondsBeforeRocketLaunch, false);
+	if(UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>())
+	{
+		//Set a countdown timer with the specified time, will destroy the rocket at the end and remove the current behaviors 
+		TimingWheel->SetTimer(RocketTimer, this, &APW_RocketCreation::RequestLaunch, SecondsBeforeRocketLaunch, false);
 
-	//Call this function with a little delay to prevent an error where the detection of the overlapping actors would always fail on spawn
-	GetWorld()->GetTimerManager().SetTimer(VerificationTimer, this, &APW_RocketCreation::VerifyEnemyAlreadyInside, 0.1f, false);
+		//Call this function with a little delay to prevent an error where the detection of the overlapping actors would always fail on spawn
+		TimingWheel->SetTimer(VerificationTimer, this, &APW_RocketCreation::RequestEnemyVerification, 0.1f, false);
+	}
 	
 	//delegates functions
 	CollisionSphere->OnComponentBeginOverlap.AddUniqueDynamic(this, &APW_RocketCreation::OnBeginOverlap);
 	CollisionSphere->OnComponentEndOverlap.AddUniqueDynamic(this, &APW_RocketCreation::OnEndOverlap);
 
-	//add a rocket to the total for moon jump
-	AddRocketToActiveRocketCounter();
-	
-	if(bCanPlayerMoonJump == true)
+	//The other shapes don't use the overlaps of the sphere, the shape subsystem calls the same handlers
+	if(UsesShapeContainment() == true)
+	{
+		CollisionSphere->SetGenerateOverlapEvents(false);
+	}
+
+	//add the zone to the active zones, so the systems that don't use the overlaps apply it too.
+	//The rocket state of each player counts the rocket and gives the moon jump from this event
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		GravityZoneSubsystem->RegisterZone(this);
+	}
+}
+
+void APW_RocketCreation::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	//the zone is usually removed when the rocket is launched, this handles the rockets removed in any other way
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		GravityZoneSubsystem->UnregisterZone(this);
+	}
+
+	if(UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>())
+	{
+		TimingWheel->ClearTimer(RocketTimer);
+		TimingWheel->ClearTimer(VerificationTimer);
+	}
+
+	if(UPWPhysicsQuerySchedulerSubsystem* QueryScheduler = GetWorld()->GetSubsystem<UPWPhysicsQuerySchedulerSubsystem>())
+	{
+		QueryScheduler->CancelQueries(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void APW_RocketCreation::RequestEnemyVerification()
+{
+	//Urgent like the launch: until the verification runs, the enemies already inside the new rocket don't float
+	if(UPWPhysicsQuerySchedulerSubsystem* QueryScheduler = GetWorld()->GetSubsystem<UPWPhysicsQuerySchedulerSubsystem>())
+	{
+		QueryScheduler->SubmitQuery(EPWPhysicsQueryPriority::Urgent, this, &APW_RocketCreation::VerifyEnemyAlreadyInside);
+	}
+	else
 	{
-		//call the moon jump function
-		PlayerMoonJump();
+		VerifyEnemyAlreadyInside();
+	}
+}
+
+void APW_RocketCreation::RequestLaunch()
+{
+	//The launch runs on the next update of the physics queries whatever their budget
+	if(UPWPhysicsQuerySchedulerSubsystem* QueryScheduler = GetWorld()->GetSubsystem<UPWPhysicsQuerySchedulerSubsystem>())
+	{
+		QueryScheduler->SubmitQuery(EPWPhysicsQueryPriority::Urgent, this, &APW_RocketCreation::LaunchRocket);
+	}
+	else
+	{
+		LaunchRocket();
 	}
 }
 
 void APW_RocketCreation::VerifyEnemyAlreadyInside()
 {
+	PW_SCOPE_GAMEPLAY_TIME(Rockets);
+
 	//Verify if there is enemies that are already inside the rocket collision sphere when the rocket is crafted/spawned
+
+	//The gravity field already affects the pawns around the rocket
+	if(UPWGravityFieldSubsystem::IsFieldModeEnabled() == true)
+	{
+		if(UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>())
+		{
+			TimingWheel->ClearTimer(VerificationTimer);
+		}
+		IsOverlappingInitialDelayOver = true;
+		return;
+	}
 	
 	//Get all the actors of the enemy character class that are overlapping the sphere collision
 	TArray<AActor*> EnemyAlreadyInsideArray;
-	this->CollisionSphere->GetOverlappingActors(EnemyAlreadyInsideArray, APWEnemyCharacter::StaticClass());
+	GetActorsInsideZone(EnemyAlreadyInsideArray, APWEnemyCharacter::StaticClass());
 	
 	//For each actors in the array, verify if it can be cast to enemy character and that it doesn't return nullptr
 	for(int i = 0; i < EnemyAlreadyInsideArray.Num(); i++)
 	{
-		if(APWEnemyCharacter* EnemyCharacter = Cast<APWEnemyCharacter>(EnemyAlreadyInsideArray[i]); EnemyCharacter != nullptr) 
+		if(APWEnemyCharacter* EnemyCharacter = Cast<APWEnemyCharacter>(EnemyAlreadyInsideArray[i]); EnemyCharacter != nullptr && CanAffectActor(EnemyCharacter)) 
 		{
 			if(EnemyCharacter->bEnemyAlreadyInsideOnCraft == false){	//if the enemy wasn't overlapping on spawn
 				
@@ -65,13 +151,18 @@ void APW_RocketCreation::VerifyEnemyAlreadyInside()
 				//if the enemy was already in the zone on spawn and have spawned a new rocket on top of it, I just increment the counter
 				EnemyCharacter->setNumberOfOverlappingRocket(++EnemyCharacter->NbRocketOverlappingCounter);	//add a new overlapping rocket to the counter
 			}
+
+			ReplicatePawnGravityState(EnemyCharacter);
 		}
 	}
 
 	EnemyAlreadyInsideArray.Empty();
 
 	//clear the little delay timer
-	GetWorld()->GetTimerManager().ClearTimer(VerificationTimer);
+	if(UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>())
+	{
+		TimingWheel->ClearTimer(VerificationTimer);
+	}
 	
 	//indicate that the delay for detection is over
 	IsOverlappingInitialDelayOver = true;
@@ -80,6 +171,20 @@ void APW_RocketCreation::VerifyEnemyAlreadyInside()
 void APW_RocketCreation::OnBeginOverlap(UPrimitiveComponent* OverlappedComp, AActor* OtherActor,
     UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	PW_SCOPE_GAMEPLAY_TIME(Rockets);
+
+	//Ignore the pawns filtered out by this zone, and every pawn when the zone events are ignored
+	if(CanAffectActor(OtherActor) == false || AreZoneEventsIgnored() == true)
+	{
+		return;
+	}
+
+	//Whatever path the overlap takes, the clients receive the final state of the pawn
+	ON_SCOPE_EXIT
+	{
+		ReplicatePawnGravityState(OtherActor);
+	};
+
 	if(APWEnemyCharacter* EnemyCharacter = Cast<APWEnemyCharacter>(OtherActor))	//collision with an enemy
 	{
 		//Verify if the enemy is valid, and the begin overlap is not being called while the rocket is in the process of being destroyed
@@ -129,6 +234,11 @@ void APW_RocketCreation::OnBeginOverlap(UPrimitiveComponent* OverlappedComp, AAc
 			MovementComponent->AirControl = 1.0f;
 			EnemyCharacter->bIsInGravityZone = true;
 
+			if(UPWEnemyGravityStateComponent* GravityState = UPWEnemyGravityStateComponent::FindGravityState(EnemyCharacter))
+			{
+				GravityState->EnterGravityZone();
+			}
+
 			//Launch the character in the air or he won't move up.
 			EnemyCharacter->LaunchCharacter(FVector(0,0, 10), false, true);
 
@@ -186,6 +296,20 @@ void APW_RocketCreation::OnBeginOverlap(UPrimitiveComponent* OverlappedComp, AAc
 void APW_RocketCreation::OnEndOverlap(UPrimitiveComponent* OverlappedComp, AActor* OtherActor,
 	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
+	PW_SCOPE_GAMEPLAY_TIME(Rockets);
+
+	//Ignore the pawns filtered out by this zone, and every pawn when the zone events are ignored
+	if(CanAffectActor(OtherActor) == false || AreZoneEventsIgnored() == true)
+	{
+		return;
+	}
+
+	//Whatever path the overlap takes, the clients receive the final state of the pawn
+	ON_SCOPE_EXIT
+	{
+		ReplicatePawnGravityState(OtherActor);
+	};
+
 	//if the other actor is an enemy
 	if(APWEnemyCharacter* EnemyCharacter = Cast<APWEnemyCharacter>(OtherActor))
 	{
@@ -233,11 +357,8 @@ void APW_RocketCreation::OnEndOverlap(UPrimitiveComponent* OverlappedComp, AActo
 			MovementComponent->AirControl = 0.2f;
 			EnemyCharacter->bIsInGravityZone = false;
 
-			if (const APWEnemyController* AIController = Cast<APWEnemyController>(EnemyCharacter->GetController()); AIController != nullptr)
-			{
-				//Deactivate the new state of the AI with the blackboard key
-				AIController->GetBlackboard()->SetValueAsBool(BBKeys::GravityEnabled, false);
-			}
+			//Deactivate the new state of the AI, spread over several frames to avoid all the enemies re-pathing at once
+			QueueEnemyLanding(EnemyCharacter);
 
 			//if the enemy was already in the zone when the rocket spawned, set the boolean to false because the enemy is now out of the zone
 			if(EnemyCharacter->bEnemyAlreadyInsideOnCraft == true)	
@@ -278,15 +399,10 @@ void APW_RocketCreation::OnEndOverlap(UPrimitiveComponent* OverlappedComp, AActo
 				Player->GetCharacterMovement()->SetMovementMode(EMovementMode::MOVE_Walking);
 				Player->GetCharacterMovement()->BrakingDecelerationFalling = 0.0f;
 
-				if(Player->NumberOfActiveRocket > 0 && bCanPlayerMoonJump == true)
-				{
-					Player->GetCharacterMovement()->JumpZVelocity = NewPlayerMoonJumpZVelocity;
-					Player->GetCharacterMovement()->GravityScale = NewPlayerMoonJumpGravityScale;
-				}
-				else
+				//Moon jump if one of the active rockets gives it
+				if(const UPWPlayerRocketStateComponent* RocketState = UPWPlayerRocketStateComponent::FindRocketState(Player))
 				{
-					Player->GetCharacterMovement()->JumpZVelocity = 420.0f;
-					Player->GetCharacterMovement()->GravityScale = 1.0f;
+					RocketState->ApplyJumpSettings();
 				}
 
 				//Launch the character so that he leaves the zone effectively
@@ -305,20 +421,39 @@ void APW_RocketCreation::OnEndOverlap(UPrimitiveComponent* OverlappedComp, AActo
 
 void APW_RocketCreation::LaunchRocket()
 {
+	PW_SCOPE_GAMEPLAY_TIME(Rockets);
+
 	//reset the boolean of the first timer and indicate that the rocket is in the process of being destroyed
 	IsOverlappingInitialDelayOver = false;	
 	bIsRocketDestroyed = true;
 	bool bLastRocket = false;
+
+	//the zone stops affecting anything from now on
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		GravityZoneSubsystem->UnregisterZone(this);
+	}
+
+	//The gravity field lands the pawns by itself once the zone is gone
+	if(UPWGravityFieldSubsystem::IsFieldModeEnabled() == true)
+	{
+		if(UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>())
+		{
+			TimingWheel->ClearTimer(RocketTimer);
+		}
+		this->Destroy();
+		return;
+	}
 	
 	//Get all the actors of the enemy character class that are overlapping the sphere collision
 	TArray<AActor*> EnemyArray;
 	this->CollisionSphere->UpdateOverlaps();	//Update the overlaps
-	this->CollisionSphere->GetOverlappingActors(EnemyArray, APWEnemyCharacter::StaticClass());
+	GetActorsInsideZone(EnemyArray, APWEnemyCharacter::StaticClass());
 	
 	//For each actors in the array, verify if it can be cast to enemy character and that it doesn't return nullptr
 	for(int i = 0; i < EnemyArray.Num(); i++)
 	{
-		if(APWEnemyCharacter* EnemyCharacter = Cast<APWEnemyCharacter>(EnemyArray[i]); EnemyCharacter != nullptr) 
+		if(APWEnemyCharacter* EnemyCharacter = Cast<APWEnemyCharacter>(EnemyArray[i]); EnemyCharacter != nullptr && CanAffectActor(EnemyCharacter)) 
 		{
 			//If the timer is finished and the enemy is still in the gravity zone
  			if(EnemyCharacter->bIsInGravityZone == true && EnemyCharacter->NbRocketOverlappingCounter > 0)	
@@ -340,11 +475,8 @@ void APW_RocketCreation::LaunchRocket()
  					MovementComponent->AirControl = 0.2f;
  					EnemyCharacter->bIsInGravityZone = false;								//reset the boolean of the enemy to false
 
- 					if (const APWEnemyController* AIController = Cast<APWEnemyController>(EnemyCharacter->GetController()); AIController != nullptr)
- 					{
- 						//Deactivate the new state of the AI with the blackboard key
- 						AIController->GetBlackboard()->SetValueAsBool(BBKeys::GravityEnabled, false);
- 					}
+ 					//Deactivate the new state of the AI, spread over several frames to avoid all the enemies re-pathing at once
+ 					QueueEnemyLanding(EnemyCharacter);
  				}
  				else
  				{
@@ -352,24 +484,27 @@ void APW_RocketCreation::LaunchRocket()
  					//Remove one from the rocket counter or else the enemy won't be up to date with the counter
  					EnemyCharacter->setNumberOfOverlappingRocket(--EnemyCharacter->NbRocketOverlappingCounter);
  				}
+
+				ReplicatePawnGravityState(EnemyCharacter);
  			}
 		}
 	}
 
-	//Remove the rocket from the total
-	RemoveRocketToActiveRocketCounter();
+	//The rocket was removed from the rocket state of the players when its zone was unregistered
 
-	//Get all the actors of the player character class that are overlapping the sphere collision
+	//Get all the actors of the player character class that are overlapping the sphere collision.
+	//Landing the enemies didn't move anything, the overlaps updated above are still valid
 	TArray<AActor*> PlayerArray;
-	this->CollisionSphere->UpdateOverlaps();	//Update the overlaps
-	this->CollisionSphere->GetOverlappingActors(PlayerArray, APWPlayerCharacter::StaticClass());
+	GetActorsInsideZone(PlayerArray, APWPlayerCharacter::StaticClass());
 	
 	//For each actors in the array, verify if it can be cast to player character and that it doesn't return nullptr
 	for(int i = 0; i < PlayerArray.Num(); i++)
 	{
 		if(APWPlayerCharacter* PlayerCharacter = Cast<APWPlayerCharacter>(PlayerArray[i]); PlayerCharacter != nullptr) 
 		{
-			if(PlayerCharacter->bIsPlayerFlyingInGravityZone == true)	//If the timer is finished and the player is still in the gravity zone
+			const UPWPlayerRocketStateComponent* PlayerRocketState = UPWPlayerRocketStateComponent::FindRocketState(PlayerCharacter);
+
+			if(PlayerCharacter->bIsPlayerFlyingInGravityZone == true && CanAffectActor(PlayerCharacter))	//If the timer is finished and the player is still in the gravity zone
 			{
 				//If the player is in his last gravity zone, reset his behavior to normal
 				if(PlayerCharacter->NbRocketOverlappingCounter == 1)
@@ -384,15 +519,10 @@ void APW_RocketCreation::LaunchRocket()
 					PlayerCharacter->GetCharacterMovement()->SetMovementMode(EMovementMode::MOVE_Walking);
 					PlayerCharacter->GetCharacterMovement()->BrakingDecelerationFalling = 0.0f;
 
-					if(PlayerCharacter->NumberOfActiveRocket > 0 && bCanPlayerMoonJump == true)
+					//This rocket is already removed from the rocket state, the moon jump stays only if another rocket gives it
+					if(PlayerRocketState != nullptr)
 					{
-						PlayerCharacter->GetCharacterMovement()->JumpZVelocity = NewPlayerMoonJumpZVelocity;
-						PlayerCharacter->GetCharacterMovement()->GravityScale = NewPlayerMoonJumpGravityScale;
-					}
-					else
-					{
-						PlayerCharacter->GetCharacterMovement()->JumpZVelocity = 420.0f;
-						PlayerCharacter->GetCharacterMovement()->GravityScale = 1.0f;
+						PlayerRocketState->ApplyJumpSettings();
 					}
 					
 					if(PlayerCharacter->GetCharacterMovement()->IsFlying() == false)
@@ -406,9 +536,11 @@ void APW_RocketCreation::LaunchRocket()
 					//Remove one from the rocket counter or else the player won't be up to date with the counter
 					PlayerCharacter->setNumberOfOverlappingRocketForPlayer(--PlayerCharacter->NbRocketOverlappingCounter);
 				}
+
+				ReplicatePawnGravityState(PlayerCharacter);
 			}
 
-			if(PlayerCharacter->NumberOfActiveRocket == 0)
+			if(PlayerRocketState != nullptr && PlayerRocketState->GetNumActiveRockets() == 0)
 			{
 				bLastRocket = true;
 			}
@@ -416,30 +548,29 @@ void APW_RocketCreation::LaunchRocket()
 	}
 	
 	// Clear the timer
-	GetWorld()->GetTimerManager().ClearTimer(RocketTimer);
+	if(UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>())
+	{
+		TimingWheel->ClearTimer(RocketTimer);
+	}
 	
 	//Inform the player that the rocket has been deleted
 	//GEngine->AddOnScreenDebugMessage(0,3.0f, FColor::Black,"Rocket launched in the sky");
 	
-	//When the rocket is launched, reset the normal jump to the player
-	if(bCanPlayerMoonJump == true)
-	{
-		PlayerNormalJump();
-	}
-
 	if(bLastRocket == true)
 	{
 		//Ensure that all the enemies are back to normal gravity with the last rocket being destroyed
 		
-		//Get all the actors of the enemy character class that are overlapping the box collision
-		TArray<AActor*> LastRocketEnemyArray;
-		this->CollisionBox->UpdateOverlaps();
-		this->CollisionBox->GetOverlappingActors(EnemyArray, APWEnemyCharacter::StaticClass());
+		//Copy the list of the floating enemies, the landing removes them from it
+		TArray<APWEnemyCharacter*> FloatingEnemyArray;
+		if(const UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+		{
+			FloatingEnemyArray.Append(GravityZoneSubsystem->GetFloatingEnemies());
+		}
 		
-		//For each actors in the array, verify if it can be cast to enemy character and that it doesn't return nullptr
-		for(int i = 0; i < EnemyArray.Num(); i++)
+		//For each floating enemy, verify that it doesn't return nullptr
+		for(int i = 0; i < FloatingEnemyArray.Num(); i++)
 		{
-			if(APWEnemyCharacter* EnemyCharacter = Cast<APWEnemyCharacter>(EnemyArray[i]); EnemyCharacter != nullptr) 
+			if(APWEnemyCharacter* EnemyCharacter = FloatingEnemyArray[i]; EnemyCharacter != nullptr) 
 			{
 				//If the timer is finished and the enemy is still in the gravity zone
  				if(EnemyCharacter->bIsInGravityZone == true)	
@@ -458,11 +589,10 @@ void APW_RocketCreation::LaunchRocket()
  					MovementComponent->AirControl = 0.2f;
  					EnemyCharacter->bIsInGravityZone = false;								//reset the boolean of the enemy to false
 
- 					if (const APWEnemyController* AIController = Cast<APWEnemyController>(EnemyCharacter->GetController()); AIController != nullptr)
- 					{
- 						//Deactivate the new state of the AI with the blackboard key
- 						AIController->GetBlackboard()->SetValueAsBool(BBKeys::GravityEnabled, false);
- 					}
+ 					//Deactivate the new state of the AI, spread over several frames to avoid all the enemies re-pathing at once
+ 					QueueEnemyLanding(EnemyCharacter);
+
+					ReplicatePawnGravityState(EnemyCharacter);
  				}
 			}
 		}
@@ -473,48 +603,283 @@ void APW_RocketCreation::LaunchRocket()
 	this->Destroy();
 }
 
-void APW_RocketCreation::AddRocketToActiveRocketCounter()
+void APW_RocketCreation::SetGravityZoneFilter(bool bAffectEnemies, bool bAffectPlayer)
 {
-	auto* PlayerCharacter = UGameplayStatics::GetPlayerCharacter(GetWorld(), 0);
-	if(APWPlayerCharacter* Player = Cast<APWPlayerCharacter>(PlayerCharacter))
+	PW_SCOPE_GAMEPLAY_TIME(Rockets);
+
+	//Only the pawns that are currently affected by the zone have been counted by the overlap handlers
+	TArray<AActor*> PawnsInsideArray;
+	if(IsOverlappingInitialDelayOver == true && bIsRocketDestroyed == false)
 	{
-		Player->setNumberOfRocket(++Player->NumberOfActiveRocket);	//add a rocket to the total of active rocket for the player
+		GetActorsInsideZone(PawnsInsideArray, APawn::StaticClass());
+	}
+
+	//Release the pawns that won't be affected anymore, as if they were leaving the zone
+	for(AActor* PawnInside : PawnsInsideArray)
+	{
+		const bool bIsEnemy = PawnInside->IsA(APWEnemyCharacter::StaticClass());
+		const bool bWillBeAffected = bIsEnemy ? bAffectEnemies : bAffectPlayer;
+		if(CanAffectActor(PawnInside) == true && bWillBeAffected == false)
+		{
+			OnEndOverlap(CollisionSphere, PawnInside, nullptr, INDEX_NONE);
+		}
+	}
+
+	const bool bWasAffectingEnemies = bCanEnemiesFloatInRocketZone;
+	const bool bWasAffectingPlayer = bCanPlayerFloatInRocketZone;
+	bCanEnemiesFloatInRocketZone = bAffectEnemies;
+	bCanPlayerFloatInRocketZone = bAffectPlayer;
+
+	//Capture the pawns that are now affected, as if they were entering the zone
+	for(AActor* PawnInside : PawnsInsideArray)
+	{
+		const bool bIsEnemy = PawnInside->IsA(APWEnemyCharacter::StaticClass());
+		const bool bWasAffected = bIsEnemy ? bWasAffectingEnemies : bWasAffectingPlayer;
+		if(CanAffectActor(PawnInside) == true && bWasAffected == false)
+		{
+			OnBeginOverlap(CollisionSphere, PawnInside, nullptr, INDEX_NONE, false, FHitResult());
+		}
+	}
+
+	//A zone that affects nobody doesn't need to generate overlaps at all
+	const bool bWasGeneratingOverlaps = CollisionSphere->GetGenerateOverlapEvents();
+	const bool bGenerateOverlaps = (bCanEnemiesFloatInRocketZone || bCanPlayerFloatInRocketZone) && UsesShapeContainment() == false;
+	CollisionSphere->SetGenerateOverlapEvents(bGenerateOverlaps);
+
+	//The overlaps were not kept while the zone affected nobody, so the pawns already standing inside weren't gathered above.
+	//Updating the overlaps now calls the begin overlap of each of them with the new filter
+	if(bWasGeneratingOverlaps == false && bGenerateOverlaps == true && bIsRocketDestroyed == false)
+	{
+		CollisionSphere->UpdateOverlaps();
+	}
+
+	//keep the copy of the zone used outside of the overlaps up to date
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		GravityZoneSubsystem->RefreshZone(this);
 	}
 }
 
-void APW_RocketCreation::RemoveRocketToActiveRocketCounter()
+FPWGravityZoneShape APW_RocketCreation::GetZoneShape() const
 {
-	auto* PlayerCharacter = UGameplayStatics::GetPlayerCharacter(GetWorld(), 0);
-	if(APWPlayerCharacter* Player = Cast<APWPlayerCharacter>(PlayerCharacter))
+	FPWGravityZoneShape Shape;
+	Shape.Type = ZoneShape;
+	Shape.Center = CollisionSphere->GetComponentLocation();
+	Shape.Rotation = CollisionSphere->GetComponentQuat();
+
+	//Follow the scale of the rocket like the collision sphere does
+	const FVector Scale = CollisionSphere->GetComponentScale().GetAbs();
+	Shape.Radius = ZoneShape == EPWGravityZoneShapeType::Sphere ? CollisionSphere->GetScaledSphereRadius() : ZoneShapeRadius * FMath::Min(Scale.X, Scale.Y);
+	Shape.HalfHeight = ZoneShapeHalfHeight * Scale.Z;
+	Shape.BoxExtent = ZoneBoxExtent * Scale;
+	return Shape;
+}
+
+void APW_RocketCreation::HandlePawnEnteredZone(AActor* Pawn)
+{
+	OnBeginOverlap(CollisionSphere, Pawn, nullptr, INDEX_NONE, false, FHitResult());
+}
+
+void APW_RocketCreation::HandlePawnLeftZone(AActor* Pawn)
+{
+	OnEndOverlap(CollisionSphere, Pawn, nullptr, INDEX_NONE);
+}
+
+void APW_RocketCreation::RestoreFromSnapshot(float RemainingSeconds, bool bAffectEnemies, bool bAffectPlayer)
+{
+	if(UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>())
+	{
+		TimingWheel->ClearTimer(VerificationTimer);
+		TimingWheel->SetTimer(RocketTimer, this, &APW_RocketCreation::RequestLaunch, FMath::Max(RemainingSeconds, 0.01f), false);
+	}
+
+	//A verification or a launch still queued belongs to the state before the snapshot
+	if(UPWPhysicsQuerySchedulerSubsystem* QueryScheduler = GetWorld()->GetSubsystem<UPWPhysicsQuerySchedulerSubsystem>())
+	{
+		QueryScheduler->CancelQueries(this);
+	}
+
+	//The pawns already inside come from the snapshot, not from the verification
+	IsOverlappingInitialDelayOver = true;
+
+	bCanEnemiesFloatInRocketZone = bAffectEnemies;
+	bCanPlayerFloatInRocketZone = bAffectPlayer;
+	CollisionSphere->SetGenerateOverlapEvents((bAffectEnemies || bAffectPlayer) && UsesShapeContainment() == false);
+
+	if(UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
 	{
-		Player->setNumberOfRocket(--Player->NumberOfActiveRocket);	//remove a rocket to the total of active rocket for the player
+		GravityZoneSubsystem->RefreshZone(this);
 	}
 }
 
-void APW_RocketCreation::PlayerMoonJump()
+void APW_RocketCreation::RestorePawnInZone(AActor* Pawn, int32 NumZones)
 {
-	auto* PlayerCharacter = UGameplayStatics::GetPlayerCharacter(GetWorld(), 0);
-	if(APWPlayerCharacter* Player = Cast<APWPlayerCharacter>(PlayerCharacter))
+	//Float with the settings of this zone, the handler sets the counter to 1
+	HandlePawnEnteredZone(Pawn);
+
+	if(APWEnemyCharacter* EnemyCharacter = Cast<APWEnemyCharacter>(Pawn))
+	{
+		EnemyCharacter->setNumberOfOverlappingRocket(NumZones);
+	}
+	else if(APWPlayerCharacter* Player = Cast<APWPlayerCharacter>(Pawn))
 	{
-		Player->GetCharacterMovement()->JumpZVelocity = NewPlayerMoonJumpZVelocity;
-		Player->GetCharacterMovement()->GravityScale = NewPlayerMoonJumpGravityScale;
-		//GEngine->AddOnScreenDebugMessage(0,2.0f, FColor::Blue,"Player moon jump activated");
+		Player->setNumberOfOverlappingRocketForPlayer(NumZones);
 	}
+
+	ReplicatePawnGravityState(Pawn);
 }
 
-void APW_RocketCreation::PlayerNormalJump()
+float APW_RocketCreation::GetRemainingTime() const
+{
+	const UPWTimingWheelSubsystem* TimingWheel = GetWorld()->GetSubsystem<UPWTimingWheelSubsystem>();
+	return TimingWheel != nullptr ? TimingWheel->GetTimerRemaining(RocketTimer) : 0.0f;
+}
+
+bool APW_RocketCreation::AreZoneEventsIgnored() const
+{
+	//The gravity field replaces the overlaps, and a snapshot restore sets the pawn states by itself
+	if(UPWGravityFieldSubsystem::IsFieldModeEnabled() == true)
+	{
+		return true;
+	}
+
+	const UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>();
+	return GravityZoneSubsystem != nullptr && GravityZoneSubsystem->AreZoneEventsSuspended();
+}
+
+void APW_RocketCreation::GetActorsInsideZone(TArray<AActor*>& OutActors, TSubclassOf<AActor> ClassFilter) const
+{
+	if(UsesShapeContainment() == false)
+	{
+		CollisionSphere->GetOverlappingActors(OutActors, ClassFilter);
+		return;
+	}
+
+	OutActors.Reset();
+	if(const UPWGravityZoneShapeSubsystem* ShapeSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneShapeSubsystem>())
+	{
+		ShapeSubsystem->GetPawnsInsideZone(this, OutActors, ClassFilter);
+	}
+}
+
+bool APW_RocketCreation::CanAffectActor(const AActor* Actor) const
+{
+	if(Actor == nullptr)
+	{
+		return false;
+	}
+
+	for(const TSubclassOf<APawn>& IgnoredClass : IgnoredPawnClasses)
+	{
+		if(IgnoredClass != nullptr && Actor->IsA(IgnoredClass))
+		{
+			return false;
+		}
+	}
+
+	if(Actor->IsA(APWEnemyCharacter::StaticClass()))
+	{
+		return bCanEnemiesFloatInRocketZone;
+	}
+
+	if(Actor->IsA(APWPlayerCharacter::StaticClass()))
+	{
+		return bCanPlayerFloatInRocketZone;
+	}
+
+	//Not a pawn that can float
+	return false;
+}
+
+void APW_RocketCreation::QueueEnemyLanding(APWEnemyCharacter* EnemyCharacter) const
+{
+	UPWEnemyGravityStateComponent* GravityState = UPWEnemyGravityStateComponent::FindGravityState(EnemyCharacter);
+	if(GravityState != nullptr)
+	{
+		GravityState->LeaveGravityZone();
+	}
+
+	if(UPWPathRequestQueueSubsystem* PathRequestQueue = GetWorld()->GetSubsystem<UPWPathRequestQueueSubsystem>())
+	{
+		PathRequestQueue->EnqueueLandingEnemy(EnemyCharacter);
+		return;
+	}
+
+	//Without the queue the enemy lands right away
+	if(GravityState != nullptr)
+	{
+		GravityState->FinishLanding();
+	}
+
+	if (const APWEnemyController* AIController = Cast<APWEnemyController>(EnemyCharacter->GetController()); AIController != nullptr)
+	{
+		//Deactivate the new state of the AI with the blackboard key
+		AIController->GetBlackboard()->SetValueAsBool(BBKeys::GravityEnabled, false);
+	}
+}
+
+void APW_RocketCreation::ReplicatePawnGravityState(AActor* Actor) const
 {
-	auto* PlayerCharacter = UGameplayStatics::GetPlayerCharacter(GetWorld(), 0);
-	if(APWPlayerCharacter* Player = Cast<APWPlayerCharacter>(PlayerCharacter))
+	if(HasAuthority() == false)
+	{
+		return;
+	}
+
+	const UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>();
+	APWGravityZoneReplicator* Replicator = GravityZoneSubsystem != nullptr ? GravityZoneSubsystem->GetReplicator() : nullptr;
+	if(Replicator == nullptr)
 	{
-		if(Player->NumberOfActiveRocket == 0)
+		return;
+	}
+
+	EPWPawnGravityFlags Flags = EPWPawnGravityFlags::None;
+	if(APWEnemyCharacter* EnemyCharacter = Cast<APWEnemyCharacter>(Actor))
+	{
+		if(EnemyCharacter->bIsInGravityZone == true)
 		{
-			Player->GetCharacterMovement()->JumpZVelocity = 420.0f;
-			Player->GetCharacterMovement()->GravityScale = 1.0f;
+			Flags |= EPWPawnGravityFlags::Floating;
 		}
-		else
+		if(EnemyCharacter->bEnemyAlreadyInsideOnCraft == true)
 		{
-			//GEngine->AddOnScreenDebugMessage(0,2.0f, FColor::Green,"A rocket is still active right now");
+			Flags |= EPWPawnGravityFlags::AlreadyInsideOnCraft;
 		}
+
+		Replicator->SetPawnGravityState(EnemyCharacter, static_cast<uint8>(FMath::Clamp<int32>(EnemyCharacter->NbRocketOverlappingCounter, 0, MAX_uint8)), Flags);
 	}
+	else if(APWPlayerCharacter* Player = Cast<APWPlayerCharacter>(Actor))
+	{
+		Flags |= EPWPawnGravityFlags::Player;
+		if(Player->bIsPlayerFlyingInGravityZone == true)
+		{
+			Flags |= EPWPawnGravityFlags::Floating;
+		}
+		const UPWPlayerRocketStateComponent* RocketState = UPWPlayerRocketStateComponent::FindRocketState(Player);
+		if(RocketState != nullptr && RocketState->CanMoonJump() == true)
+		{
+			Flags |= EPWPawnGravityFlags::MoonJump;
+		}
+
+		Replicator->SetPawnGravityState(Player, static_cast<uint8>(FMath::Clamp<int32>(Player->NbRocketOverlappingCounter, 0, MAX_uint8)), Flags);
+	}
+}
+
+void APW_RocketCreation::PlayerMoonJump()
+{
+	//Every player, local or remote, gets the jump given by all the active rockets of the world
+	if(const UPWGravityZoneSubsystem* GravityZoneSubsystem = GetWorld()->GetSubsystem<UPWGravityZoneSubsystem>())
+	{
+		for(const TWeakObjectPtr<UPWPlayerRocketStateComponent>& RocketState : GravityZoneSubsystem->GetPlayerRocketStates())
+		{
+			if(RocketState.IsValid())
+			{
+				RocketState->RefreshJump();
+			}
+		}
+	}
+}
+
+void APW_RocketCreation::PlayerNormalJump()
+{
+	//The normal jump comes back by itself once no active rocket gives the moon jump
+	PlayerMoonJump();
 }
@@ -7,6 +7,8 @@
 #include "Components/SphereComponent.h"
 #include "Characters/Enemies/PWEnemyCharacter.h"
 #include "Characters/Enemies/Controllers/PWEnemyController.h"
+#include "Core/PWTimingWheelSubsystem.h"
+#include "Creator/Items/CreationItems/PWGravityZoneShape.h"
 #include "PW_RocketCreation.generated.h"
 
 /**
@@ -22,6 +24,8 @@ class PROJECTWATER_API APW_RocketCreation : public ACreationItem
 public:
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	//Sphere collision that activate the new gravity
 	UPROPERTY(VisibleAnywhere)
 	TObjectPtr<USphereComponent> CollisionSphere;
@@ -29,6 +33,42 @@ public:
 	UPROPERTY(VisibleAnywhere)
 	TObjectPtr<UBoxComponent> CollisionBox;
 	
+	//Volume of the gravity zone. The sphere uses the collision sphere and its overlaps,
+	//the other shapes are tested against the pawn positions by UPWGravityZoneShapeSubsystem
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Rocket|Shape")
+	EPWGravityZoneShapeType ZoneShape = EPWGravityZoneShapeType::Sphere;
+
+	//Radius of the capsule and cylinder zones
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Rocket|Shape", meta=(EditCondition="ZoneShape==EPWGravityZoneShapeType::Capsule||ZoneShape==EPWGravityZoneShapeType::Cylinder", EditConditionHides))
+	float ZoneShapeRadius = 400.0f;
+
+	//Half height of the capsule and cylinder zones, along the up axis of the rocket
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Rocket|Shape", meta=(EditCondition="ZoneShape==EPWGravityZoneShapeType::Capsule||ZoneShape==EPWGravityZoneShapeType::Cylinder", EditConditionHides))
+	float ZoneShapeHalfHeight = 800.0f;
+
+	//Half size of the box zone
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Rocket|Shape", meta=(EditCondition="ZoneShape==EPWGravityZoneShapeType::Box", EditConditionHides))
+	FVector ZoneBoxExtent = FVector(500.0f, 500.0f, 500.0f);
+
+	//World space volume of the gravity zone
+	FPWGravityZoneShape GetZoneShape() const;
+
+	//True when the pawns are tested against the shape instead of the overlaps of the collision sphere
+	bool UsesShapeContainment() const { return ZoneShape != EPWGravityZoneShapeType::Sphere; }
+
+	//Same as the begin and end overlaps of the collision sphere, called by UPWGravityZoneShapeSubsystem for the other shapes
+	void HandlePawnEnteredZone(AActor* Pawn);
+	void HandlePawnLeftZone(AActor* Pawn);
+
+	//Restart the countdown and the filter saved in a world snapshot, the pawns inside are restored by the snapshot
+	void RestoreFromSnapshot(float RemainingSeconds, bool bAffectEnemies, bool bAffectPlayer);
+
+	//Make a pawn float in this zone as if it just entered it, with the counter of every zone it was in
+	void RestorePawnInZone(AActor* Pawn, int32 NumZones);
+
+	//Seconds before the rocket is launched
+	float GetRemainingTime() const;
+
 	//Total of seconds before the rocket is destroy
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rocket")
 	float SecondsBeforeRocketLaunch = 30.0f;
@@ -45,6 +85,7 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rocket")
 	bool bCanPlayerMoonJump = false;
 
+	//Refresh the jump of every player from his rocket state
 	UFUNCTION(BlueprintCallable)
 	void PlayerMoonJump();
 
@@ -55,11 +96,21 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rocket")
 	bool bCanPlayerFloatInRocketZone = true;
 
-	UFUNCTION()
-	void AddRocketToActiveRocketCounter();
+	//Enemies can float in the rocket gravity zone
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rocket|Filter")
+	bool bCanEnemiesFloatInRocketZone = true;
 
-	UFUNCTION()
-	void RemoveRocketToActiveRocketCounter();
+	//Pawn classes that are never affected by this gravity zone, even if they overlap it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rocket|Filter")
+	TArray<TSubclassOf<APawn>> IgnoredPawnClasses;
+
+	//Change which pawns are affected by this gravity zone. The pawns already inside are released or captured right away
+	UFUNCTION(BlueprintCallable, Category="Rocket|Filter")
+	void SetGravityZoneFilter(bool bAffectEnemies, bool bAffectPlayer);
+
+	//Return true if the actor is a pawn that this gravity zone can make float
+	UFUNCTION(BlueprintPure, Category="Rocket|Filter")
+	bool CanAffectActor(const AActor* Actor) const;
 
 	//Gravity scale for the player
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Rocket|Player")
@@ -100,14 +151,31 @@ private:
 	UFUNCTION()
 	void VerifyEnemyAlreadyInside();
 
+	//Queue the verification and the launch on the physics query scheduler, called by their timers
+	void RequestEnemyVerification();
+	void RequestLaunch();
+
 	//Timer to add a delay to the overlapping actor detection when the rocket is spawned so that we can detect correctly all the overlapping actors on spawn
 	UPROPERTY()
-	FTimerHandle VerificationTimer;
+	FPWWheelTimerHandle VerificationTimer;
 
 	//Called at the end of the timer
 	UFUNCTION()
 	void LaunchRocket();
 
+	//Give back the ground behavior to the AI of an enemy that stopped floating, through the path request queue.
+	//The gravity state of the enemy goes to landing until the queue serves it
+	void QueueEnemyLanding(APWEnemyCharacter* EnemyCharacter) const;
+
+	//True when the enter and leave events of the zone are handled by something else than this rocket
+	bool AreZoneEventsIgnored() const;
+
+	//The pawns of this class inside the zone, from the overlaps of the collision sphere or from the shape containment
+	void GetActorsInsideZone(TArray<AActor*>& OutActors, TSubclassOf<AActor> ClassFilter) const;
+
+	//Send the zone counter and float state of a pawn to the clients, only on the server
+	void ReplicatePawnGravityState(AActor* Actor) const;
+
 	//Bool to indicate the end of the initial delay timer for overlapping actors on spawn
 	UPROPERTY()
 	bool IsOverlappingInitialDelayOver = false;
@@ -118,5 +186,5 @@ private:
 
 	//Countdown timer before the rocket is destroyed 
 	UPROPERTY()
-	FTimerHandle RocketTimer;
+	FPWWheelTimerHandle RocketTimer;
 };
\ No newline at end of file